@@ -26,7 +26,7 @@ AtomicFileWriter::AtomicFileWriter(const std::filesystem::path& path)
     if (!file_) {
         // 文件打开失败，但构造函数不能抛出异常
         // 后续的 write() 和 commit() 会检查 file_ 是否为 nullptr
-        UTILS_LOG_ERROR("Failed to open file: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "Failed to open file: {}", temp_path_.string());
         return;
     }
 }
@@ -40,20 +40,22 @@ AtomicFileWriter::~AtomicFileWriter() {
 
     // 如果临时文件存在（说明 commit() 未成功），删除它
     if (std::filesystem::exists(temp_path_)) {
-        UTILS_LOG_ERROR("File not committed or committed failed: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "File not committed or committed failed: {}",
+                               temp_path_.string());
         std::filesystem::remove(temp_path_);
     }
 }
 
 bool AtomicFileWriter::write(const std::string& data) {
     if (!file_) {
-        UTILS_LOG_ERROR("File not opened: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "File not opened: {}", temp_path_.string());
         return false;
     }
 
     size_t written = fwrite(data.c_str(), 1, data.size(), file_);
     if (written != data.size()) {
-        UTILS_LOG_ERROR("Failed to write data to file: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "Failed to write data to file: {}",
+                               temp_path_.string());
         return false;
     }
     return true;
@@ -61,24 +63,25 @@ bool AtomicFileWriter::write(const std::string& data) {
 
 bool AtomicFileWriter::commit() {
     if (!file_) {
-        UTILS_LOG_ERROR("File not opened: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "File not opened: {}", temp_path_.string());
         return false;
     }
 
     // 刷新并同步文件数据到磁盘
     if (fflush(file_) != 0) {
-        UTILS_LOG_ERROR("Failed to flush file: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "Failed to flush file: {}", temp_path_.string());
         return false;
     }
 
     int fd = fileno(file_);
     if (fd == -1) {
-        UTILS_LOG_ERROR("Failed to get file descriptor: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "Failed to get file descriptor: {}",
+                               temp_path_.string());
         return false;
     }
 
     if (fsync(fd) != 0) {
-        UTILS_LOG_ERROR("Failed to sync file: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "Failed to sync file: {}", temp_path_.string());
         return false;
     }
 
@@ -96,7 +99,7 @@ bool AtomicFileWriter::commit() {
     if (dir_fd == -1) {
         // 无法打开目录，但文件已经同步，仍然尝试重命名
         // 如果重命名失败，临时文件会在析构时被删除
-        UTILS_LOG_WARN("Failed to open directory: {}", parent_dir.string());
+        UTILS_MODULE_LOG_WARN("filesystem", "Failed to open directory: {}", parent_dir.string());
     }
 
     // 执行原子重命名操作
@@ -106,17 +109,19 @@ bool AtomicFileWriter::commit() {
         if (dir_fd != -1) {
             close(dir_fd);
         }
-        UTILS_LOG_ERROR("Failed to rename file: {}", temp_path_.string());
+        UTILS_MODULE_LOG_ERROR("filesystem", "Failed to rename file: {}", temp_path_.string());
         return false;
     }
 
     // 同步目录元数据，确保重命名操作持久化
     if (dir_fd != -1) {
         if (fsync(dir_fd) != 0) {
-            UTILS_LOG_ERROR("Failed to sync directory: {}", parent_dir.string());
+            UTILS_MODULE_LOG_ERROR("filesystem", "Failed to sync directory: {}",
+                                   parent_dir.string());
         }
         if (close(dir_fd) != 0) {
-            UTILS_LOG_ERROR("Failed to close directory: {}", parent_dir.string());
+            UTILS_MODULE_LOG_ERROR("filesystem", "Failed to close directory: {}",
+                                   parent_dir.string());
         }
     }
 
@@ -4,42 +4,100 @@ import os
 import sys
 import argparse
 
-FIELDS = [
-    ("timestamp", "q"),
-    ("a", "q"),
-    ("b", "d"),
-    ("c", "d"),
-    ("d", "d"),
-    ("e", "d"),
-    ("f", "d"),
-    ("g", "d"),
-    ("h", "d"),
-    ("i", "d"),
-    ("j", "d"),
-]
-
-struct_fmt = "<" + "".join([field[1] for field in FIELDS])
-struct_unpack = struct.Struct(struct_fmt)
-struct_size = struct_unpack.size
-
-def analyze_bin(bin_path):
+# 与 log_struct_format.hpp 中的 LogStructFileHeader / LogStructFieldDesc 保持一致
+MAGIC = b"LOGSTRCT"
+FORMAT_VERSIONS = (1, 2)  # 版本 2 只改变了编码文件的块头，未编码文件的布局相同
+HEADER = struct.Struct("<8sIIIIqqQII64s8x")
+FIELD_DESC = struct.Struct("<32sIIII")
+FLAG_PREALLOCATED = 1 << 0
+FLAG_BLOCKS = 1 << 1
+FLAG_FRAMED = 1 << 2
+
+# FieldType -> struct 格式字符
+FIELD_TYPES = ["b", "B", "h", "H", "i", "I", "q", "Q", "f", "d"]
+
+
+def read_header(f):
+    data = f.read(HEADER.size)
+    if len(data) != HEADER.size:
+        raise ValueError("not a LogStruct file")
+    (magic, version, header_size, record_size, field_count, clock_base_us, steady_base_ns,
+     data_size, flags, timestamp_field, build_id) = HEADER.unpack(data)
+    if magic != MAGIC or version not in FORMAT_VERSIONS:
+        raise ValueError(f"bad magic or unsupported version {version}")
+    if flags & FLAG_BLOCKS:
+        raise ValueError("encoded LogStruct file, read it with LogStructReader")
+    if flags & FLAG_FRAMED:
+        raise ValueError("framed LogStruct file, read it with LogStructReader::frames()")
+
+    fields = []
+    for _ in range(field_count):
+        name, type_, offset, size, _ = FIELD_DESC.unpack(f.read(FIELD_DESC.size))
+        fields.append((name.rstrip(b"\0").decode(), type_, offset, size))
+    if not fields:
+        # 写入方没有提供字段描述，整条记录按字节输出
+        fields.append(("record", -1, 0, record_size))
+    f.seek(header_size)
+    return {
+        "header_size": header_size,
+        "record_size": record_size,
+        "clock_base_us": clock_base_us,
+        "steady_base_ns": steady_base_ns,
+        "data_size": data_size if flags & FLAG_PREALLOCATED else None,
+        "timestamp_field": timestamp_field,
+        "build_id": build_id.rstrip(b"\0").decode(),
+        "fields": fields,
+    }
+
+
+def record_struct(header):
+    # 按偏移排序生成格式串，字段之间的填充用 x 跳过
+    fmt = "<"
+    pos = 0
+    for _, type_, offset, size in sorted(header["fields"], key=lambda field: field[2]):
+        fmt += "x" * (offset - pos)
+        fmt += FIELD_TYPES[type_] if 0 <= type_ < len(FIELD_TYPES) else f"{size}s"
+        pos = offset + size
+    fmt += "x" * (header["record_size"] - pos)
+    return struct.Struct(fmt)
+
+
+def analyze_bin(bin_path, follow=True):
     with open(bin_path, 'rb') as f:
+        header = read_header(f)
+        struct_unpack = record_struct(header)
+        struct_size = struct_unpack.size
+        names = [field[0] for field in sorted(header["fields"], key=lambda field: field[2])]
+        yield names
 
+        remaining = header["data_size"]
         while True:
             data = f.read(struct_size)
-            if not data:
+            if len(data) < struct_size or remaining == 0:
+                if not follow:
+                    break
+                f.seek(-len(data), os.SEEK_CUR)
                 time.sleep(0.1)
                 continue
+            if remaining is not None:
+                remaining -= struct_size
             yield struct_unpack.unpack(data)
 
+
 if __name__ == '__main__':
-    # 只有一个参数即 bin 的路径
-    if len(sys.argv) != 2:
-        print("Usage: python analyze_bin.py <bin_path>")
-        sys.exit(1)
-    bin_path = sys.argv[1]
-    for data in analyze_bin(bin_path):
-        timestamp, a, b, c, d, e, f, g, h, i, j = data
-        ms = int(timestamp % 1_000_000 / 1_000)
-        timestamp = time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(timestamp / 1_000_000)) + f".{ms:03d}"
-        print(timestamp, a, b, c, d, e, f, g, h, i, j)
+    parser = argparse.ArgumentParser()
+    parser.add_argument("bin_path")
+    parser.add_argument("--no-follow", action="store_true", help="读到文件末尾后退出")
+    args = parser.parse_args()
+
+    records = analyze_bin(args.bin_path, follow=not args.no_follow)
+    names = next(records)
+    print(*names)
+    ts_index = names.index("timestamp") if "timestamp" in names else None
+    for data in records:
+        data = list(data)
+        if ts_index is not None:
+            timestamp = data[ts_index]
+            ms = int(timestamp % 1_000_000 / 1_000)
+            data[ts_index] = time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(timestamp / 1_000_000)) + f".{ms:03d}"
+        print(*data)
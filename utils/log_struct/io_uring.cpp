@@ -0,0 +1,153 @@
+#include "io_uring.hpp"
+
+#if UTILS_LOG_STRUCT_HAS_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+namespace utils {
+
+namespace {
+template <typename T>
+T* offsetPtr(void* base, std::uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<std::byte*>(base) + offset);
+}
+}  // namespace
+
+IoUring::IoUring(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0)
+        return;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        ::close(fd);
+        return;
+    }
+
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            ::munmap(sq_ring_, sq_ring_size_);
+            sq_ring_ = nullptr;
+            ::close(fd);
+            return;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_ring_ != sq_ring_)
+            ::munmap(cq_ring_, cq_ring_size_);
+        ::munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = cq_ring_ = nullptr;
+        ::close(fd);
+        return;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_  = offsetPtr<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_  = offsetPtr<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_  = offsetPtr<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = offsetPtr<unsigned>(sq_ring_, params.sq_off.array);
+    cq_head_  = offsetPtr<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_  = offsetPtr<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_  = offsetPtr<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_     = offsetPtr<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+
+    sq_entries_ = params.sq_entries;
+    sqe_tail_   = *sq_tail_;
+    ring_fd_    = fd;
+}
+
+IoUring::~IoUring() {
+    if (ring_fd_ < 0)
+        return;
+    ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_)
+        ::munmap(cq_ring_, cq_ring_size_);
+    ::munmap(sq_ring_, sq_ring_size_);
+    ::close(ring_fd_);
+}
+
+bool IoUring::registerBuffers(const iovec* iovecs, unsigned count) {
+    return ::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iovecs, count) ==
+           0;
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+    if (sqe_tail_ - head >= sq_entries_)
+        return nullptr;
+
+    unsigned index   = sqe_tail_ & *sq_mask_;
+    sq_array_[index] = index;
+    ++sqe_tail_;
+    ++to_submit_;
+
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned wait_nr) {
+    // 发布 SQ 尾部，内核在 io_uring_enter 中消费
+    std::atomic_ref<unsigned>(*sq_tail_).store(sqe_tail_, std::memory_order_release);
+
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+        long ret =
+            ::syscall(__NR_io_uring_enter, ring_fd_, to_submit_, wait_nr, flags, nullptr, 0);
+        if (ret >= 0) {
+            to_submit_ -= std::min<unsigned>(to_submit_, static_cast<unsigned>(ret));
+            return static_cast<int>(ret);
+        }
+        if (errno != EINTR) {
+            // 提交失败时内核没有消费任何 SQE，回退尾部避免下次调用时被重复提交
+            int error = errno;
+            sqe_tail_ -= to_submit_;
+            to_submit_ = 0;
+            std::atomic_ref<unsigned>(*sq_tail_).store(sqe_tail_, std::memory_order_release);
+            return -error;
+        }
+    }
+}
+
+bool IoUring::popCqe(io_uring_cqe& cqe) {
+    unsigned head = *cq_head_;
+    if (head == std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire))
+        return false;
+
+    cqe = cqes_[head & *cq_mask_];
+    std::atomic_ref<unsigned>(*cq_head_).store(head + 1, std::memory_order_release);
+    return true;
+}
+
+}  // namespace utils
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define UTILS_LOG_STRUCT_HAS_IO_URING 1
+#else
+#define UTILS_LOG_STRUCT_HAS_IO_URING 0
+#endif
+
+namespace utils {
+
+#if UTILS_LOG_STRUCT_HAS_IO_URING
+
+// 基于 io_uring 系统调用的最小封装，只提供 LogStruct 写线程需要的功能：
+// 注册固定缓冲区、批量提交 SQE、等待并收割 CQE。只允许单线程使用
+class IoUring {
+   public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&)            = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // 内核不支持或被禁用（ENOSYS/EPERM）时返回 false
+    bool valid() const { return ring_fd_ >= 0; }
+
+    // 注册固定缓冲区，之后可以使用 IORING_OP_WRITE_FIXED
+    bool registerBuffers(const iovec* iovecs, unsigned count);
+
+    // 获取一个已清零的 SQE，SQ 已满时返回 nullptr
+    io_uring_sqe* getSqe();
+
+    // 提交所有已获取的 SQE，并等待至少 wait_nr 个完成事件；返回提交数量，
+    // 失败返回 -errno，此时未提交的 SQE 会被丢弃
+    int submitAndWait(unsigned wait_nr);
+
+    // 取出一个完成事件，没有时返回 false
+    bool popCqe(io_uring_cqe& cqe);
+
+   private:
+    int      ring_fd_    = -1;
+    unsigned sq_entries_ = 0;
+
+    void*       sq_ring_      = nullptr;
+    void*       cq_ring_      = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+
+    io_uring_sqe* sqes_      = nullptr;
+    std::size_t   sqes_size_ = 0;
+    unsigned      sqe_tail_  = 0;  // 本地维护的 SQ 尾部，提交时写回共享内存
+    unsigned      to_submit_ = 0;
+
+    unsigned* sq_head_  = nullptr;
+    unsigned* sq_tail_  = nullptr;
+    unsigned* sq_mask_  = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_  = nullptr;
+    unsigned* cq_tail_  = nullptr;
+    unsigned* cq_mask_  = nullptr;
+
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+#endif
+
+}  // namespace utils
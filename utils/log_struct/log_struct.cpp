@@ -1,125 +1,1188 @@
 #include "log_struct.hpp"
 
+#include <sys/mman.h>
+
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "io_uring.hpp"
+#include "log_struct_index.hpp"
 
 namespace utils {
 LogStruct::LogStruct(const std::string& log_path, std::size_t struct_size, std::size_t reverse_size,
-                     std::size_t polling_interval)
+                     std::size_t polling_interval, const LogStructOptions& options)
+    : LogStruct(log_path, struct_size, reverse_size, polling_interval, options, false) {}
+
+LogStruct::LogStruct(const std::string& log_path, std::size_t struct_size, std::size_t reverse_size,
+                     std::size_t polling_interval, const LogStructOptions& options, bool framed)
     : log_path_(log_path),
       struct_size_(struct_size),
       byte_size_(struct_size * reverse_size),
       polling_interval_(polling_interval),
-      raw_buffer1_(new std::byte[byte_size_ + 1024]),  // 多分一点 Buffer 给 Vector 内部开销
-      raw_buffer2_(new std::byte[byte_size_ + 1024]),
-      pool1_(raw_buffer1_, byte_size_ + 1024),
-      pool2_(raw_buffer2_, byte_size_ + 1024),
-      vector1_(&pool1_),
-      vector2_(&pool2_) {
-    fd_ = ::open(log_path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0666);
+      producer_mode_(options.producer_mode),
+      buffer_count_(options.backend == LogStructBackend::kMmap
+                        ? 1
+                        : std::max<std::size_t>(options.buffer_count, 2)),
+      backend_(options.backend),
+      sync_after_batch_(options.sync_after_batch),
+      framed_(framed),
+      overflow_(framed && options.overflow == LogStructOverflow::kDropActiveBuffer
+                    ? LogStructOverflow::kDropNewest
+                    : options.overflow),
+      block_timeout_(options.block_timeout),
+      clock_(options.clock),
+      raw_buffer_(nullptr),
+      buffers_(new Buffer[buffer_count_]),
+      durability_(options.backend == LogStructBackend::kMmap ? LogStructDurability::kNone
+                                                              : options.durability),
+      sync_interval_(options.sync_interval),
+      sync_bytes_(options.sync_bytes),
+      dirty_window_(options.dirty_window),
+      histograms_(options.metrics ? std::make_unique<Histograms>() : nullptr),
+      fields_(options.fields),
+      index_stride_(framed ? 0 : options.index_stride),
+      codec_(options.backend == LogStructBackend::kMmap || framed ? LogStructCodec::kNone
+                                                                  : options.codec),
+      rotating_(options.backend != LogStructBackend::kMmap &&
+                (options.rotate_bytes > 0 || options.rotate_interval.count() > 0)),
+      rotate_bytes_(options.rotate_bytes),
+      rotate_interval_(options.rotate_interval),
+      retention_count_(options.retention_count),
+      retention_bytes_(options.retention_bytes) {
+    openSegments();
+
+    // 各后端都按显式偏移写入，文件头也要原地更新（O_APPEND 下 pwrite 会追加到末尾）
+    fd_ = ::open(segment_path_.c_str(), O_RDWR | O_CREAT, 0666);
     if (fd_ == -1)
         throw std::runtime_error("Open failed");
+    file_offset_ = ::lseek(fd_, 0, SEEK_END);
+    openHeader();
+    setupIndex(index_stride_);
+    writeback_begin_ = writeback_done_ = file_offset_;
+    last_sync_                         = std::chrono::steady_clock::now();
+    if (codec_ != LogStructCodec::kNone) {
+        columns_ = planLogStructColumns(struct_size_, fields_, file_header_.timestamp_field);
+        encoded_.resize(buffer_count_);
+    }
+    if (overflow_ == LogStructOverflow::kSpill)
+        openSpill();
 
-    vector1_.reserve(byte_size_);
-    vector2_.reserve(byte_size_);
+    if (backend_ == LogStructBackend::kMmap) {
+        setupMmap(options.mmap_segment_size);
+    } else {
+        raw_buffer_ = new std::byte[byte_size_ * buffer_count_];
+        for (std::size_t i = 0; i < buffer_count_; ++i) {
+            buffers_[i].data = raw_buffer_ + i * byte_size_;
+        }
+        if (backend_ == LogStructBackend::kIoUring)
+            setupIoUring();
+    }
 
-    current_vector_.store(&vector1_);
-    next_vector_.store(&vector2_);
-    last_write_time_ = std::chrono::system_clock::now();
+    buffers_[0].reserved.store(0);
+    current_buffer_.store(&buffers_[0]);
+    last_switch_time_.store(std::chrono::steady_clock::now());
 
-    write_thread_ = std::jthread([this](std::stop_token st) { writeToFile(st); });
+    if (backend_ == LogStructBackend::kMmap) {
+        write_thread_ = std::jthread([this](std::stop_token st) { syncMappedFile(st); });
+    } else {
+        write_thread_ = std::jthread([this](std::stop_token st) { writeToFile(st); });
+    }
+    if (rotating_) {
+        segment_deadline_ = std::chrono::system_clock::time_point(
+                                std::chrono::microseconds(file_header_.clock_base_us)) +
+                            rotate_interval_;
+        segment_thread_ = std::jthread([this](std::stop_token st) { manageSegments(st); });
+    }
 }
 
 LogStruct::~LogStruct() {
-    // 1. 停止接收新数据
-    is_running_.store(false);
+    // 1. 等待出现空闲缓冲区后强制触发最后一轮写入。析构时不能再有并发的写入调用
+    if (backend_ != LogStructBackend::kMmap) {
+        while (!swapBuffers()) {
+            std::this_thread::yield();
+        }
+    }
 
-    // 2. 强制触发最后一轮写入
-    flush();
+    // 2. 通知写线程退出并等待其写完所有待写缓冲区，之后才能释放 fd 和缓冲区
+    write_thread_.request_stop();
+    notifyWriter();
+    if (write_thread_.joinable()) {
+        write_thread_.join();
+    }
+    // 关闭已切换走的段，删除未使用的预分配段
+    if (segment_thread_.joinable()) {
+        segment_thread_.request_stop();
+        segment_thread_.join();
+    }
 
-    // 3. jthread 析构会自动发送 stop 信号并 join
-    if (fd_ != -1) {
-        ::fsync(fd_);
+    if (backend_ == LogStructBackend::kMmap) {
+        // 截掉预分配但未使用的部分
+        std::size_t published = buffers_[0].committed.load(std::memory_order_acquire);
+        ::msync(mmap_base_, mmap_length_, MS_SYNC);
+        ::munmap(mmap_base_, mmap_length_);
+        ::ftruncate(fd_, file_offset_ + static_cast<off_t>(published));
+        updateHeader(0, 0);
+    } else {
+        delete[] raw_buffer_;
+    }
+
+    ::fsync(fd_);
+    updateCheckpoint();
+    ::close(fd_);
+    if (spill_fd_ != -1) {
+        ::fsync(spill_fd_);
+        ::close(spill_fd_);
+    }
+    io_uring_.reset();
+    index_.reset();
+}
+
+std::uint32_t LogStruct::headerFlags() const {
+    return (codec_ != LogStructCodec::kNone ? kLogStructFlagBlocks : 0) |
+           (framed_ ? kLogStructFlagFramed : 0);
+}
+
+void LogStruct::openHeader() {
+    std::uint32_t flags = headerFlags();
+    if (file_offset_ == 0) {
+        auto header = buildLogStructHeader(struct_size_, fields_, flags);
+        if (!writeFully(header.data(), header.size(), 0)) {
+            ::close(fd_);
+            throw std::runtime_error("Write header failed");
+        }
+        header_size_    = header.size();
+        file_offset_    = static_cast<off_t>(header_size_);
+        logical_offset_ = header_size_;
+        std::memcpy(&file_header_, header.data(), sizeof(file_header_));
+        return;
+    }
+
+    LogStructFileHeader header;
+    if (::pread(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        ::close(fd_);
+        throw std::runtime_error("Read header failed");
+    }
+    auto error = validateLogStructHeader(header, static_cast<std::size_t>(file_offset_));
+    if (error.empty() && header.record_size != struct_size_)
+        error = std::format("record size {} != {}", header.record_size, struct_size_);
+    if (error.empty() && (header.flags & (kLogStructFlagBlocks | kLogStructFlagFramed)) != flags)
+        error = "codec or framing mismatch";
+    if (error.empty())
+        error = openFields(header);
+    if (!error.empty()) {
         ::close(fd_);
+        throw std::runtime_error("Invalid header: " + error);
+    }
+    header_size_ = header.header_size;
+    file_header_ = header;
+
+    // 上一次 mmap 写入异常退出：截掉预分配但未发布的部分后再追加
+    if (header.flags & kLogStructFlagPreallocated) {
+        file_offset_ =
+            std::min<off_t>(file_offset_, static_cast<off_t>(header_size_ + header.data_size));
+        file_offset_ -= (file_offset_ - static_cast<off_t>(header_size_)) %
+                        static_cast<off_t>(struct_size_);
+        ::ftruncate(fd_, file_offset_);
+        updateHeader(0, 0);
+    }
+    if (flags & kLogStructFlagBlocks) {
+        recoverBlocks();
+        return;
     }
-    delete[] raw_buffer1_;
-    delete[] raw_buffer2_;
+    // 上一次写入中途退出：截掉末尾不完整的帧或记录后再追加，否则之后写入的数据都会错位
+    auto  begin = static_cast<off_t>(header_size_);
+    off_t end   = flags & kLogStructFlagFramed
+                      ? completeFrames(fd_, begin, file_offset_)
+                      : file_offset_ - (file_offset_ - begin) % static_cast<off_t>(struct_size_);
+    if (end != file_offset_) {
+        file_offset_ = end;
+        ::ftruncate(fd_, file_offset_);
+    }
+    logical_offset_ = static_cast<std::uint64_t>(file_offset_);
+}
+
+std::string LogStruct::openFields(const LogStructFileHeader& header) {
+    std::vector<LogStructFieldDesc> descs(header.field_count);
+    auto                            size = descs.size() * sizeof(LogStructFieldDesc);
+    if (::pread(fd_, descs.data(), size, sizeof(header)) != static_cast<ssize_t>(size))
+        return "read fields failed";
+
+    std::vector<LogStructField> fields;
+    fields.reserve(descs.size());
+    for (const auto& desc : descs) {
+        fields.push_back({std::string(desc.name, strnlen(desc.name, sizeof(desc.name))),
+                          static_cast<FieldType>(desc.type), desc.offset, desc.size,
+                          desc.schema});
+    }
+    // 没有给出字段时沿用文件中的字段；给出时必须一致（名字按文件中的长度截断后比较）
+    if (!fields_.empty()) {
+        auto same = [](const LogStructField& lhs, const LogStructField& rhs) {
+            return lhs.name.substr(0, kLogStructFieldNameSize - 1) == rhs.name &&
+                   lhs.type == rhs.type && lhs.offset == rhs.offset && lhs.size == rhs.size &&
+                   lhs.schema == rhs.schema;
+        };
+        if (!std::equal(fields_.begin(), fields_.end(), fields.begin(), fields.end(), same))
+            return "field mismatch";
+    }
+    fields_ = std::move(fields);
+    return {};
+}
+
+off_t LogStruct::completeFrames(int fd, off_t begin, off_t end) {
+    LogStructFrameHeader frame;
+    while (begin + static_cast<off_t>(sizeof(frame)) <= end &&
+           ::pread(fd, &frame, sizeof(frame), begin) == static_cast<ssize_t>(sizeof(frame))) {
+        off_t next = begin + static_cast<off_t>(logStructFrameSize(frame.size));
+        if (next > end)
+            break;
+        begin = next;
+    }
+    return begin;
+}
+
+void LogStruct::recoverBlocks() {
+    auto                   end = static_cast<std::uint64_t>(file_offset_);
+    std::vector<std::byte> payload;
+    // 读取 offset 处的块头，合法时返回 true
+    auto read_header = [&](std::uint64_t offset, LogStructBlockHeader& block) {
+        return ::pread(fd_, &block, sizeof(block), static_cast<off_t>(offset)) ==
+                   static_cast<ssize_t>(sizeof(block)) &&
+               validLogStructBlock(block, offset, end);
+    };
+    // 读取 offset 处的块，块头合法且 CRC 一致时返回 true
+    auto read_block = [&](std::uint64_t offset, LogStructBlockHeader& block) {
+        if (!read_header(offset, block))
+            return false;
+        payload.resize(block.payload_size);
+        return ::pread(fd_, payload.data(), payload.size(),
+                       static_cast<off_t>(offset + sizeof(block))) ==
+                   static_cast<ssize_t>(payload.size()) &&
+               checkLogStructBlock(block, payload.data());
+    };
+
+    // checkpoint 之前的块已经同步到磁盘，只需检查之后写出的块
+    std::uint64_t        offset  = header_size_;
+    std::uint64_t        records = 0;
+    LogStructBlockHeader block;
+    std::uint64_t        checkpoint = file_header_.checkpoint;
+    if (checkpoint >= header_size_ && read_block(checkpoint, block)) {
+        last_block_ = checkpoint;
+        offset      = checkpoint + sizeof(block) + block.payload_size;
+        records     = block.sequence + block.record_count;
+    }
+    // 先沿块头按长度和序号找到连续的块，不读负载
+    std::vector<std::uint64_t> blocks;
+    while (read_header(offset, block) && block.sequence == records) {
+        blocks.push_back(offset);
+        offset += sizeof(block) + block.payload_size;
+        records += block.record_count;
+    }
+    // 再校验尾部的 CRC。定期同步时 checkpoint 之后的块掉电时都可能只落盘了一部分，逐块校验；
+    // 否则 checkpoint 在运行期间不前进，也不保证掉电后的数据，
+    // 进程崩溃时只有仍在写入的最后几块（不超过 buffer_count）可能不完整
+    bool        periodic = durability_ == LogStructDurability::kPeriodic || sync_after_batch_;
+    std::size_t verify   = periodic ? blocks.size() : std::min(blocks.size(), buffer_count_);
+    for (std::size_t i = blocks.size() - verify; i < blocks.size(); ++i) {
+        if (!read_block(blocks[i], block)) {
+            offset  = blocks[i];
+            records = block.sequence;
+            blocks.resize(i);
+            break;
+        }
+    }
+    if (!blocks.empty())
+        last_block_ = blocks.back();
+
+    // 上一次写入中途退出：截掉不完整或损坏的块后再追加
+    if (offset != end) {
+        file_offset_ = static_cast<off_t>(offset);
+        ::ftruncate(fd_, file_offset_);
+    }
+    logical_offset_ = header_size_ + records * struct_size_;
+}
+
+void LogStruct::catchUpIndex() {
+    if (!index_)
+        return;
+    if (codec_ == LogStructCodec::kNone) {
+        index_->catchUp(fd_, static_cast<std::uint64_t>(file_offset_));
+        return;
+    }
+
+    // 逐块解码 sidecar 尚未覆盖的部分
+    index_->trim(logical_offset_);
+    std::uint64_t          offset  = header_size_;
+    std::uint64_t          logical = header_size_;
+    std::vector<std::byte> payload, records;
+    LogStructBlockHeader   block;
+    while (offset < static_cast<std::uint64_t>(file_offset_) &&
+           ::pread(fd_, &block, sizeof(block), static_cast<off_t>(offset)) ==
+               static_cast<ssize_t>(sizeof(block))) {
+        std::uint64_t block_end = logical + block.record_count * struct_size_;
+        if (block_end > index_->end()) {
+            payload.resize(block.payload_size);
+            records.resize(block.record_count * struct_size_);
+            if (::pread(fd_, payload.data(), payload.size(),
+                        static_cast<off_t>(offset + sizeof(block))) !=
+                    static_cast<ssize_t>(payload.size()) ||
+                !decodeLogStructBlock(columns_, struct_size_, block, payload.data(),
+                                      records.data()))
+                break;
+            std::uint64_t from = index_->end();
+            index_->append(records.data() + (from - logical), block_end - from, from);
+        }
+        offset += sizeof(block) + block.payload_size;
+        logical = block_end;
+    }
+}
+
+std::pair<const std::byte*, std::size_t> LogStruct::encodeBuffer(std::size_t   index,
+                                                                 const Buffer* buffer,
+                                                                 std::size_t   size) {
+    if (codec_ == LogStructCodec::kNone || size == 0)
+        return {buffer->data, size};
+    auto& out = encoded_[index];
+    out.clear();
+    encodeLogStructBlock(codec_, columns_, struct_size_, buffer->data, size / struct_size_,
+                         (logical_offset_ - header_size_) / struct_size_, out);
+    return {out.data(), out.size()};
+}
+
+void LogStruct::openSpill() {
+    std::string path = log_path_ + kLogStructSpillSuffix;
+    spill_fd_        = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0666);
+    if (spill_fd_ == -1) {
+        ::close(fd_);
+        throw std::runtime_error("Open spill failed");
+    }
+
+    std::string error;
+    auto        size = static_cast<std::size_t>(::lseek(spill_fd_, 0, SEEK_END));
+    // 溢出文件不编码，帧模式下同样由帧组成
+    std::uint32_t flags = framed_ ? kLogStructFlagFramed : 0;
+    if (size == 0) {
+        auto header = buildLogStructHeader(struct_size_, fields_, flags);
+        if (::write(spill_fd_, header.data(), header.size()) !=
+            static_cast<ssize_t>(header.size()))
+            error = "write header failed";
+    } else {
+        LogStructFileHeader header;
+        if (::pread(spill_fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+            error = "read header failed";
+        if (error.empty())
+            error = validateLogStructHeader(header, size);
+        if (error.empty() && (header.record_size != struct_size_ || header.flags != flags))
+            error = "record size or flags mismatch";
+        // 截掉上一次中途退出留下的不完整记录
+        if (error.empty() && framed_)
+            ::ftruncate(spill_fd_, completeFrames(spill_fd_, header.header_size,
+                                                  static_cast<off_t>(size)));
+        else if (error.empty())
+            ::ftruncate(spill_fd_, static_cast<off_t>(
+                                       size - (size - header.header_size) % struct_size_));
+    }
+    if (!error.empty()) {
+        ::close(spill_fd_);
+        ::close(fd_);
+        throw std::runtime_error("Invalid spill: " + error);
+    }
+}
+
+void LogStruct::setupIndex(std::size_t stride) {
+    if (stride == 0 || file_header_.timestamp_field == kLogStructNoTimestamp)
+        return;
+
+    LogStructFieldDesc desc;
+    off_t              desc_offset = static_cast<off_t>(
+        sizeof(LogStructFileHeader) + file_header_.timestamp_field * sizeof(LogStructFieldDesc));
+    if (::pread(fd_, &desc, sizeof(desc), desc_offset) != static_cast<ssize_t>(sizeof(desc)) ||
+        desc.size != sizeof(std::int64_t))
+        return;
+
+    // 索引只是辅助数据，sidecar 打不开时不影响写入
+    auto index = std::make_unique<LogStructIndexWriter>(segment_path_ + kLogStructIndexSuffix,
+                                                        file_header_, desc.offset, stride);
+    if (index->valid())
+        index_ = std::move(index);
+}
+
+void LogStruct::updateHeader(std::uint32_t flags, std::uint64_t data_size) {
+    flags |= headerFlags();
+    ::pwrite(fd_, &data_size, sizeof(data_size), offsetof(LogStructFileHeader, data_size));
+    ::pwrite(fd_, &flags, sizeof(flags), offsetof(LogStructFileHeader, flags));
+}
+
+void LogStruct::setupMmap(std::size_t segment_size) {
+    auto page = static_cast<off_t>(::sysconf(_SC_PAGESIZE));
+    segment_size -= segment_size % struct_size_;
+
+    // 映射起点必须按页对齐，已有数据之后的部分才是本次的段
+    mmap_offset_ = file_offset_ - file_offset_ % page;
+    mmap_length_ = static_cast<std::size_t>(file_offset_ - mmap_offset_) + segment_size;
+
+    if (::posix_fallocate(fd_, file_offset_, static_cast<off_t>(segment_size)) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Fallocate failed");
+    }
+    mmap_base_ =
+        ::mmap(nullptr, mmap_length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, mmap_offset_);
+    if (mmap_base_ == MAP_FAILED) {
+        ::ftruncate(fd_, file_offset_);
+        ::close(fd_);
+        throw std::runtime_error("Mmap failed");
+    }
+
+    raw_buffer_      = static_cast<std::byte*>(mmap_base_) + (file_offset_ - mmap_offset_);
+    byte_size_       = segment_size;
+    buffers_[0].data = raw_buffer_;
+
+    // 运行期间文件末尾是预分配的全零区域，读者以 data_size 为准
+    updateHeader(kLogStructFlagPreallocated, file_offset_ - header_size_);
+}
+
+void LogStruct::setupIoUring() {
+#if UTILS_LOG_STRUCT_HAS_IO_URING
+    // 每块缓冲区一个写 SQE，外加一个 fdatasync
+    unsigned entries = 1;
+    while (entries < buffer_count_ + 1) entries <<= 1;
+
+    auto ring = std::make_unique<IoUring>(entries);
+    if (ring->valid()) {
+        std::vector<iovec> iovecs(buffer_count_);
+        for (std::size_t i = 0; i < buffer_count_; ++i) {
+            iovecs[i].iov_base = buffers_[i].data;
+            iovecs[i].iov_len  = byte_size_;
+        }
+        // 注册失败（如超出 RLIMIT_MEMLOCK）时使用普通的 IORING_OP_WRITE
+        fixed_buffers_ = ring->registerBuffers(iovecs.data(), static_cast<unsigned>(iovecs.size()));
+        io_uring_      = std::move(ring);
+        return;
+    }
+#endif
+    // 不可用时回退到 write，实际使用的后端见 stats().backend
+    backend_ = LogStructBackend::kWrite;
 }
 
 bool LogStruct::flush() {
-    if (is_writing_.load(std::memory_order_relaxed)) {
-        std::cerr << "flush while writing" << std::endl;
+    ScopedLatency latency(histograms_ ? &histograms_->flush : nullptr);
+    // 没有空闲缓冲区时计入 failed_flushes
+    return swapBuffers();
+}
+
+bool LogStruct::swapBuffers() {
+    // 多个生产者可能同时触发切换，只有一个能成功
+    bool expected = false;
+    if (!is_switching_.compare_exchange_strong(expected, true, std::memory_order_acq_rel,
+                                               std::memory_order_relaxed)) {
+        return false;
+    }
+
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    std::size_t used = head + 1 - tail_.load(std::memory_order_acquire);
+    if (used >= buffer_count_) {
+        // 所有缓冲区都在等待写入，继续使用当前缓冲区
+        failed_flushes_.fetch_add(1, std::memory_order_relaxed);
+        is_switching_.store(false, std::memory_order_release);
         return false;
     }
 
-    is_writing_.store(true, std::memory_order_relaxed);
+    // 打开下一块空闲缓冲区并发布为活动缓冲区
+    switch_version_.fetch_add(1, std::memory_order_acq_rel);
+    auto old_current = &buffers_[head % buffer_count_];
+    auto new_current = &buffers_[(head + 1) % buffer_count_];
+    new_current->reserved.store(0, std::memory_order_release);
+    current_buffer_.store(new_current, std::memory_order_release);
 
-    // 手动触发 Ping-Pong 切换
-    // is_switching_.store(true, std::memory_order_seq_cst);
-    auto old_current = current_vector_.load(std::memory_order_relaxed);
-    auto old_next    = next_vector_.load(std::memory_order_relaxed);
+    // 封存旧缓冲区：之后在其上的预留都会失败并转到新缓冲区，
+    // 写线程只需等待封存前已预留的记录提交完成
+    std::size_t end = old_current->reserved.fetch_add(kSealed, std::memory_order_acq_rel);
+    old_current->sealed_size.store(std::min(end, byte_size_), std::memory_order_release);
+    old_current->end_seq = base_seq_.load(std::memory_order_relaxed) +
+                           std::min(end, byte_size_) / struct_size_;
+    base_seq_.store(old_current->end_seq, std::memory_order_relaxed);
+    switch_version_.fetch_add(1, std::memory_order_release);
 
-    current_vector_.store(old_next, std::memory_order_relaxed);
-    next_vector_.store(old_current, std::memory_order_relaxed);
-    // is_switching_.store(false, std::memory_order_release);
+    head_.store(head + 1);
+    if (used + 1 > high_water_buffers_.load(std::memory_order_relaxed)) {
+        high_water_buffers_.store(used + 1, std::memory_order_relaxed);
+    }
+    flush_requested_.store(false, std::memory_order_relaxed);
+    last_switch_time_.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+    is_switching_.store(false, std::memory_order_release);
 
-    has_data_to_write.test_and_set(std::memory_order_release);
-    has_data_to_write.notify_one();
+    notifyWriter();
 
     return true;
 }
 
-bool LogStruct::write(const std::byte* data) {
-    // if (is_switching_.load(std::memory_order_acquire)) {
-    //     std::cerr << "write while switching" << std::endl;
-    //     return false;
-    // }
+void LogStruct::padTail(Buffer* buffer, std::size_t offset) {
+    if (!framed_ || producer_mode_ != ProducerMode::kMulti || offset >= byte_size_)
+        return;
+    LogStructFrameHeader padding;
+    padding.type = kLogStructPaddingFrame;
+    padding.size = static_cast<std::uint32_t>(byte_size_ - offset - sizeof(padding));
+    std::memcpy(buffer->data + offset, &padding, sizeof(padding));
+    commit(buffer, buffer->data + offset, byte_size_ - offset);
+}
+
+std::byte* LogStruct::acquireSlotSlow(std::size_t size, Buffer*& buffer, std::size_t offset) {
+    padTail(buffer, offset);
+    // 比整块缓冲区还大的帧永远放不下
+    if (size > byte_size_) [[unlikely]] {
+        dropped_records_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // mmap 后端只有一个段，切换、等待和复用都无法腾出空间
+    bool mmap   = backend_ == LogStructBackend::kMmap;
+    auto policy = mmap && overflow_ != LogStructOverflow::kSpill ? LogStructOverflow::kDropNewest
+                                                                 : overflow_;
+    std::chrono::steady_clock::time_point deadline{};
+    while (true) {
+        if (!mmap)
+            swapBuffers();
+        buffer = current_buffer_.load(std::memory_order_acquire);
+        offset = reserve(buffer, size);
+        if (offset + size <= byte_size_)
+            return buffer->data + offset;
+        padTail(buffer, offset);
+
+        if (policy == LogStructOverflow::kBlock) {
+            if (deadline == std::chrono::steady_clock::time_point{}) {
+                blocked_writes_.fetch_add(1, std::memory_order_relaxed);
+                deadline = block_timeout_.count() > 0
+                               ? std::chrono::steady_clock::now() + block_timeout_
+                               : std::chrono::steady_clock::time_point::max();
+            }
+            if (waitForSpace(deadline))
+                continue;
+            block_timeouts_.fetch_add(1, std::memory_order_relaxed);
+        } else if (policy == LogStructOverflow::kDropActiveBuffer) {
+            // 其他生产者正在切换或复用时稍后重试
+            if (!recycleCurrent())
+                std::this_thread::yield();
+            continue;
+        }
+        break;
+    }
+    if (policy != LogStructOverflow::kSpill)
+        dropped_records_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+bool LogStruct::waitForSpace(std::chrono::steady_clock::time_point deadline) {
+    auto has_space = [this] { return head_.load() + 1 - tail_.load() < buffer_count_; };
+    std::unique_lock lock(space_mutex_);
+    // 先登记再检查条件，与 notifySpace 中先推进 tail_ 再读取 space_waiters_ 配对，不会漏掉唤醒
+    space_waiters_.fetch_add(1);
+    bool ready = deadline == std::chrono::steady_clock::time_point::max()
+                     ? (space_cv_.wait(lock, has_space), true)
+                     : space_cv_.wait_until(lock, deadline, has_space);
+    space_waiters_.fetch_sub(1);
+    return ready;
+}
+
+void LogStruct::notifySpace() {
+    if (space_waiters_.load() == 0)
+        return;
+    std::lock_guard lock(space_mutex_);
+    space_cv_.notify_all();
+}
+
+bool LogStruct::recycleCurrent() {
+    bool expected = false;
+    if (!is_switching_.compare_exchange_strong(expected, true, std::memory_order_acq_rel,
+                                               std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // 写线程已经归还了缓冲区，交给下一轮 swapBuffers
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head + 1 - tail_.load(std::memory_order_acquire) < buffer_count_) {
+        is_switching_.store(false, std::memory_order_release);
+        return true;
+    }
+
+    // 与 swapBuffers 相同地封存活动缓冲区，等封存前已预留的记录提交后整块清空重新打开
+    switch_version_.fetch_add(1, std::memory_order_acq_rel);
+    Buffer*     current = &buffers_[head % buffer_count_];
+    std::size_t end     = current->reserved.fetch_add(kSealed, std::memory_order_acq_rel);
+    std::size_t size    = std::min(end, byte_size_);
+    while (current->committed.load(std::memory_order_acquire) < size) {
+        std::this_thread::yield();
+    }
+    discarded_records_.fetch_add(size / struct_size_, std::memory_order_relaxed);
+    base_seq_.store(base_seq_.load(std::memory_order_relaxed) + size / struct_size_,
+                    std::memory_order_relaxed);
+    current->committed.store(0, std::memory_order_relaxed);
+    current->reserved.store(0, std::memory_order_release);
+    switch_version_.fetch_add(1, std::memory_order_release);
 
-    auto curr = current_vector_.load(std::memory_order_relaxed);
+    is_switching_.store(false, std::memory_order_release);
+    return true;
+}
 
-    if (data) {
-        if (curr->size() + struct_size_ > byte_size_)
+bool LogStruct::spill(const std::byte* data, std::size_t size) {
+    std::lock_guard lock(spill_mutex_);
+    std::size_t     written = 0;
+    while (written < size) {
+        ssize_t result = ::write(spill_fd_, data + written, size - written);
+        if (result < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            dropped_records_.fetch_add(1, std::memory_order_relaxed);
             return false;
-        curr->insert(curr->end(), data, data + struct_size_);
+        }
+        written += static_cast<std::size_t>(result);
     }
+    spilled_records_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
 
-    // 检查时间或容量是否达到阈值
-    auto now = std::chrono::system_clock::now();
-    if (now - last_write_time_ >= std::chrono::milliseconds(polling_interval_) ||
-        curr->size() >= byte_size_) {
-        if (flush()) {
-            last_write_time_ = now;
+bool LogStruct::write(const std::byte* data) {
+    ScopedLatency latency(histograms_ ? &histograms_->write : nullptr);
+    if (!data) {
+        maybeFlush(false);
+        return true;
+    }
+
+    Buffer*    buffer = nullptr;
+    std::byte* slot   = acquireSlot(struct_size_, buffer);
+    if (!slot)
+        return overflow(data, struct_size_);
+
+    std::memcpy(slot, data, struct_size_);
+    publishSlot(buffer, slot, struct_size_);
+    return true;
+}
+
+std::size_t LogStruct::waitCommitted(Buffer* buffer) {
+    std::size_t size = buffer->sealed_size.load(std::memory_order_acquire);
+
+    // 等待封存前已预留的记录全部提交
+    while (buffer->committed.load(std::memory_order_acquire) < size) {
+        std::this_thread::yield();
+    }
+    return size;
+}
+
+void LogStruct::resetBuffer(Buffer* buffer) {
+    buffer->sealed_size.store(kNotSealed, std::memory_order_relaxed);
+    buffer->committed.store(0, std::memory_order_relaxed);
+    buffer->reserved.store(kSealed, std::memory_order_relaxed);
+}
+
+bool LogStruct::writeFully(const std::byte* data, std::size_t size, off_t offset) {
+    constexpr int kWriteRetries = 3;
+
+    std::size_t written_size = 0;
+    int         retries      = 0;
+    while (written_size < size) {
+        ssize_t result = ::pwrite(fd_, data + written_size, size - written_size,
+                                  offset + static_cast<off_t>(written_size));
+        if (result < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            // 其他错误（如 ENOSPC、EIO）退避后重试几次，仍失败时由调用方丢弃整块缓冲区
+            if (retries < kWriteRetries) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1 << retries++});
+                continue;
+            }
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+        written_size += static_cast<std::size_t>(result);
     }
     return true;
 }
 
+void LogStruct::drain(Buffer* buffer) {
+    std::size_t size = waitCommitted(buffer);
+    // 编码在写线程上进行，生产者此时写入其他缓冲区
+    auto index         = static_cast<std::size_t>(buffer - buffers_.get());
+    auto [data, bytes] = encodeBuffer(index, buffer, size);
+    bool written;
+    {
+        ScopedLatency latency(histograms_ ? &histograms_->io : nullptr);
+        written = writeFully(data, bytes, file_offset_);
+    }
+    if (written) {
+        written_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        if (index_)
+            index_->append(buffer->data, size, logical_offset_);
+        if (codec_ != LogStructCodec::kNone && bytes > 0)
+            last_block_ = static_cast<std::uint64_t>(file_offset_);
+        file_offset_ += static_cast<off_t>(bytes);
+        logical_offset_ += size;
+        unsynced_bytes_ += bytes;
+        written_seq_ = buffer->end_seq;
+    } else {
+        loseBuffer(buffer, size);
+    }
+    resetBuffer(buffer);
+}
+
+void LogStruct::loseBuffer(const Buffer* buffer, std::size_t size) {
+    // 文件偏移不前进，截掉写了一半的数据，下一块缓冲区接着写在这里，文件中不留空洞；
+    // 块编码的序号按 logical_offset_ 计算，同样保持连续
+    ::ftruncate(fd_, file_offset_);
+    std::size_t records = size / struct_size_;
+    if (framed_) {
+        records = 0;
+        for (std::size_t offset = 0; offset + sizeof(LogStructFrameHeader) <= size; ++records) {
+            LogStructFrameHeader frame;
+            std::memcpy(&frame, buffer->data + offset, sizeof(frame));
+            offset += logStructFrameSize(frame.size);
+        }
+    }
+    lost_records_.fetch_add(records, std::memory_order_relaxed);
+    // written_seq_ 停在这块之前，下一块写出后越过它
+    reportIoError(written_seq_);
+}
+
+void LogStruct::drainBatch(std::size_t tail, std::size_t head) {
+#if UTILS_LOG_STRUCT_HAS_IO_URING
+    static constexpr std::uint64_t kSyncTag = static_cast<std::uint64_t>(-1);
+
+    struct Pending {
+        Buffer*          buffer;
+        std::size_t      size;     // 编码前的长度
+        const std::byte* data;     // 实际写入的数据，未编码时即 buffer->data
+        std::size_t      bytes;
+        off_t            offset;
+        std::uint64_t    logical;  // 编码前的数据偏移
+    };
+    std::vector<Pending> pendings;
+    pendings.reserve(head - tail);
+
+    // 1. 按顺序为每块缓冲区分配文件偏移并准备写 SQE，开启 fdatasync 时整批链接在一起
+    unsigned submitted = 0;
+    for (std::size_t seq = tail; seq != head; ++seq) {
+        std::size_t index  = seq % buffer_count_;
+        Buffer*     buffer = &buffers_[index];
+        std::size_t size   = waitCommitted(buffer);
+        auto [data, bytes] = encodeBuffer(index, buffer, size);
+        pendings.push_back({buffer, size, data, bytes, file_offset_, logical_offset_});
+        file_offset_ += static_cast<off_t>(bytes);
+        logical_offset_ += size;
+        if (bytes == 0)
+            continue;
+
+        // 编码结果不在注册的固定缓冲区内，使用普通写
+        bool          fixed = fixed_buffers_ && data == buffer->data;
+        io_uring_sqe* sqe   = io_uring_->getSqe();
+        sqe->opcode         = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd             = fd_;
+        sqe->addr           = reinterpret_cast<std::uint64_t>(data);
+        sqe->len            = static_cast<std::uint32_t>(bytes);
+        sqe->off            = static_cast<std::uint64_t>(pendings.back().offset);
+        sqe->buf_index      = static_cast<std::uint16_t>(index);
+        sqe->user_data      = pendings.size() - 1;
+        sqe->flags          = sync_after_batch_ ? IOSQE_IO_LINK : 0;
+        ++submitted;
+    }
+    if (sync_after_batch_ && submitted > 0) {
+        io_uring_sqe* sqe = io_uring_->getSqe();
+        sqe->opcode       = IORING_OP_FSYNC;
+        sqe->fd           = fd_;
+        sqe->fsync_flags  = IORING_FSYNC_DATASYNC;
+        sqe->user_data    = kSyncTag;
+        ++submitted;
+    }
+
+    // 2. 一次 io_uring_enter 提交整批并等待全部完成。提交成功后缓冲区归内核使用，
+    //    必须收割到全部完成事件才能继续
+    std::vector<std::size_t> done(pendings.size(), 0);
+    bool                     synced   = !sync_after_batch_ || submitted == 0;
+    unsigned                 finished = 0;
+    ScopedLatency            latency(histograms_ ? &histograms_->io : nullptr);
+    if (submitted > 0 && io_uring_->submitAndWait(submitted) >= 0) {
+        io_uring_cqe cqe;
+        while (finished < submitted) {
+            if (!io_uring_->popCqe(cqe)) {
+                io_uring_->submitAndWait(1);
+                continue;
+            }
+            ++finished;
+            if (cqe.user_data == kSyncTag) {
+                synced = cqe.res >= 0;
+            } else if (cqe.res > 0) {
+                done[cqe.user_data] = static_cast<std::size_t>(cqe.res);
+            }
+        }
+    }
+
+    // 3. 短写、出错或因链接中断被取消的部分回退到阻塞 pwrite 重试
+    bool retried = false;
+    for (std::size_t i = 0; i < pendings.size(); ++i) {
+        auto& pending = pendings[i];
+        if (done[i] < pending.bytes) {
+            retried = true;
+            if (writeFully(pending.data + done[i], pending.bytes - done[i],
+                           pending.offset + static_cast<off_t>(done[i])))
+                done[i] = pending.bytes;
+        }
+    }
+
+    // 4. 全部完成后才能复位缓冲区并归还给生产者。某块重试后仍失败时文件偏移回退到该块，
+    //    从它开始逐块重新写入，之后的块随之前移，文件中不留空洞
+    std::size_t written = 0;
+    bool        failed  = false;
+    for (std::size_t i = 0; i < pendings.size(); ++i) {
+        auto& pending = pendings[i];
+        if (!failed && done[i] < pending.bytes) {
+            failed          = true;
+            file_offset_    = pending.offset;
+            logical_offset_ = pending.logical;
+        }
+        if (failed) {
+            drain(pending.buffer);
+        } else {
+            written += pending.bytes;
+            if (index_)
+                index_->append(pending.buffer->data, pending.size, pending.logical);
+            if (codec_ != LogStructCodec::kNone && pending.bytes > 0)
+                last_block_ = static_cast<std::uint64_t>(pending.offset);
+            written_seq_ = pending.buffer->end_seq;
+            resetBuffer(pending.buffer);
+        }
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    // 回退后截掉之前写在更后面的块
+    if (failed)
+        ::ftruncate(fd_, file_offset_);
+    written_bytes_.fetch_add(written, std::memory_order_relaxed);
+    unsynced_bytes_ += written;
+    notifySpace();
+    // 整批已经和 fdatasync 一起完成；链接的同步失败、有重试或回退重写的部分时再同步一次
+    if (sync_after_batch_) {
+        if (!synced || retried || failed)
+            synced = ::fdatasync(fd_) == 0;
+        last_sync_ = std::chrono::steady_clock::now();
+        if (synced) {
+            syncs_.fetch_add(1, std::memory_order_relaxed);
+            unsynced_bytes_ = 0;
+            updateCheckpoint();
+            publishDurable(written_seq_);
+        } else {
+            sync_errors_.fetch_add(1, std::memory_order_relaxed);
+            reportIoError(durable_seq_.load(std::memory_order_relaxed));
+        }
+    }
+#else
+    (void)tail;
+    (void)head;
+#endif
+}
+
 void LogStruct::writeToFile(std::stop_token st) {
-    while (!st.stop_requested() || has_data_to_write.test()) {
-        // 等待信号，如果 flag 为 false 则阻塞
-        has_data_to_write.wait(false, std::memory_order_acquire);
-
-        auto target = next_vector_.load();
-
-        if (!target->empty()) {
-            std::size_t need_write_size = target->size();
-            std::size_t written_size    = 0;
-            while (written_size < need_write_size) {
-                ssize_t result =
-                    ::write(fd_, target->data() + written_size, need_write_size - written_size);
-                if (result < 0) {
-                    break;
+    catchUpIndex();
+
+    auto tick = std::chrono::steady_clock::now() + std::chrono::milliseconds(polling_interval_);
+    while (true) {
+        // 等待信号，最晚在下一次检查切换间隔或定期同步的时刻醒来
+        auto deadline = tick;
+        if (durability_ == LogStructDurability::kPeriodic &&
+            written_seq_ != durable_seq_.load(std::memory_order_relaxed))
+            deadline = std::min(deadline, last_sync_ + sync_interval_);
+        waitForData(deadline);
+        // 先清 flag 再读取 head_，之后的切换一定会重新置位 flag
+        has_data_to_write.clear();
+        tick = checkInterval();
+
+        // 按顺序写出所有已封存的缓冲区，开启轮转时每批不跨段
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        std::size_t head;
+        while (tail != (head = head_.load())) {
+            std::size_t end = segmentBatch(tail, head);
+            if (io_uring_) {
+                drainBatch(tail, end);
+                tail = end;
+            } else {
+                while (tail != end) {
+                    drain(&buffers_[tail % buffer_count_]);
+                    tail_.store(++tail, std::memory_order_release);
+                    notifySpace();
                 }
-                written_size += static_cast<std::size_t>(result);
             }
-            target->resize(0);
+            writeback();
+            syncFile(false);
         }
+        // 超时唤醒或 flushAndWait() 请求时没有新的缓冲区，同样需要检查
+        syncFile(sync_after_batch_);
+
+        // 析构时的最后一轮写入完成后退出
+        if (st.stop_requested() && tail == head_.load())
+            break;
+    }
+}
 
-        is_writing_.store(false, std::memory_order_relaxed);
-        has_data_to_write.clear(std::memory_order_release);
+void LogStruct::syncMappedFile(std::stop_token st) {
+    auto        page   = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto*       base   = static_cast<std::byte*>(mmap_base_);
+    std::size_t start  = static_cast<std::size_t>(raw_buffer_ - base);
+    std::size_t synced = 0;
 
-        // 如果是因为退出而进行的最后一轮，在这里跳出
-        if (!is_running_.load(std::memory_order_relaxed) && current_vector_.load()->empty())
+    catchUpIndex();
+
+    while (true) {
+        {
+            std::unique_lock lock(mmap_mutex_);
+            mmap_cv_.wait_for(lock, st, std::chrono::milliseconds(polling_interval_), [this] {
+                std::uint64_t durable = durable_seq_.load(std::memory_order_relaxed);
+                return sync_request_.load() > durable &&
+                       failed_seq_.load(std::memory_order_relaxed) > durable &&
+                       buffers_[0].committed.load(std::memory_order_acquire) / struct_size_ >
+                           durable;
+            });
+        }
+
+        // 对 [synced, published) 覆盖的页发起异步回写，进程崩溃后这部分数据仍在页缓存中
+        std::size_t published = buffers_[0].committed.load(std::memory_order_acquire);
+        if (published > synced) {
+            std::size_t from = start + synced;
+            from -= from % page;
+            std::size_t to = start + published;
+            {
+                ScopedLatency latency(histograms_ ? &histograms_->io : nullptr);
+                ::msync(base + from, to - from, MS_ASYNC);
+                ::sync_file_range(fd_, mmap_offset_ + static_cast<off_t>(from),
+                                  static_cast<off_t>(to - from), SYNC_FILE_RANGE_WRITE);
+            }
+            written_bytes_.fetch_add(published - synced, std::memory_order_relaxed);
+            if (index_)
+                index_->append(raw_buffer_ + synced, published - synced,
+                               static_cast<std::uint64_t>(file_offset_) + synced);
+            synced = published;
+            updateHeader(kLogStructFlagPreallocated,
+                         static_cast<std::size_t>(file_offset_) - header_size_ + published);
+        }
+
+        // flushAndWait() 请求：同步等待已发布区域写回
+        std::uint64_t records = synced / struct_size_;
+        if (sync_request_.load(std::memory_order_acquire) > durable_seq_.load() &&
+            records > durable_seq_.load()) {
+            std::size_t from = start - start % page;
+            if (::msync(base + from, start + synced - from, MS_SYNC) == 0) {
+                syncs_.fetch_add(1, std::memory_order_relaxed);
+                publishDurable(records);
+            } else {
+                sync_errors_.fetch_add(1, std::memory_order_relaxed);
+                reportIoError(durable_seq_.load());
+            }
+        }
+
+        if (st.stop_requested())
             break;
     }
 }
+
+void LogStruct::waitForData(std::chrono::steady_clock::time_point deadline) {
+    if (has_data_to_write.test(std::memory_order_acquire))
+        return;
+
+    // 先登记再检查 flag，与 notifyWriter 中先置位 flag 再读取 writer_waiting_ 配对，不会漏掉唤醒
+    std::unique_lock lock(write_mutex_);
+    writer_waiting_.store(true);
+    write_cv_.wait_until(lock, deadline, [this] { return has_data_to_write.test(); });
+    writer_waiting_.store(false);
+}
+
+void LogStruct::notifyWriter() {
+    has_data_to_write.test_and_set();
+    if (!writer_waiting_.load())
+        return;
+    std::lock_guard lock(write_mutex_);
+    write_cv_.notify_one();
+}
+
+std::chrono::steady_clock::time_point LogStruct::checkInterval() {
+    auto interval = std::chrono::milliseconds(polling_interval_);
+    auto now      = std::chrono::steady_clock::now();
+    auto due      = last_switch_time_.load(std::memory_order_relaxed) + interval;
+    if (now < due)
+        return due;
+
+    // 活动缓冲区为空或正在切换时不需要处理
+    Buffer*     current  = current_buffer_.load(std::memory_order_acquire);
+    std::size_t reserved = current->reserved.load(std::memory_order_relaxed);
+    if (reserved == 0 || reserved >= kSealed)
+        return now + interval;
+
+    // 多生产者模式的预留是 fetch_add，写线程可以直接封存；单生产者模式交给生产者切换
+    if (producer_mode_ == ProducerMode::kMulti)
+        swapBuffers();
+    else
+        flush_requested_.store(true, std::memory_order_relaxed);
+    return now + interval;
+}
+
+void LogStruct::writeback() {
+    if (durability_ != LogStructDurability::kWriteback || file_offset_ == writeback_begin_)
+        return;
+    ::sync_file_range(fd_, writeback_begin_, file_offset_ - writeback_begin_,
+                      SYNC_FILE_RANGE_WRITE);
+    writeback_begin_ = file_offset_;
+
+    // 只等待超出窗口的较早部分，它们的回写通常早已完成
+    auto window = static_cast<off_t>(dirty_window_);
+    if (file_offset_ - writeback_done_ > window) {
+        off_t end = file_offset_ - window;
+        ::sync_file_range(fd_, writeback_done_, end - writeback_done_,
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                              SYNC_FILE_RANGE_WAIT_AFTER);
+        writeback_done_ = end;
+    }
+}
+
+void LogStruct::syncFile(bool force) {
+    std::uint64_t durable = durable_seq_.load(std::memory_order_relaxed);
+    if (written_seq_ == durable)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    bool due = force || sync_request_.load(std::memory_order_acquire) > durable;
+    if (durability_ == LogStructDurability::kPeriodic)
+        due = due || now - last_sync_ >= sync_interval_ ||
+              (sync_bytes_ > 0 && unsynced_bytes_ >= sync_bytes_);
+    if (!due)
+        return;
+
+    bool synced;
+    {
+        ScopedLatency latency(histograms_ ? &histograms_->io : nullptr);
+        synced = ::fdatasync(fd_) == 0;
+    }
+    // 失败时同样推迟到下一个同步时刻重试，避免写线程空转
+    last_sync_ = now;
+    if (!synced) {
+        sync_errors_.fetch_add(1, std::memory_order_relaxed);
+        reportIoError(durable);
+        return;
+    }
+    syncs_.fetch_add(1, std::memory_order_relaxed);
+    unsynced_bytes_ = 0;
+    updateCheckpoint();
+    publishDurable(written_seq_);
+}
+
+void LogStruct::updateCheckpoint() {
+    // 数据已经同步，文件头先于数据落盘的情况不会出现；文件头未落盘时恢复从较早的 checkpoint 开始
+    if (last_block_ == file_header_.checkpoint)
+        return;
+    ::pwrite(fd_, &last_block_, sizeof(last_block_), offsetof(LogStructFileHeader, checkpoint));
+    file_header_.checkpoint = last_block_;
+}
+
+void LogStruct::publishDurable(std::uint64_t seq) {
+    {
+        std::lock_guard lock(durable_mutex_);
+        durable_seq_.store(seq, std::memory_order_release);
+    }
+    durable_cv_.notify_all();
+}
+
+void LogStruct::reportIoError(std::uint64_t seq) {
+    if (seq >= failed_seq_.load(std::memory_order_relaxed))
+        return;
+    {
+        std::lock_guard lock(durable_mutex_);
+        failed_seq_.store(seq, std::memory_order_release);
+    }
+    durable_cv_.notify_all();
+}
+
+std::uint64_t LogStruct::sequence() const {
+    // seqlock：读取期间发生切换时重试
+    while (true) {
+        std::uint64_t version = switch_version_.load(std::memory_order_acquire);
+        if (version % 2 == 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::uint64_t base     = base_seq_.load(std::memory_order_acquire);
+        Buffer*       current  = current_buffer_.load(std::memory_order_acquire);
+        std::size_t   reserved = current->reserved.load(std::memory_order_acquire);
+        if (switch_version_.load(std::memory_order_acquire) == version)
+            return base + std::min(reserved, byte_size_) / struct_size_;
+    }
+}
+
+bool LogStruct::flushAndWait(std::uint64_t seq, std::chrono::milliseconds timeout) {
+    // seq 之前有记录可能因 I/O 错误丢失
+    auto lost = [&] { return seq > failed_seq_.load(std::memory_order_acquire); };
+    if (lost())
+        return false;
+    if (durableSequence() >= seq)
+        return true;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    // 登记请求：写线程看到未满足的请求后立即同步，同时等待的调用方共享这一次同步
+    std::uint64_t requested = sync_request_.load();
+    while (requested < seq && !sync_request_.compare_exchange_weak(requested, seq)) {
+    }
+
+    if (backend_ == LogStructBackend::kMmap) {
+        // 加锁后通知，避免后台线程在检查条件和进入等待之间错过唤醒
+        {
+            std::lock_guard lock(mmap_mutex_);
+        }
+        mmap_cv_.notify_one();
+    } else {
+        // seq 之前的记录可能还在活动缓冲区中，先封存；没有空闲缓冲区时等写线程归还
+        while (base_seq_.load(std::memory_order_acquire) < seq && !swapBuffers()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::yield();
+        }
+        notifyWriter();
+    }
+
+    std::unique_lock lock(durable_mutex_);
+    return durable_cv_.wait_until(lock, deadline,
+                                  [&] { return durableSequence() >= seq || lost(); }) &&
+           !lost();
+}
+
+LogStructStats LogStruct::stats() const {
+    LogStructStats stats;
+    stats.buffer_count       = buffer_count_;
+    stats.high_water_buffers = high_water_buffers_.load(std::memory_order_relaxed);
+    stats.dropped_records    = dropped_records_.load(std::memory_order_relaxed);
+    stats.failed_flushes     = failed_flushes_.load(std::memory_order_relaxed);
+    stats.write_errors       = write_errors_.load(std::memory_order_relaxed);
+    stats.lost_records       = lost_records_.load(std::memory_order_relaxed);
+    stats.rotated_segments   = rotated_segments_.load(std::memory_order_relaxed);
+    stats.delayed_rotations  = delayed_rotations_.load(std::memory_order_relaxed);
+    stats.segment_errors     = segment_errors_.load(std::memory_order_relaxed);
+    stats.backend            = backend_;
+
+    stats.blocked_writes    = blocked_writes_.load(std::memory_order_relaxed);
+    stats.block_timeouts    = block_timeouts_.load(std::memory_order_relaxed);
+    stats.discarded_records = discarded_records_.load(std::memory_order_relaxed);
+    stats.spilled_records   = spilled_records_.load(std::memory_order_relaxed);
+    stats.syncs             = syncs_.load(std::memory_order_relaxed);
+    stats.sync_errors       = sync_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+LogStructMetrics LogStruct::metrics() const {
+    LogStructMetrics metrics;
+    if (histograms_) {
+        metrics.write_latency = histograms_->write.snapshot();
+        metrics.flush_latency = histograms_->flush.snapshot();
+        metrics.io_latency    = histograms_->io.snapshot();
+    }
+    metrics.written_bytes   = written_bytes_.load(std::memory_order_relaxed);
+    metrics.dropped_records = dropped_records_.load(std::memory_order_relaxed);
+    metrics.failed_flushes  = failed_flushes_.load(std::memory_order_relaxed);
+    metrics.write_errors    = write_errors_.load(std::memory_order_relaxed);
+    metrics.time            = std::chrono::steady_clock::now();
+    return metrics;
+}
 }  // namespace utils
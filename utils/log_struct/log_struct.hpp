@@ -1,53 +1,314 @@
+#pragma once
+
 #include <fcntl.h>
 #include <unistd.h>
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
 #include <format>
-#include <iostream>
-#include <memory_resource>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "log_struct_clock.hpp"
+#include "log_struct_codec.hpp"
+#include "log_struct_format.hpp"
+#include "log_struct_index.hpp"
+#include "log_struct_metrics.hpp"
+
 namespace utils {
 
+// 生产者模式
+enum class ProducerMode {
+    kSingle,  // 单线程调用 write
+    kMulti,   // 多线程并发调用 write，通过 fetch_add 在活动缓冲区上预留空间
+};
+
+// 落盘后端
+enum class LogStructBackend {
+    kWrite,    // 写线程阻塞调用 ::write
+    kIoUring,  // 写线程通过 io_uring 批量提交，内核不支持时回退到 kWrite
+    kMmap,     // 预分配段文件并 mmap，生产者直接拷贝进映射，后台线程异步回写
+};
+
+// 没有空闲缓冲区时新记录的处理策略
+enum class LogStructOverflow {
+    kDropNewest,  // 丢弃新记录，write() 返回 false
+    kBlock,       // 阻塞等待写线程归还缓冲区，超过 block_timeout 后丢弃
+    // 整块丢弃活动缓冲区中尚未交给写线程的记录（即最新的一批），复用该缓冲区写入新记录
+    kDropActiveBuffer,
+    kSpill,  // 生产者把新记录同步追加到溢出文件 <log_path>.spill
+};
+
+// 溢出文件与主文件格式相同（不编码），可用 LogStructReader 读取，记录顺序与主文件相互独立
+inline constexpr const char* kLogStructSpillSuffix = ".spill";
+
+// 持久化模式：写线程何时把页缓存中的数据刷到磁盘
+enum class LogStructDurability {
+    kNone,       // 不主动同步（析构时 fsync），掉电会丢失仍在页缓存中的数据
+    kPeriodic,   // 距上次同步超过 sync_interval 或新写入超过 sync_bytes 字节后 fdatasync
+    kWriteback,  // 每批写出后 sync_file_range 发起异步回写，尚未回写完成的数据不超过 dirty_window
+};
+
+// LogStruct 的可选配置
+struct LogStructOptions {
+    ProducerMode producer_mode = ProducerMode::kSingle;
+
+    // 环形缓冲区的数量（至少 2 块），磁盘卡顿时可容纳 buffer_count - 1 块待写数据
+    std::size_t buffer_count = 2;
+
+    // 缓冲区用尽时的处理策略，kMmap 后端只支持 kDropNewest 和 kSpill
+    LogStructOverflow overflow = LogStructOverflow::kDropNewest;
+    // kBlock 策略的最长等待时间，0 表示一直等待
+    std::chrono::microseconds block_timeout = std::chrono::milliseconds{100};
+
+    LogStructBackend backend = LogStructBackend::kWrite;
+    // 每批缓冲区写完后执行 fdatasync（io_uring 后端以链接 SQE 的方式提交）
+    bool sync_after_batch = false;
+
+    // 持久化模式（kMmap 后端不支持），任何模式下都可以用 flushAndWait() 等待指定记录落盘。
+    // 块编码文件重新打开时校验上次同步（checkpoint）之后的块。只有 kPeriodic 或 sync_after_batch
+    // 在运行期间推进 checkpoint 并逐块校验 CRC；其他模式只校验最后 buffer_count 块，恢复同样很快，
+    // 但掉电后中间块的损坏要到读者解码时才能发现
+    LogStructDurability       durability    = LogStructDurability::kNone;
+    std::chrono::milliseconds sync_interval = std::chrono::milliseconds{100};
+    std::size_t               sync_bytes    = 0;  // 0 表示只按时间同步
+    std::size_t               dirty_window  = std::size_t{16} << 20;
+
+    // kMmap 后端预分配的段大小（字节），写满后丢弃新记录
+    std::size_t mmap_segment_size = std::size_t{1} << 30;
+
+    // 写入文件头的字段描述，供读者和离线工具解析记录；名为 "timestamp" 的字段作为时间戳
+    // 追加已有文件时沿用文件头中的字段，给出的字段与之不一致时构造函数抛出 std::runtime_error
+    std::vector<LogStructField> fields{};
+
+    // 每隔多少条记录向 <log_path>.idx 写一个时间戳索引项，0 表示不生成索引。
+    // 需要 fields 中有 8 字节的 timestamp 字段
+    std::size_t index_stride = kLogStructIndexStride;
+
+    // 块编码（kMmap 后端不支持）：写线程把每块缓冲区编码为一个块后落盘，LogStructReader 透明解码。
+    // 按 fields 逐列存放（kDelta 压缩，kColumnar 原样转置），fields 为空时整条记录作为一列
+    LogStructCodec codec = LogStructCodec::kNone;
+
+    // LogStruct::now() 使用的时间戳时钟源
+    LogStructClockSource clock = LogStructClockSource::kSystem;
+
+    // 统计 write()、flush() 和写线程落盘调用的耗时直方图（见 LogStruct::metrics()），
+    // 关闭时热路径上只多一次分支
+    bool metrics = false;
+
+    // 段轮转（kMmap 后端不支持）：当前段的数据超过 rotate_bytes 字节或存在超过 rotate_interval 后
+    // 切换到 <log_path>.<seq> 的下一段，任一项非 0 即开启。下一段由后台线程提前创建并预分配
+    std::size_t          rotate_bytes    = 0;
+    std::chrono::seconds rotate_interval = std::chrono::seconds{0};
+    // 保留策略：段数量（含当前段）或总字节数超出后，后台线程删除最旧的段，0 表示不限
+    std::size_t retention_count = 0;
+    std::size_t retention_bytes = 0;
+};
+
+// LogStruct 运行统计，用于评估 buffer_count 的取值
+struct LogStructStats {
+    std::size_t buffer_count       = 0;  // 缓冲区总数
+    std::size_t high_water_buffers = 0;  // 同时被占用（活动 + 待写）的缓冲区数量峰值
+    std::size_t dropped_records    = 0;  // 因没有空闲缓冲区而丢弃的记录数
+    std::size_t failed_flushes     = 0;  // 因没有空闲缓冲区而失败的切换次数
+    std::size_t write_errors       = 0;  // 重试后仍然失败的写入次数
+    std::size_t lost_records       = 0;  // 因写入失败而丢失的记录数
+    std::size_t rotated_segments   = 0;  // 已完成的段切换次数
+    std::size_t delayed_rotations  = 0;  // 需要切换时下一段尚未准备好、继续写当前段的次数
+    std::size_t segment_errors     = 0;  // 后台线程创建下一段失败的次数，每秒重试一次
+
+    // 各溢出策略的计数
+    std::size_t blocked_writes    = 0;  // kBlock：需要等待空闲缓冲区的写入次数
+    std::size_t block_timeouts    = 0;  // kBlock：等待超时而丢弃的记录数（计入 dropped_records）
+    std::size_t discarded_records = 0;  // kDropActiveBuffer：随活动缓冲区整块丢弃的记录数
+    std::size_t spilled_records   = 0;  // kSpill：写入溢出文件的记录数
+
+    std::size_t syncs       = 0;  // 写线程执行 fdatasync（mmap 后端为 msync）的次数
+    std::size_t sync_errors = 0;  // fdatasync（mmap 后端为 msync）失败的次数
+
+    LogStructBackend backend = LogStructBackend::kWrite;  // 实际使用的后端
+};
+
+class IoUring;
+
 class LogStruct {
-   private:
+   protected:
+    // 封存标记：加到 reserved 上之后，所有后续预留都会因越界而失败
+    static constexpr std::size_t kSealed    = std::size_t{1} << 62;
+    static constexpr std::size_t kNotSealed = static_cast<std::size_t>(-1);
+
+    // 定长缓冲区
+    // reserved: 已预留的字节数；committed: 已完成拷贝的字节数；sealed_size: 封存时的有效长度
+    // 非活动缓冲区始终处于封存状态，只有切换为活动缓冲区时才把 reserved 置 0
+    struct Buffer {
+        std::byte*                           data = nullptr;
+        alignas(64) std::atomic<std::size_t> reserved{kSealed};
+        alignas(64) std::atomic<std::size_t> committed{0};
+        std::atomic<std::size_t>             sealed_size{kNotSealed};
+        std::uint64_t                        end_seq = 0;  // 封存时写入：最后一条记录的序号 + 1
+    };
+
     // 配置参数
-    std::string log_path_;
-    std::size_t struct_size_;
-    std::size_t byte_size_;
-    std::size_t polling_interval_;
+    std::string      log_path_;
+    std::size_t      struct_size_;
+    std::size_t      byte_size_;
+    std::size_t      polling_interval_;
+    ProducerMode     producer_mode_;
+    std::size_t      buffer_count_;
+    LogStructBackend backend_;
+    bool             sync_after_batch_;
+    bool             framed_;  // 帧模式（LogStructFramed），struct_size_ 为帧的对齐单位
+
+    // 溢出策略
+    LogStructOverflow         overflow_;
+    std::chrono::microseconds block_timeout_;
+
+    // 文件头
+    LogStructFileHeader file_header_ = {};
+    std::size_t         header_size_ = 0;
+    std::string         segment_path_;  // 当前写入的文件，未开启轮转时即 log_path_
 
     // 状态控制
-    int                                   fd_ = -1;
-    std::atomic<bool>                     is_running_{true};
-    std::atomic<bool>                     is_writing_{false};
-    std::atomic_flag                      has_data_to_write = ATOMIC_FLAG_INIT;
-    std::chrono::system_clock::time_point last_write_time_;
+    int                                                fd_ = -1;
+    std::atomic<bool>                                  is_switching_{false};
+    std::atomic_flag                                   has_data_to_write = ATOMIC_FLAG_INIT;
+    std::atomic<std::chrono::steady_clock::time_point> last_switch_time_;
+
+    // 写线程按 polling_interval 定时醒来检查活动缓冲区，生产者的 write() 不读时钟。
+    // 单生产者模式下写线程不能直接切换，置位 flush_requested_ 由生产者在下一次 write() 时切换
+    std::atomic<bool>       flush_requested_{false};
+    std::atomic<bool>       writer_waiting_{false};
+    std::mutex              write_mutex_;
+    std::condition_variable write_cv_;
+
+    LogStructClock clock_;
+
+    // 内存管理：环形缓冲区，所有缓冲区共用一段连续内存
+    std::byte*                raw_buffer_;
+    std::unique_ptr<Buffer[]> buffers_;
+
+    // head_: 活动缓冲区的序号；tail_: 写线程下一块待写缓冲区的序号，均单调递增
+    // [tail_, head_) 为待写缓冲区，head_ - tail_ + 1 即被占用的缓冲区数量
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::atomic<Buffer*>                 current_buffer_;
+
+    // 统计
+    std::atomic<std::size_t> high_water_buffers_{1};
+    std::atomic<std::size_t> dropped_records_{0};
+    std::atomic<std::size_t> failed_flushes_{0};
+    std::atomic<std::size_t> write_errors_{0};
+    std::atomic<std::size_t> lost_records_{0};
+    std::atomic<std::size_t> rotated_segments_{0};
+    std::atomic<std::size_t> delayed_rotations_{0};
+    std::atomic<std::size_t> segment_errors_{0};
+    std::atomic<std::size_t> blocked_writes_{0};
+    std::atomic<std::size_t> block_timeouts_{0};
+    std::atomic<std::size_t> discarded_records_{0};
+    std::atomic<std::size_t> spilled_records_{0};
+
+    // kBlock：写线程归还缓冲区后唤醒等待的生产者，没有等待者时不加锁
+    std::mutex               space_mutex_;
+    std::condition_variable  space_cv_;
+    std::atomic<std::size_t> space_waiters_{0};
+
+    // kSpill：溢出文件由生产者在锁内追加
+    int        spill_fd_ = -1;
+    std::mutex spill_mutex_;
+
+    // 持久化：记录按进入缓冲区的顺序从 0 编号，base_seq_ 为活动缓冲区第一条记录的序号。
+    // 切换和复用活动缓冲区时 switch_version_ 为奇数，sequence() 据此读取一致的快照
+    LogStructDurability        durability_;
+    std::chrono::milliseconds  sync_interval_;
+    std::size_t                sync_bytes_;
+    std::size_t                dirty_window_;
+    std::atomic<std::uint64_t> base_seq_{0};
+    std::atomic<std::uint64_t> switch_version_{0};
+    std::atomic<std::uint64_t> sync_request_{0};  // flushAndWait() 请求过的最大序号
+    std::atomic<std::uint64_t> durable_seq_{0};   // 只由写线程更新
+    std::atomic<std::size_t>   syncs_{0};
+    std::atomic<std::size_t>   sync_errors_{0};
+    // 第一条可能因 I/O 错误丢失的记录序号，只由写线程更新
+    std::atomic<std::uint64_t> failed_seq_{std::numeric_limits<std::uint64_t>::max()};
+    std::mutex                 durable_mutex_;
+    std::condition_variable    durable_cv_;
+    // 以下只由写线程使用：已写出的序号、上次同步后写出的字节数、已发起和已等待回写的文件偏移
+    std::uint64_t                         written_seq_    = 0;
+    std::size_t                           unsynced_bytes_ = 0;
+    std::chrono::steady_clock::time_point last_sync_;
+    off_t                                 writeback_begin_ = 0;
+    off_t                                 writeback_done_  = 0;
 
-    // 内存管理：Ping-Pong Buffer
-    std::byte*                          raw_buffer1_;
-    std::byte*                          raw_buffer2_;
-    std::pmr::monotonic_buffer_resource pool1_;
-    std::pmr::monotonic_buffer_resource pool2_;
+    // 运行指标：直方图只在开启统计时分配；written_bytes_ 只由写线程更新
+    struct Histograms {
+        LatencyHistogram write;
+        LatencyHistogram flush;
+        LatencyHistogram io;
+    };
+    std::unique_ptr<Histograms> histograms_;
+    std::atomic<std::uint64_t>  written_bytes_{0};
 
-    // 业务容器
-    std::pmr::vector<std::byte> vector1_;
-    std::pmr::vector<std::byte> vector2_;
+    // io_uring 后端：缓冲区注册为固定缓冲区，按显式偏移写入
+    std::unique_ptr<IoUring> io_uring_;
+    bool                     fixed_buffers_ = false;
+    off_t                    file_offset_   = 0;
 
-    // 指针切换（原子操作）
-    std::atomic<std::pmr::vector<std::byte>*> current_vector_;
-    std::atomic<std::pmr::vector<std::byte>*> next_vector_;
+    // mmap 后端：整个映射段作为唯一的缓冲区，committed 即已发布的尾部偏移
+    void*                       mmap_base_   = nullptr;
+    std::size_t                 mmap_length_ = 0;
+    off_t                       mmap_offset_ = 0;
+    std::mutex                  mmap_mutex_;
+    std::condition_variable_any mmap_cv_;
 
-    // std::atomic<bool> is_switching_ = false;
+    // 稀疏时间戳索引，只由写线程（mmap 后端为后台线程）更新
+    std::unique_ptr<LogStructIndexWriter> index_;
+    std::vector<LogStructField>           fields_;
+    std::size_t                           index_stride_;
+
+    // 块编码：encoded_ 为每块缓冲区对应的编码结果，只由写线程使用
+    LogStructCodec                      codec_;
+    std::vector<LogStructColumn>        columns_;
+    std::vector<std::vector<std::byte>> encoded_;
+    // 解码后的数据偏移，索引按它定位记录；未编码时与 file_offset_ 相同
+    std::uint64_t logical_offset_ = 0;
+    // 最后写出的块在文件中的偏移，同步后写入文件头的 checkpoint
+    std::uint64_t last_block_ = 0;
+
+    // 段轮转：fd_、index_、segment_seq_ 只在写线程中切换，
+    // 后台线程负责创建下一段、关闭写满的段和执行保留策略
+    struct Segment {
+        int                                   fd  = -1;
+        std::uint64_t                         seq = 0;
+        std::unique_ptr<LogStructIndexWriter> index;
+    };
+    bool                                  rotating_;
+    std::size_t                           rotate_bytes_;
+    std::chrono::seconds                  rotate_interval_;
+    std::size_t                           retention_count_;
+    std::size_t                           retention_bytes_;
+    std::uint64_t                         segment_seq_ = 0;
+    std::chrono::system_clock::time_point segment_deadline_;
+    std::mutex                            segment_mutex_;
+    std::condition_variable_any           segment_cv_;
+    std::unique_ptr<Segment>              next_segment_;
+    std::vector<Segment>                  retired_segments_;
+    std::jthread                          segment_thread_;
 
     std::jthread write_thread_;
 
    public:
     LogStruct(const std::string& log_path, std::size_t struct_size, std::size_t reverse_size,
-              std::size_t polling_interval);
+              std::size_t polling_interval, const LogStructOptions& options = {});
 
     ~LogStruct();
 
@@ -55,8 +316,308 @@ class LogStruct {
 
     bool write(const std::byte* data);
 
+    LogStructStats stats() const;
+
+    // 运行指标快照，可在任意线程调用，只读取原子计数
+    LogStructMetrics metrics() const;
+
+    // 按 LogStructOptions::clock 读取的当前时间（Unix 纪元起的微秒数），供生产者给记录打时间戳
+    std::int64_t now() const { return clock_.now(); }
+
+    // 下一条记录的序号：本线程此前成功 write() 的记录序号都小于它。序号从本实例创建时的 0 开始
+    std::uint64_t sequence() const;
+    // 序号小于该值的记录都已落盘（被 kDropActiveBuffer 丢弃或写入失败的记录同样视为已越过）
+    std::uint64_t durableSequence() const { return durable_seq_.load(std::memory_order_acquire); }
+    // 封存包含 seq 之前记录的缓冲区，等待它们全部落盘，超时返回 false；
+    // 其中有记录可能因写入或同步失败而丢失时立即返回 false（见 lost_records、sync_errors）。
+    // 并发的调用共享同一次 fdatasync；单生产者模式下与 flush() 的限制相同
+    bool flushAndWait(std::uint64_t seq,
+                      std::chrono::milliseconds timeout = std::chrono::seconds{5});
+
+   protected:
+    // 帧模式（LogStructFramed）：struct_size 为 kLogStructFrameAlign，fields 带有所属的记录类型
+    LogStruct(const std::string& log_path, std::size_t struct_size, std::size_t reverse_size,
+              std::size_t polling_interval, const LogStructOptions& options, bool framed);
+
+    // 在 buffer 上预留 size 字节，返回偏移；越界表示预留失败
+    std::size_t reserve(Buffer* buffer, std::size_t size) {
+        if (producer_mode_ == ProducerMode::kMulti) {
+            // acquire: 与切换时重新打开 reserved 的 release 配对，保证不会与上一轮落盘竞争
+            return buffer->reserved.fetch_add(size, std::memory_order_acquire);
+        }
+
+        // 单生产者：切换只会发生在本线程，load + store 即可
+        std::size_t offset = buffer->reserved.load(std::memory_order_relaxed);
+        if (offset + size <= byte_size_) {
+            buffer->reserved.store(offset + size, std::memory_order_relaxed);
+        }
+        return offset;
+    }
+
+    // 发布已拷贝完成的记录
+    void commit(Buffer* buffer, const std::byte* slot, std::size_t size) {
+        if (backend_ == LogStructBackend::kMmap) {
+            // 按预留顺序推进尾部偏移，刷盘线程和读者只会看到连续完整的记录
+            auto offset = static_cast<std::size_t>(slot - buffer->data);
+            while (buffer->committed.load(std::memory_order_acquire) != offset) {
+                std::this_thread::yield();
+            }
+            buffer->committed.store(offset + size, std::memory_order_release);
+            return;
+        }
+        if (producer_mode_ == ProducerMode::kMulti) {
+            buffer->committed.fetch_add(size, std::memory_order_release);
+            return;
+        }
+        buffer->committed.store(buffer->committed.load(std::memory_order_relaxed) + size,
+                                std::memory_order_release);
+    }
+
+    // 在活动缓冲区上预留一条 size 字节的记录，失败返回 nullptr
+    std::byte* acquireSlot(std::size_t size, Buffer*& buffer) {
+        buffer             = current_buffer_.load(std::memory_order_acquire);
+        std::size_t offset = reserve(buffer, size);
+        if (offset + size > byte_size_) [[unlikely]] {
+            return acquireSlotSlow(size, buffer, offset);
+        }
+        return buffer->data + offset;
+    }
+
+    // 缓冲区已满或刚被封存：尝试切换后在新的活动缓冲区上重试，仍然失败时按溢出策略处理。
+    // offset 为在 buffer 上预留失败的偏移
+    std::byte* acquireSlotSlow(std::size_t size, Buffer*& buffer, std::size_t offset);
+    // 多生产者的变长帧可能只越过缓冲区末尾一部分：用填充帧补齐 [offset, byte_size_) 并提交，
+    // 否则写线程会一直等待这段不会被提交的空间。定长记录不会出现这种情况
+    void padTail(Buffer* buffer, std::size_t offset);
+
+    // 没有拿到槽位的 size 字节记录：kSpill 策略下追加到溢出文件，
+    // 其他策略已在 acquireSlotSlow 中计为丢弃
+    bool overflow(const std::byte* data, std::size_t size) {
+        return overflow_ == LogStructOverflow::kSpill && spill(data, size);
+    }
+    bool spill(const std::byte* data, std::size_t size);
+
+    // slot 所在的缓冲区
+    Buffer* bufferOf(const std::byte* slot) {
+        return &buffers_[static_cast<std::size_t>(slot - raw_buffer_) / byte_size_];
+    }
+
+    // 提交 slot 并检查容量是否达到切换阈值
+    void publishSlot(Buffer* buffer, const std::byte* slot, std::size_t size) {
+        commit(buffer, slot, size);
+        maybeFlush(static_cast<std::size_t>(slot - buffer->data) + 2 * size > byte_size_);
+    }
+
+    // 缓冲区将满或写线程请求切换时切换。mmap 后端由后台线程按时间回写，不需要切换
+    void maybeFlush(bool full) {
+        if ((full || flush_requested_.load(std::memory_order_relaxed)) &&
+            backend_ != LogStructBackend::kMmap) [[unlikely]]
+            swapBuffers();
+    }
+
    private:
+    // 文件头中与编码和帧模式相关的 flags
+    std::uint32_t headerFlags() const;
+    // 新文件写入文件头，已有文件校验文件头后追加
+    void openHeader();
+    // 追加已有文件时改用文件头中的字段描述，与给出的字段不一致时返回错误信息
+    std::string openFields(const LogStructFileHeader& header);
+    // 文件头中有时间戳字段时打开 sidecar 索引
+    void setupIndex(std::size_t stride);
+    // 更新文件头中的 data_size，flags 为附加在 headerFlags() 之上的标志
+    void updateHeader(std::uint32_t flags, std::uint64_t data_size);
+    // 已有的编码文件：从 checkpoint 处的块开始逐块校验，截掉第一个不完整或校验失败的块
+    // 及之后的数据，并统计已有记录。checkpoint 处的块校验失败时从头校验
+    void recoverBlocks();
+    // 帧模式文件 fd 中 [begin, end) 内最后一个完整帧的末尾
+    static off_t completeFrames(int fd, off_t begin, off_t end);
+    // 补齐 sidecar 中缺失的索引项，编码文件需要逐块解码
+    void catchUpIndex();
+    // 需要编码时把 buffer 的 size 字节编码到 encoded_[index]，返回实际要写入的数据和长度
+    std::pair<const std::byte*, std::size_t> encodeBuffer(std::size_t index, const Buffer* buffer,
+                                                          std::size_t size);
+
+    // 段轮转（实现见 log_struct_rotation.cpp）
+    // 选择启动时写入的段：沿用序号最大的已有段，没有时从 1 开始
+    void openSegments();
+    // 写线程在写出 [tail, head) 前调用：需要时切换到下一段，返回不超过当前段容量的批次终点
+    std::size_t segmentBatch(std::size_t tail, std::size_t head);
+    // 取出预先创建好的下一段并替换当前段，下一段尚未就绪时返回 false
+    bool rotateSegment();
+    // 创建并预分配一个新段
+    std::unique_ptr<Segment> createSegment(std::uint64_t seq);
+    void                     closeSegment(Segment& segment);
+    // 删除超出保留策略的旧段
+    void applyRetention();
+    void manageSegments(std::stop_token st);
+
+    // 封存活动缓冲区、切换到下一块空闲缓冲区并通知写线程，没有空闲缓冲区时返回 false
+    bool swapBuffers();
+    // kBlock：等待出现空闲缓冲区，超时返回 false
+    bool waitForSpace(std::chrono::steady_clock::time_point deadline);
+    // 写线程归还缓冲区后唤醒 waitForSpace
+    void notifySpace();
+    // kDropActiveBuffer：没有空闲缓冲区时封存活动缓冲区，等在途记录提交后清空并重新打开
+    bool recycleCurrent();
+    // kSpill：打开溢出文件，新文件写入文件头
+    void openSpill();
+
+    // 写线程：按持久化模式或 flushAndWait() 的请求执行 fdatasync，force 时只要有未同步的数据就同步
+    void syncFile(bool force);
+    // 写线程：kWriteback 模式下对新写出的部分发起回写，并等待超出 dirty_window 的较早部分
+    void writeback();
+    void publishDurable(std::uint64_t seq);
+    // 写线程：seq 及之后的记录可能因写入或同步失败而丢失，唤醒等待越过它的 flushAndWait()
+    void reportIoError(std::uint64_t seq);
+    // 写线程：同步完成后把 last_block_ 记为文件头的 checkpoint，重新打开时从它开始恢复
+    void updateCheckpoint();
+    // 写线程等待新的缓冲区，最晚在 deadline 返回
+    void waitForData(std::chrono::steady_clock::time_point deadline);
+    // 置位 has_data_to_write，写线程正在等待时唤醒它
+    void notifyWriter();
+    // 写线程：活动缓冲区有数据且距上次切换超过 polling_interval 时触发切换，返回下一次检查的时刻
+    std::chrono::steady_clock::time_point checkInterval();
+    // 初始化 io_uring 后端，失败时回退到 kWrite
+    void setupIoUring();
+    // 初始化 mmap 后端：在文件末尾预分配一个段并映射
+    void setupMmap(std::size_t segment_size);
+
+    // 等待封存前已预留的记录全部提交，返回有效长度
+    std::size_t waitCommitted(Buffer* buffer);
+    // 复位但保持封存，持有旧指针的生产者在其重新成为活动缓冲区前都无法预留
+    void resetBuffer(Buffer* buffer);
+    // 在 offset 处阻塞写入，遇到 EINTR 或短写时重试
+    bool writeFully(const std::byte* data, std::size_t size, off_t offset);
+
+    // 阻塞后端：等待在途记录提交后将 buffer 写入文件并复位
+    void drain(Buffer* buffer);
+    // 写入失败：文件偏移保持不变并计入丢失的记录
+    void loseBuffer(const Buffer* buffer, std::size_t size);
+    // io_uring 后端：一次提交 [tail, head) 内所有缓冲区的写入
+    void drainBatch(std::size_t tail, std::size_t head);
+
     void writeToFile(std::stop_token st);
+    // mmap 后端的后台线程：定期对已发布的区域发起异步回写
+    void syncMappedFile(std::stop_token st);
+};
+
+// 定长记录的类型化 LogStruct：记录大小为编译期常量，
+// reserve() 直接返回活动缓冲区内的 T&，调用方原地填充字段后 commit() 发布，省去一次栈拷贝和 memcpy
+template <typename T>
+class LogStructT : public LogStruct {
+    static_assert(std::is_trivially_copyable_v<T>, "LogStructT requires a trivially copyable T");
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "LogStructT requires T aligned no stricter than operator new");
+
+   public:
+    LogStructT(const std::string& log_path, std::size_t reverse_size, std::size_t polling_interval,
+               const LogStructOptions& options = {})
+        : LogStruct(log_path, sizeof(T), reverse_size, polling_interval, options) {}
+
+    // 预留一条记录。缓冲区满时返回线程局部的占位记录，对应的 commit() 按溢出策略处理
+    T& reserve() {
+        Buffer*    buffer = nullptr;
+        std::byte* slot   = acquireSlot(sizeof(T), buffer);
+        if (!slot) [[unlikely]] {
+            return scratch();
+        }
+        return *std::launder(reinterpret_cast<T*>(slot));
+    }
+
+    // 发布 reserve() 返回的记录，记录被丢弃时返回 false
+    bool commit(T& record) {
+        if (&record == &scratch()) [[unlikely]] {
+            return overflow(reinterpret_cast<const std::byte*>(&record), sizeof(T));
+        }
+        auto slot = reinterpret_cast<const std::byte*>(&record);
+        publishSlot(bufferOf(slot), slot, sizeof(T));
+        return true;
+    }
+
+    bool write(const T& record) {
+        ScopedLatency latency(histograms_ ? &histograms_->write : nullptr);
+        T&            slot = reserve();
+        slot    = record;
+        return commit(slot);
+    }
+
+    using LogStruct::write;
+
+   private:
+    static T& scratch() {
+        static thread_local T record;
+        return record;
+    }
+};
+
+// 帧模式的 LogStruct：每条记录带类型和长度（LogStructFrameHeader），
+// 多种记录类型共用一个缓冲区、写线程和文件，LogStructReader::frames() 按顺序读出。
+// 定长类型 T 的帧大小是编译期常量，reserve<T>() / write<T>() 的热路径与 LogStructT 相同，
+// 不按长度分支。不支持块编码和时间戳索引，kDropActiveBuffer 按 kDropNewest 处理；
+// sequence() 按 kLogStructFrameAlign 字节计数
+class LogStructFramed : public LogStruct {
+   public:
+    // buffer_bytes 为每块缓冲区的字节数；schemas 写入文件头，字段的 schema 取所属的记录类型
+    LogStructFramed(const std::string& log_path, std::size_t buffer_bytes,
+                    std::size_t polling_interval, const std::vector<LogStructSchema>& schemas,
+                    const LogStructOptions& options = {});
+
+    // 预留一条 type 类型的记录。缓冲区满时返回线程局部的占位记录，
+    // 对应的 commit() 按溢出策略处理
+    template <typename T>
+    T& reserve(std::uint32_t type) {
+        Buffer*    buffer = nullptr;
+        std::byte* slot   = acquireSlot(kFrameSize<T>, buffer);
+        if (!slot) [[unlikely]] {
+            slot = scratch<T>();
+        }
+        LogStructFrameHeader header{type, static_cast<std::uint32_t>(sizeof(T))};
+        std::memcpy(slot, &header, sizeof(header));
+        if constexpr (kFrameSize<T> > sizeof(header) + sizeof(T)) {
+            std::memset(slot + sizeof(header) + sizeof(T), 0,
+                        kFrameSize<T> - sizeof(header) - sizeof(T));
+        }
+        return *std::launder(reinterpret_cast<T*>(slot + sizeof(header)));
+    }
+
+    // 发布 reserve<T>() 返回的记录，记录被丢弃时返回 false
+    template <typename T>
+    bool commit(T& record) {
+        auto frame = reinterpret_cast<const std::byte*>(&record) - sizeof(LogStructFrameHeader);
+        if (frame == scratch<T>()) [[unlikely]] {
+            return overflow(frame, kFrameSize<T>);
+        }
+        publishSlot(bufferOf(frame), frame, kFrameSize<T>);
+        return true;
+    }
+
+    template <typename T>
+    bool write(std::uint32_t type, const T& record) {
+        ScopedLatency latency(histograms_ ? &histograms_->write : nullptr);
+        T&            slot = reserve<T>(type);
+        slot    = record;
+        return commit(slot);
+    }
+
+    // 变长记录，负载为 [data, data + size)；帧大于一块缓冲区时丢弃
+    bool write(std::uint32_t type, const std::byte* data, std::size_t size);
+
+   private:
+    template <typename T>
+    static constexpr std::size_t kFrameSize = [] {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "LogStructFramed requires a trivially copyable T");
+        static_assert(alignof(T) <= kLogStructFrameAlign,
+                      "LogStructFramed requires T aligned no stricter than kLogStructFrameAlign");
+        return logStructFrameSize(sizeof(T));
+    }();
+
+    // 占位帧，布局与缓冲区中的帧相同
+    template <typename T>
+    static std::byte* scratch() {
+        alignas(kLogStructFrameAlign) static thread_local std::byte frame[kFrameSize<T>];
+        return frame;
+    }
 };
 
 }  // namespace utils
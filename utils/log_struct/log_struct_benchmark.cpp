@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "log_struct.hpp"
+
+// 用法：benchmark_log_struct --benchmark_format=json --benchmark_out=log_struct.json
+// 每个用例写入固定数量的记录，迭代次数固定，便于在版本之间对比 JSON 结果
+
+namespace {
+
+constexpr std::size_t kRecordsPerIteration = 50000;
+constexpr int         kIterations          = 10;
+
+const std::string kBenchmarkLogPath = "/tmp/log_struct_benchmark.log";
+
+void removeLog() {
+    std::filesystem::remove(kBenchmarkLogPath);
+    std::filesystem::remove(kBenchmarkLogPath + utils::kLogStructIndexSuffix);
+}
+
+// 参数：记录大小、每块缓冲区的记录数、切换间隔（毫秒）、生产者数量、后端
+void BM_LogStructWrite(benchmark::State& state) {
+    auto record_size      = static_cast<std::size_t>(state.range(0));
+    auto buffer_records   = static_cast<std::size_t>(state.range(1));
+    auto polling_interval = static_cast<std::size_t>(state.range(2));
+    auto producers        = static_cast<std::size_t>(state.range(3));
+    auto backend          = static_cast<utils::LogStructBackend>(state.range(4));
+
+    removeLog();
+    utils::LogStructMetrics metrics;
+    {
+        utils::LogStruct log_struct(
+            kBenchmarkLogPath, record_size, buffer_records, polling_interval,
+            {.producer_mode = producers > 1 ? utils::ProducerMode::kMulti
+                                            : utils::ProducerMode::kSingle,
+             .buffer_count  = 8,
+             .backend       = backend,
+             // mmap 后端的段要容纳全部记录，否则写满后的丢弃会让结果失真
+             .mmap_segment_size = record_size * kRecordsPerIteration * (kIterations + 1),
+             .metrics           = true});
+
+        auto produce = [&](std::size_t count) {
+            std::vector<std::byte> record(record_size, std::byte{0x5a});
+            for (std::size_t i = 0; i < count; ++i) {
+                std::memcpy(record.data(), &i, std::min(sizeof(i), record_size));
+                log_struct.write(record.data());
+            }
+        };
+        for (auto _ : state) {
+            std::vector<std::jthread> threads;
+            for (std::size_t p = 1; p < producers; ++p) {
+                threads.emplace_back(produce, kRecordsPerIteration / producers);
+            }
+            produce(kRecordsPerIteration / producers);
+        }
+        metrics = log_struct.metrics();
+    }
+    removeLog();
+
+    auto records = static_cast<std::int64_t>(state.iterations() * kRecordsPerIteration);
+    state.SetItemsProcessed(records);
+    state.SetBytesProcessed(records * static_cast<std::int64_t>(record_size));
+    state.counters["dropped"] = static_cast<double>(metrics.dropped_records);
+    state.counters["p50_ns"]  = static_cast<double>(metrics.write_latency.percentile(0.5));
+    state.counters["p99_ns"]  = static_cast<double>(metrics.write_latency.percentile(0.99));
+    state.counters["p999_ns"] = static_cast<double>(metrics.write_latency.percentile(0.999));
+    state.counters["max_ns"]  = static_cast<double>(metrics.write_latency.max());
+}
+
+BENCHMARK(BM_LogStructWrite)
+    ->ArgNames({"record_size", "buffer_records", "interval_ms", "producers", "backend"})
+    ->ArgsProduct({{32, 88, 256},
+                   {1024, 16384},
+                   {1, 100},
+                   {1, 4},
+                   {static_cast<std::int64_t>(utils::LogStructBackend::kWrite),
+                    static_cast<std::int64_t>(utils::LogStructBackend::kIoUring),
+                    static_cast<std::int64_t>(utils::LogStructBackend::kMmap)}})
+    ->Iterations(kIterations)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
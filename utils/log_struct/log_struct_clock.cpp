@@ -0,0 +1,51 @@
+#include "log_struct_clock.hpp"
+
+#if UTILS_LOG_STRUCT_HAS_TSC
+#include <cpuid.h>
+#endif
+
+namespace utils {
+
+namespace {
+
+#if UTILS_LOG_STRUCT_HAS_TSC
+// CPUID.80000007H:EDX[8]：TSC 频率恒定且不随 C-state 停止
+bool invariantTsc() {
+    unsigned eax, ebx, ecx, edx;
+    return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8));
+}
+#endif
+
+std::int64_t systemUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+LogStructClock::LogStructClock(LogStructClockSource source) : source_(source) {
+    if (source_ != LogStructClockSource::kTsc)
+        return;
+#if UTILS_LOG_STRUCT_HAS_TSC
+    if (invariantTsc()) {
+        // 在两个时刻同时读取 TSC 和 steady_clock，得到每个 tick 的微秒数
+        auto start       = std::chrono::steady_clock::now();
+        auto start_ticks = __rdtsc();
+        auto end         = start;
+        while (end - start < std::chrono::milliseconds(10)) {
+            end = std::chrono::steady_clock::now();
+        }
+        auto end_ticks = __rdtsc();
+        std::chrono::duration<double, std::micro> elapsed = end - start;
+
+        us_per_tick_ = elapsed.count() / static_cast<double>(end_ticks - start_ticks);
+        tsc_base_    = __rdtsc();
+        base_us_     = systemUs();
+        return;
+    }
+#endif
+    source_ = LogStructClockSource::kSystem;
+}
+
+}  // namespace utils
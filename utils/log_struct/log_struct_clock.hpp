@@ -0,0 +1,60 @@
+#pragma once
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UTILS_LOG_STRUCT_HAS_TSC 1
+#else
+#define UTILS_LOG_STRUCT_HAS_TSC 0
+#endif
+
+namespace utils {
+
+// 记录时间戳的时钟源
+enum class LogStructClockSource {
+    kSystem,  // std::chrono::system_clock，精确但每次都是一次 vDSO 调用
+    kCoarse,  // CLOCK_REALTIME_COARSE：内核在时钟中断时缓存的时间，精度为一个 tick（通常 1~4ms）
+    kTsc,     // 校准后的 rdtsc，不进入 vDSO。CPU 不支持 invariant TSC 时回退到 kSystem
+};
+
+// 供生产者给记录打时间戳的低开销时钟，返回自 Unix 纪元起的微秒数，与文件头 clock_base_us 同单位。
+// kTsc 在构造时对照 system_clock 校准约 10ms，之后不再跟随 NTP 调整，需要时重新构造
+class LogStructClock {
+   public:
+    explicit LogStructClock(LogStructClockSource source = LogStructClockSource::kSystem);
+
+    std::int64_t now() const {
+        switch (source_) {
+            case LogStructClockSource::kCoarse: {
+                timespec ts;
+                ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+                return static_cast<std::int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+            }
+#if UTILS_LOG_STRUCT_HAS_TSC
+            case LogStructClockSource::kTsc: {
+                auto ticks = static_cast<double>(static_cast<std::int64_t>(__rdtsc() - tsc_base_));
+                return base_us_ + static_cast<std::int64_t>(ticks * us_per_tick_);
+            }
+#endif
+            default:
+                return std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+        }
+    }
+
+    // 实际使用的时钟源
+    LogStructClockSource source() const { return source_; }
+
+   private:
+    LogStructClockSource source_;
+    std::uint64_t        tsc_base_    = 0;
+    std::int64_t         base_us_     = 0;
+    double               us_per_tick_ = 0;
+};
+
+}  // namespace utils
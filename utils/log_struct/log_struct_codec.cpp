@@ -0,0 +1,686 @@
+#include "log_struct_codec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace utils {
+
+namespace {
+
+constexpr std::uint64_t lowMask(int bits) {
+    return bits >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << bits) - 1;
+}
+
+std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+void putVarint(std::vector<std::byte>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::byte>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::byte>(value));
+}
+
+bool getVarint(const std::byte*& pos, const std::byte* end, std::uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        auto byte = static_cast<std::uint8_t>(*pos++);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// 按列宽读写整数：有符号列做符号扩展，无符号列做零扩展
+std::int64_t loadInteger(const std::byte* data, std::size_t size, bool is_signed) {
+    std::uint64_t value = 0;
+    std::memcpy(&value, data, size);
+    if (is_signed && size < 8) {
+        int shift = static_cast<int>(64 - size * 8);
+        return static_cast<std::int64_t>(value << shift) >> shift;
+    }
+    return static_cast<std::int64_t>(value);
+}
+
+void storeInteger(std::byte* data, std::size_t size, std::int64_t value) {
+    std::memcpy(data, &value, size);
+}
+
+// MSB 优先的位流
+class BitWriter {
+   public:
+    explicit BitWriter(std::vector<std::byte>& out) : out_(out) {}
+
+    void write(std::uint64_t value, int bits) {
+        while (bits > 0) {
+            int           take = std::min(bits, 64 - used_);
+            std::uint64_t part = (value >> (bits - take)) & lowMask(take);
+            acc_               = take == 64 ? part : (acc_ << take) | part;
+            used_ += take;
+            bits -= take;
+            if (used_ == 64) {
+                put(acc_, 8);
+                acc_  = 0;
+                used_ = 0;
+            }
+        }
+    }
+
+    void finish() {
+        if (used_ > 0)
+            put(acc_ << (64 - used_), (used_ + 7) / 8);
+        acc_  = 0;
+        used_ = 0;
+    }
+
+   private:
+    void put(std::uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out_.push_back(static_cast<std::byte>(value >> (56 - 8 * i)));
+        }
+    }
+
+    std::vector<std::byte>& out_;
+    std::uint64_t           acc_  = 0;
+    int                     used_ = 0;
+};
+
+class BitReader {
+   public:
+    BitReader(const std::byte* begin, const std::byte* end) : pos_(begin), end_(end) {}
+
+    std::uint64_t read(int bits) {
+        std::uint64_t result = 0;
+        while (bits > 0) {
+            if (avail_ == 0 && !refill())
+                return result << bits;
+            int take = std::min(bits, avail_);
+            result   = (take == 64 ? 0 : result << take) |
+                     ((acc_ >> (avail_ - take)) & lowMask(take));
+            avail_ -= take;
+            bits -= take;
+        }
+        return result;
+    }
+
+    bool overrun() const { return overrun_; }
+
+   private:
+    bool refill() {
+        std::size_t bytes = std::min<std::size_t>(8, static_cast<std::size_t>(end_ - pos_));
+        if (bytes == 0) {
+            overrun_ = true;
+            return false;
+        }
+        acc_ = 0;
+        for (std::size_t i = 0; i < bytes; ++i) {
+            acc_ = (acc_ << 8) | static_cast<std::uint8_t>(pos_[i]);
+        }
+        pos_ += bytes;
+        avail_ = static_cast<int>(bytes * 8);
+        return true;
+    }
+
+    const std::byte* pos_;
+    const std::byte* end_;
+    std::uint64_t    acc_     = 0;
+    int              avail_   = 0;
+    bool             overrun_ = false;
+};
+
+// Gorilla XOR：与上一个值异或，为 0 时写 1 位；否则复用上一个有效位窗口，或写入新窗口
+template <typename Bits>
+void encodeXor(const std::byte* data, std::size_t stride, std::size_t count,
+               std::vector<std::byte>& out) {
+    constexpr int kWidth      = sizeof(Bits) * 8;
+    constexpr int kLengthBits = kWidth == 64 ? 6 : 5;
+
+    BitWriter writer(out);
+    Bits      prev;
+    std::memcpy(&prev, data, sizeof(prev));
+    writer.write(prev, kWidth);
+
+    int prev_leading  = -1;
+    int prev_trailing = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        Bits value;
+        std::memcpy(&value, data + i * stride, sizeof(value));
+        Bits x = value ^ prev;
+        prev   = value;
+        if (x == 0) {
+            writer.write(0, 1);
+            continue;
+        }
+        int leading  = std::min(std::countl_zero(x), 31);
+        int trailing = std::countr_zero(x);
+        if (prev_leading >= 0 && leading >= prev_leading && trailing >= prev_trailing) {
+            writer.write(0b10, 2);
+            writer.write(x >> prev_trailing, kWidth - prev_leading - prev_trailing);
+        } else {
+            int length = kWidth - leading - trailing;
+            writer.write(0b11, 2);
+            writer.write(static_cast<std::uint64_t>(leading), 5);
+            writer.write(static_cast<std::uint64_t>(length - 1), kLengthBits);
+            writer.write(x >> trailing, length);
+            prev_leading  = leading;
+            prev_trailing = trailing;
+        }
+    }
+    writer.finish();
+}
+
+template <typename Bits>
+bool decodeXor(const std::byte* begin, const std::byte* end, std::byte* data, std::size_t stride,
+               std::size_t count) {
+    constexpr int kWidth      = sizeof(Bits) * 8;
+    constexpr int kLengthBits = kWidth == 64 ? 6 : 5;
+
+    BitReader reader(begin, end);
+    auto      prev = static_cast<Bits>(reader.read(kWidth));
+    std::memcpy(data, &prev, sizeof(prev));
+
+    int leading  = 0;
+    int trailing = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        if (reader.read(1)) {
+            if (reader.read(1)) {
+                leading  = static_cast<int>(reader.read(5));
+                trailing = kWidth - leading - static_cast<int>(reader.read(kLengthBits)) - 1;
+                if (trailing < 0)
+                    return false;
+            }
+            prev ^= static_cast<Bits>(reader.read(kWidth - leading - trailing) << trailing);
+        }
+        std::memcpy(data + i * stride, &prev, sizeof(prev));
+    }
+    return !reader.overrun();
+}
+
+void encodeColumn(const LogStructColumn& column, std::size_t record_size, const std::byte* records,
+                  std::size_t count, std::vector<std::byte>& out) {
+    const std::byte* data = records + column.offset;
+    switch (column.kind) {
+        case LogStructColumn::Kind::kTimestamp: {
+            std::int64_t prev = 0, prev_delta = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                std::int64_t value = loadInteger(data + i * record_size, 8, true);
+                std::int64_t delta = static_cast<std::int64_t>(static_cast<std::uint64_t>(value) -
+                                                               static_cast<std::uint64_t>(prev));
+                putVarint(out, zigzag(static_cast<std::int64_t>(
+                                   static_cast<std::uint64_t>(delta) -
+                                   static_cast<std::uint64_t>(prev_delta))));
+                prev       = value;
+                prev_delta = delta;
+            }
+            break;
+        }
+        case LogStructColumn::Kind::kSigned:
+        case LogStructColumn::Kind::kUnsigned: {
+            bool         is_signed = column.kind == LogStructColumn::Kind::kSigned;
+            std::int64_t prev      = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                std::int64_t value = loadInteger(data + i * record_size, column.size, is_signed);
+                putVarint(out, zigzag(static_cast<std::int64_t>(static_cast<std::uint64_t>(value) -
+                                                                static_cast<std::uint64_t>(prev))));
+                prev = value;
+            }
+            break;
+        }
+        case LogStructColumn::Kind::kFloat:
+            encodeXor<std::uint32_t>(data, record_size, count, out);
+            break;
+        case LogStructColumn::Kind::kDouble:
+            encodeXor<std::uint64_t>(data, record_size, count, out);
+            break;
+        case LogStructColumn::Kind::kBytes: {
+            std::size_t pos = out.size();
+            out.resize(pos + count * column.size);
+            for (std::size_t i = 0; i < count; ++i) {
+                std::memcpy(out.data() + pos + i * column.size, data + i * record_size,
+                            column.size);
+            }
+            break;
+        }
+    }
+}
+
+// data 指向第一个值，相邻两个值相距 stride 字节
+bool decodeColumn(const LogStructColumn& column, const std::byte* begin, const std::byte* end,
+                  std::size_t count, std::byte* data, std::size_t stride) {
+    switch (column.kind) {
+        case LogStructColumn::Kind::kTimestamp: {
+            std::uint64_t prev = 0, prev_delta = 0, encoded;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (!getVarint(begin, end, encoded))
+                    return false;
+                prev_delta += static_cast<std::uint64_t>(unzigzag(encoded));
+                prev += prev_delta;
+                storeInteger(data + i * stride, 8, static_cast<std::int64_t>(prev));
+            }
+            return true;
+        }
+        case LogStructColumn::Kind::kSigned:
+        case LogStructColumn::Kind::kUnsigned: {
+            std::uint64_t prev = 0, encoded;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (!getVarint(begin, end, encoded))
+                    return false;
+                prev += static_cast<std::uint64_t>(unzigzag(encoded));
+                storeInteger(data + i * stride, column.size, static_cast<std::int64_t>(prev));
+            }
+            return true;
+        }
+        case LogStructColumn::Kind::kFloat:
+            return decodeXor<std::uint32_t>(begin, end, data, stride, count);
+        case LogStructColumn::Kind::kDouble:
+            return decodeXor<std::uint64_t>(begin, end, data, stride, count);
+        case LogStructColumn::Kind::kBytes:
+            if (static_cast<std::size_t>(end - begin) != count * column.size)
+                return false;
+            for (std::size_t i = 0; i < count; ++i) {
+                std::memcpy(data + i * stride, begin + i * column.size, column.size);
+            }
+            return true;
+    }
+    return false;
+}
+
+std::uint32_t streamSize(const std::byte* payload, std::size_t column) {
+    std::uint32_t size;
+    std::memcpy(&size, payload + (column + 1) * sizeof(std::uint32_t), sizeof(size));
+    return size;
+}
+
+// 按列原样转置（kColumnar）。tile 把 4 行 × 4 个 8 字节值转置写出，
+// 行距分别为 src_stride 和 dst_stride；4x4 转置是自身的逆，编码和解码共用
+using Tile = void (*)(const std::byte* src, std::size_t src_stride, std::byte* dst,
+                      std::size_t dst_stride);
+
+void tileScalar(const std::byte* src, std::size_t src_stride, std::byte* dst,
+                std::size_t dst_stride) {
+    for (std::size_t row = 0; row < 4; ++row) {
+        for (std::size_t col = 0; col < 4; ++col) {
+            std::memcpy(dst + col * dst_stride + row * 8, src + row * src_stride + col * 8, 8);
+        }
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) void tileAvx2(const std::byte* src, std::size_t src_stride,
+                                               std::byte* dst, std::size_t dst_stride) {
+    // 目标属性不作用于 lambda，这里逐行展开
+    __m256i r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    __m256i r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + src_stride));
+    __m256i r2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * src_stride));
+    __m256i r3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 3 * src_stride));
+    // t0 = r0[0] r1[0] r0[2] r1[2]，t1 = r0[1] r1[1] r0[3] r1[3]，t2 / t3 同理
+    __m256i t0 = _mm256_unpacklo_epi64(r0, r1);
+    __m256i t1 = _mm256_unpackhi_epi64(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi64(r2, r3);
+    __m256i t3 = _mm256_unpackhi_epi64(r2, r3);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                        _mm256_permute2x128_si256(t0, t2, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + dst_stride),
+                        _mm256_permute2x128_si256(t1, t3, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * dst_stride),
+                        _mm256_permute2x128_si256(t0, t2, 0x31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 3 * dst_stride),
+                        _mm256_permute2x128_si256(t1, t3, 0x31));
+}
+#endif
+
+Tile selectTile() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        return tileAvx2;
+#endif
+    return tileScalar;
+}
+
+// 按常见宽度展开 memcpy，避免逐值调用变长拷贝
+void copyStrided(const std::byte* src, std::size_t src_stride, std::byte* dst,
+                 std::size_t dst_stride, std::size_t size, std::size_t count) {
+    auto copy = [&]<std::size_t N>(std::integral_constant<std::size_t, N>) {
+        for (std::size_t i = 0; i < count; ++i) {
+            std::memcpy(dst + i * dst_stride, src + i * src_stride, N);
+        }
+    };
+    switch (size) {
+        case 1:
+            copy(std::integral_constant<std::size_t, 1>{});
+            break;
+        case 2:
+            copy(std::integral_constant<std::size_t, 2>{});
+            break;
+        case 4:
+            copy(std::integral_constant<std::size_t, 4>{});
+            break;
+        case 8:
+            copy(std::integral_constant<std::size_t, 8>{});
+            break;
+        default:
+            for (std::size_t i = 0; i < count; ++i) {
+                std::memcpy(dst + i * dst_stride, src + i * src_stride, size);
+            }
+    }
+}
+
+// 记录与列流之间的转置：kToColumns 时 from 为记录、to 为列流，否则相反。
+// 列流首尾相连，每列 count * size 字节。偏移相邻的 4 个 8 字节列为一组，
+// 每 4 条记录用一次 tile 转置，其余列逐值拷贝
+template <bool kToColumns>
+void transposeColumns(const std::vector<LogStructColumn>& columns, std::size_t record_size,
+                      std::size_t count, const std::byte* from, std::byte* to) {
+    static const Tile tile = selectTile();
+
+    std::vector<std::size_t> stream_offsets;
+    std::size_t              offset = 0;
+    for (const auto& column : columns) {
+        stream_offsets.push_back(offset);
+        offset += count * column.size;
+    }
+    // 第 i 条记录第 j 列的值在记录区和列流中的偏移，从 first 开始拷贝 n 条
+    auto copy = [&](std::size_t j, std::size_t first, std::size_t n) {
+        std::size_t size   = columns[j].size;
+        std::size_t record = first * record_size + columns[j].offset;
+        std::size_t stream = stream_offsets[j] + first * size;
+        if constexpr (kToColumns)
+            copyStrided(from + record, record_size, to + stream, size, size, n);
+        else
+            copyStrided(from + stream, size, to + record, record_size, size, n);
+    };
+    auto grouped = [&](std::size_t j) {
+        if (j + 4 > columns.size())
+            return false;
+        for (std::size_t k = j; k < j + 4; ++k) {
+            if (columns[k].size != 8 || columns[k].offset != columns[j].offset + (k - j) * 8)
+                return false;
+        }
+        return true;
+    };
+
+    std::vector<std::size_t> groups;
+    for (std::size_t j = 0; j < columns.size();) {
+        if (grouped(j)) {
+            groups.push_back(j);
+            j += 4;
+        } else {
+            copy(j++, 0, count);
+        }
+    }
+
+    std::size_t tiled = count - count % 4;
+    for (std::size_t i = 0; i < tiled; i += 4) {
+        for (std::size_t j : groups) {
+            std::size_t record = i * record_size + columns[j].offset;
+            std::size_t stream = stream_offsets[j] + i * 8;
+            if constexpr (kToColumns)
+                tile(from + record, record_size, to + stream, count * 8);
+            else
+                tile(from + stream, count * 8, to + record, record_size);
+        }
+    }
+    for (std::size_t j : groups) {
+        for (std::size_t k = j; k < j + 4; ++k) {
+            copy(k, tiled, count - tiled);
+        }
+    }
+}
+
+// 校验负载中的列目录，返回第一列流的起点，非法时返回 nullptr
+const std::byte* columnStreams(const std::vector<LogStructColumn>& columns,
+                               const LogStructBlockHeader& header, const std::byte* payload) {
+    std::uint32_t column_count;
+    if (header.payload_size < sizeof(column_count))
+        return nullptr;
+    std::memcpy(&column_count, payload, sizeof(column_count));
+    std::size_t directory_size = (column_count + 1) * sizeof(std::uint32_t);
+    if (column_count != columns.size() || header.payload_size < directory_size)
+        return nullptr;
+
+    std::size_t total = directory_size;
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        std::uint32_t size = streamSize(payload, i);
+        if (header.codec == static_cast<std::uint32_t>(LogStructCodec::kColumnar) &&
+            size != std::size_t{header.record_count} * columns[i].size)
+            return nullptr;
+        total += size;
+    }
+    return total == header.payload_size ? payload + directory_size : nullptr;
+}
+
+LogStructColumn::Kind columnKind(const LogStructField& field, bool is_timestamp) {
+    switch (field.type) {
+        case FieldType::kInt8:
+        case FieldType::kInt16:
+        case FieldType::kInt32:
+        case FieldType::kInt64:
+            if (is_timestamp && field.size == 8)
+                return LogStructColumn::Kind::kTimestamp;
+            return LogStructColumn::Kind::kSigned;
+        case FieldType::kUInt8:
+        case FieldType::kUInt16:
+        case FieldType::kUInt32:
+        case FieldType::kUInt64:
+            if (is_timestamp && field.size == 8)
+                return LogStructColumn::Kind::kTimestamp;
+            return LogStructColumn::Kind::kUnsigned;
+        case FieldType::kFloat:
+            return field.size == 4 ? LogStructColumn::Kind::kFloat : LogStructColumn::Kind::kBytes;
+        case FieldType::kDouble:
+            return field.size == 8 ? LogStructColumn::Kind::kDouble : LogStructColumn::Kind::kBytes;
+        case FieldType::kBytes:
+            break;
+    }
+    return LogStructColumn::Kind::kBytes;
+}
+
+// CRC32C 的反射多项式
+constexpr std::uint32_t kCrc32cPoly = 0x82f63b78;
+
+constexpr auto kCrc32cTable = [] {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (crc & 1 ? kCrc32cPoly : 0);
+        table[i] = crc;
+    }
+    return table;
+}();
+
+// crc 为未取反的中间值
+using Crc32c = std::uint32_t (*)(const std::byte* data, std::size_t size, std::uint32_t crc);
+
+std::uint32_t crc32cScalar(const std::byte* data, std::size_t size, std::uint32_t crc) {
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = (crc >> 8) ^ kCrc32cTable[(crc ^ static_cast<std::uint8_t>(data[i])) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) std::uint32_t crc32cSse42(const std::byte* data,
+                                                             std::size_t size, std::uint32_t crc) {
+    std::uint64_t value = crc;
+    for (; size >= 8; data += 8, size -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        value = _mm_crc32_u64(value, word);
+    }
+    auto result = static_cast<std::uint32_t>(value);
+    for (; size > 0; ++data, --size) {
+        result = _mm_crc32_u8(result, static_cast<std::uint8_t>(*data));
+    }
+    return result;
+}
+#endif
+
+Crc32c selectCrc32c() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2"))
+        return crc32cSse42;
+#endif
+    return crc32cScalar;
+}
+
+// 块头（crc 置 0）和负载的 CRC32C
+std::uint32_t blockCrc(LogStructBlockHeader header, const std::byte* payload) {
+    header.crc = 0;
+    std::uint32_t crc = crc32c(reinterpret_cast<const std::byte*>(&header), sizeof(header));
+    return crc32c(payload, header.payload_size, crc);
+}
+
+}  // namespace
+
+std::vector<LogStructColumn> planLogStructColumns(std::size_t                        record_size,
+                                                  const std::vector<LogStructField>& fields,
+                                                  std::uint32_t timestamp_field) {
+    std::vector<int> order(fields.size());
+    for (std::size_t i = 0; i < fields.size(); ++i) order[i] = static_cast<int>(i);
+    std::sort(order.begin(), order.end(),
+              [&](int lhs, int rhs) { return fields[lhs].offset < fields[rhs].offset; });
+
+    std::vector<LogStructColumn> columns;
+    std::uint32_t                pos = 0;
+    for (int index : order) {
+        const auto& field = fields[index];
+        if (field.offset < pos || field.size == 0 || field.offset + field.size > record_size ||
+            (field.type != FieldType::kBytes && field.size > 8)) {
+            // 字段描述不可用：整条记录原样存放
+            auto size = static_cast<std::uint32_t>(record_size);
+            return {{0, size, LogStructColumn::Kind::kBytes, -1}};
+        }
+        if (field.offset > pos)
+            columns.push_back({pos, field.offset - pos, LogStructColumn::Kind::kBytes, -1});
+        bool is_timestamp = static_cast<std::uint32_t>(index) == timestamp_field;
+        columns.push_back({field.offset, field.size, columnKind(field, is_timestamp), index});
+        pos = field.offset + field.size;
+    }
+    if (pos < record_size) {
+        columns.push_back({pos, static_cast<std::uint32_t>(record_size) - pos,
+                           LogStructColumn::Kind::kBytes, -1});
+    }
+    return columns;
+}
+
+void encodeLogStructBlock(LogStructCodec codec, const std::vector<LogStructColumn>& columns,
+                          std::size_t record_size, const std::byte* records, std::size_t count,
+                          std::uint64_t sequence, std::vector<std::byte>& out) {
+    std::size_t block = out.size();
+    out.resize(block + sizeof(LogStructBlockHeader));
+
+    // 负载：[列数][每列的流长度 ...][各列的流 ...]
+    std::size_t directory = out.size();
+    out.resize(directory + (columns.size() + 1) * sizeof(std::uint32_t));
+    auto column_count = static_cast<std::uint32_t>(columns.size());
+    std::memcpy(out.data() + directory, &column_count, sizeof(column_count));
+    auto set_size = [&](std::size_t column, std::size_t size) {
+        auto value = static_cast<std::uint32_t>(size);
+        std::memcpy(out.data() + directory + (column + 1) * sizeof(std::uint32_t), &value,
+                    sizeof(value));
+    };
+
+    if (codec == LogStructCodec::kColumnar) {
+        std::size_t streams = out.size();
+        for (std::size_t i = 0; i < columns.size(); ++i) {
+            set_size(i, count * columns[i].size);
+        }
+        out.resize(streams + count * record_size);
+        transposeColumns<true>(columns, record_size, count, records, out.data() + streams);
+    } else {
+        for (std::size_t i = 0; i < columns.size(); ++i) {
+            std::size_t begin = out.size();
+            encodeColumn(columns[i], record_size, records, count, out);
+            set_size(i, out.size() - begin);
+        }
+    }
+
+    LogStructBlockHeader header;
+    header.magic        = kLogStructBlockMagic;
+    header.codec        = static_cast<std::uint32_t>(codec);
+    header.record_count = static_cast<std::uint32_t>(count);
+    header.payload_size = static_cast<std::uint32_t>(out.size() - directory);
+    header.sequence     = sequence;
+    header.reserved     = 0;
+    header.crc          = blockCrc(header, out.data() + directory);
+    std::memcpy(out.data() + block, &header, sizeof(header));
+}
+
+bool decodeLogStructBlock(const std::vector<LogStructColumn>& columns, std::size_t record_size,
+                          const LogStructBlockHeader& header, const std::byte* payload,
+                          std::byte* records) {
+    const std::byte* stream = columnStreams(columns, header, payload);
+    if (!stream)
+        return false;
+
+    switch (static_cast<LogStructCodec>(header.codec)) {
+        case LogStructCodec::kColumnar:
+            transposeColumns<false>(columns, record_size, header.record_count, stream, records);
+            return true;
+        case LogStructCodec::kDelta:
+            for (std::size_t i = 0; i < columns.size(); ++i) {
+                std::uint32_t size = streamSize(payload, i);
+                if (!decodeColumn(columns[i], stream, stream + size, header.record_count,
+                                  records + columns[i].offset, record_size))
+                    return false;
+                stream += size;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool decodeLogStructColumn(const std::vector<LogStructColumn>& columns, std::size_t column,
+                           const LogStructBlockHeader& header, const std::byte* payload,
+                           std::byte* values) {
+    const std::byte* stream = columnStreams(columns, header, payload);
+    if (!stream || column >= columns.size())
+        return false;
+    for (std::size_t i = 0; i < column; ++i) {
+        stream += streamSize(payload, i);
+    }
+
+    std::uint32_t size = streamSize(payload, column);
+    switch (static_cast<LogStructCodec>(header.codec)) {
+        case LogStructCodec::kColumnar:
+            std::memcpy(values, stream, size);
+            return true;
+        case LogStructCodec::kDelta:
+            return decodeColumn(columns[column], stream, stream + size, header.record_count, values,
+                                columns[column].size);
+        default:
+            return false;
+    }
+}
+
+bool validLogStructBlock(const LogStructBlockHeader& header, std::uint64_t offset,
+                         std::uint64_t end) {
+    return header.magic == kLogStructBlockMagic && header.record_count > 0 &&
+           offset + sizeof(header) + header.payload_size <= end;
+}
+
+bool checkLogStructBlock(const LogStructBlockHeader& header, const std::byte* payload) {
+    return blockCrc(header, payload) == header.crc;
+}
+
+std::uint32_t crc32c(const std::byte* data, std::size_t size, std::uint32_t crc) {
+    static const Crc32c update = selectCrc32c();
+    return ~update(data, size, ~crc);
+}
+
+}  // namespace utils
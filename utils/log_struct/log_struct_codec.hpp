@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "log_struct_format.hpp"
+
+namespace utils {
+
+// 块编码。kNone 以外的编码下，数据区由连续的块组成：[LogStructBlockHeader][负载]，
+// 每个块对应写线程落盘的一块缓冲区。负载为 [列数][每列的流长度 ...][各列的流 ...]，
+// 每列可以单独解码
+enum class LogStructCodec : std::uint32_t {
+    kNone     = 0,  // 不分块，记录原样连续存放
+    kDelta    = 1,  // 按列编码：时间戳 delta-of-delta，整数 delta + varint，浮点 Gorilla XOR
+    kColumnar = 2,  // 按列原样存放（struct-of-arrays），读取单列时只触及该列的字节
+};
+
+inline constexpr std::uint32_t kLogStructBlockMagic = 0x4b42534c;  // "LSBK"
+
+struct LogStructBlockHeader {
+    std::uint32_t magic;
+    std::uint32_t codec;
+    std::uint32_t record_count;
+    std::uint32_t payload_size;  // 负载字节数，不含块头
+    std::uint64_t sequence;      // 块中第一条记录在本文件中的序号，等于之前各块的记录数之和
+    std::uint32_t crc;           // 块头（crc 置 0）和负载的 CRC32C
+    std::uint32_t reserved;
+};
+static_assert(sizeof(LogStructBlockHeader) == 32);
+
+// 记录按字段划分为列，字段之间的空隙作为原样字节列，保证解码结果与原记录逐字节一致
+struct LogStructColumn {
+    enum class Kind : std::uint8_t {
+        kBytes,      // 原样拷贝
+        kTimestamp,  // int64 delta-of-delta + zigzag varint
+        kSigned,     // delta + zigzag varint
+        kUnsigned,   // delta + zigzag varint（零扩展）
+        kFloat,      // 32 位 Gorilla XOR
+        kDouble,     // 64 位 Gorilla XOR
+    };
+
+    std::uint32_t offset;
+    std::uint32_t size;
+    Kind          kind;
+    int           field;  // 对应 fields 中的下标，空隙为 -1
+};
+
+// 由字段描述生成列划分；字段重叠或越界时整条记录作为一个字节列
+std::vector<LogStructColumn> planLogStructColumns(std::size_t                        record_size,
+                                                  const std::vector<LogStructField>& fields,
+                                                  std::uint32_t timestamp_field);
+
+// 把 count 条记录编码为一个块（含块头）追加到 out，sequence 为第一条记录的序号
+void encodeLogStructBlock(LogStructCodec codec, const std::vector<LogStructColumn>& columns,
+                          std::size_t record_size, const std::byte* records, std::size_t count,
+                          std::uint64_t sequence, std::vector<std::byte>& out);
+
+// 解码一个块的负载到 records（header.record_count 条），负载非法时返回 false
+bool decodeLogStructBlock(const std::vector<LogStructColumn>& columns, std::size_t record_size,
+                          const LogStructBlockHeader& header, const std::byte* payload,
+                          std::byte* records);
+
+// 只解码一个块中的第 column 列，按记录顺序紧凑写入 values（record_count * size 字节）
+bool decodeLogStructColumn(const std::vector<LogStructColumn>& columns, std::size_t column,
+                           const LogStructBlockHeader& header, const std::byte* payload,
+                           std::byte* values);
+
+// 块头是否合法且负载完整位于 [offset, end) 内，不读取负载
+bool validLogStructBlock(const LogStructBlockHeader& header, std::uint64_t offset,
+                         std::uint64_t end);
+
+// 负载是否与块头中的 CRC32C 一致
+bool checkLogStructBlock(const LogStructBlockHeader& header, const std::byte* payload);
+
+// CRC32C（Castagnoli），支持 SSE4.2 时使用 crc32 指令（运行时检测）
+std::uint32_t crc32c(const std::byte* data, std::size_t size, std::uint32_t crc = 0);
+
+}  // namespace utils
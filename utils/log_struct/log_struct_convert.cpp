@@ -0,0 +1,250 @@
+#include "log_struct_convert.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "log_struct_parallel.hpp"
+#include "log_struct_reader.hpp"
+
+namespace utils {
+
+namespace {
+
+// 字段的数值类型与其大小一致时按数值格式化，否则按字节输出
+template <typename V>
+bool appendValue(std::string& out, const std::byte* data, const LogStructField& field) {
+    if (field.size != sizeof(V))
+        return false;
+    V value;
+    std::memcpy(&value, data, sizeof(V));
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+    return true;
+}
+
+void appendField(std::string& out, const std::byte* record, const LogStructField& field) {
+    const std::byte* data = record + field.offset;
+    bool             done = false;
+    switch (field.type) {
+        case FieldType::kInt8:
+            done = appendValue<std::int8_t>(out, data, field);
+            break;
+        case FieldType::kUInt8:
+            done = appendValue<std::uint8_t>(out, data, field);
+            break;
+        case FieldType::kInt16:
+            done = appendValue<std::int16_t>(out, data, field);
+            break;
+        case FieldType::kUInt16:
+            done = appendValue<std::uint16_t>(out, data, field);
+            break;
+        case FieldType::kInt32:
+            done = appendValue<std::int32_t>(out, data, field);
+            break;
+        case FieldType::kUInt32:
+            done = appendValue<std::uint32_t>(out, data, field);
+            break;
+        case FieldType::kInt64:
+            done = appendValue<std::int64_t>(out, data, field);
+            break;
+        case FieldType::kUInt64:
+            done = appendValue<std::uint64_t>(out, data, field);
+            break;
+        case FieldType::kFloat:
+            done = appendValue<float>(out, data, field);
+            break;
+        case FieldType::kDouble:
+            done = appendValue<double>(out, data, field);
+            break;
+        case FieldType::kBytes:
+            break;
+    }
+    if (done)
+        return;
+
+    static constexpr char kHex[] = "0123456789abcdef";
+    for (std::uint32_t i = 0; i < field.size; ++i) {
+        auto byte = static_cast<unsigned>(data[i]);
+        out.push_back(kHex[byte >> 4]);
+        out.push_back(kHex[byte & 0xf]);
+    }
+}
+
+bool pwriteFully(int fd, const void* data, std::size_t size, std::size_t offset) {
+    auto*       bytes   = static_cast<const char*>(data);
+    std::size_t written = 0;
+    while (written < size) {
+        ssize_t result = ::pwrite(fd, bytes + written, size - written,
+                                  static_cast<off_t>(offset + written));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        written += static_cast<std::size_t>(result);
+    }
+    return true;
+}
+
+int openOutput(const std::string& path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd == -1)
+        throw std::runtime_error("Open output failed: " + path);
+    return fd;
+}
+
+}  // namespace
+
+LogStructConvertResult convertLogStruct(const std::string& input, const std::string& output,
+                                        const LogStructConvertOptions& options) {
+    LogStructReader reader(input);
+    if (reader.framed())
+        throw std::invalid_argument("Can not convert framed file");
+
+    std::vector<LogStructField> fields;
+    if (options.fields.empty()) {
+        fields = reader.fields();
+    } else {
+        for (const auto& name : options.fields) {
+            const LogStructField* field = reader.findField(name);
+            if (!field)
+                throw std::invalid_argument("Unknown field: " + name);
+            fields.push_back(*field);
+        }
+    }
+    if (fields.empty())
+        throw std::invalid_argument("No field to convert");
+
+    std::size_t first = 0;
+    std::size_t last  = reader.size();
+    if (options.from)
+        first = reader.lowerBound(*options.from);
+    if (options.to)
+        last = reader.upperBound(*options.to);
+    last = std::max(first, last);
+
+    std::size_t chunk_records = std::max<std::size_t>(options.chunk_records, 1);
+    std::size_t chunks        = (last - first + chunk_records - 1) / chunk_records;
+    std::size_t threads       = options.threads > 0
+                                    ? options.threads
+                                    : std::max(1u, std::thread::hardware_concurrency());
+    auto chunkRange = [&](std::size_t chunk) {
+        std::size_t begin = first + chunk * chunk_records;
+        return std::pair{begin, std::min(begin + chunk_records, last)};
+    };
+
+    LogStructConvertResult result;
+    result.records = last - first;
+
+    if (options.format == LogStructConvertFormat::kColumns) {
+        // 每列的输出偏移由记录下标直接算出，各块之间不需要等待
+        std::filesystem::create_directories(output);
+        std::vector<int> fds;
+        try {
+            for (const auto& field : fields) {
+                auto path = std::filesystem::path(output) / (field.name + ".bin");
+                fds.push_back(openOutput(path.string()));
+            }
+            parallelFor(chunks, threads, [&](std::size_t chunk, std::size_t) {
+                auto [begin, end] = chunkRange(chunk);
+                std::vector<std::byte> values;
+                for (std::size_t f = 0; f < fields.size(); ++f) {
+                    const auto& field = fields[f];
+                    values.resize((end - begin) * field.size);
+                    for (std::size_t i = begin; i < end; ++i) {
+                        std::memcpy(values.data() + (i - begin) * field.size,
+                                    reader.record(i) + field.offset, field.size);
+                    }
+                    if (!pwriteFully(fds[f], values.data(), values.size(),
+                                     (begin - first) * field.size))
+                        throw std::runtime_error("Write output failed: " + field.name);
+                }
+            });
+        } catch (...) {
+            for (int fd : fds) ::close(fd);
+            throw;
+        }
+        for (std::size_t f = 0; f < fields.size(); ++f) {
+            ::close(fds[f]);
+            result.bytes += result.records * fields[f].size;
+        }
+        return result;
+    }
+
+    std::string header;
+    if (options.header) {
+        for (const auto& field : fields) {
+            header.append(field.name).push_back(options.delimiter);
+        }
+        header.back() = '\n';
+    }
+
+    // ends[i] 为第 i 块的输出起点，-1 表示前一块还没有确定长度，-2 表示前面的块失败。
+    // 格式化完成后等待自己的起点，随即公布下一块的起点，再写出自己的数据，写盘不阻塞后续的块
+    constexpr std::int64_t kPending = -1;
+    constexpr std::int64_t kFailed  = -2;
+
+    int fd = openOutput(output);
+    std::vector<std::atomic<std::int64_t>> ends(chunks + 1);
+    for (auto& end : ends) end.store(kPending, std::memory_order_relaxed);
+    ends[0].store(static_cast<std::int64_t>(header.size()));
+    if (!pwriteFully(fd, header.data(), header.size(), 0)) {
+        ::close(fd);
+        throw std::runtime_error("Write output failed: " + output);
+    }
+
+    auto publish = [&](std::size_t chunk, std::int64_t value) {
+        ends[chunk].store(value, std::memory_order_release);
+        ends[chunk].notify_all();
+    };
+
+    try {
+        parallelFor(chunks, threads, [&](std::size_t chunk, std::size_t) {
+            auto [begin, end] = chunkRange(chunk);
+            std::string text;
+            try {
+                text.reserve((end - begin) * fields.size() * 12);
+                for (std::size_t i = begin; i < end; ++i) {
+                    const std::byte* record = reader.record(i);
+                    for (const auto& field : fields) {
+                        appendField(text, record, field);
+                        text.push_back(options.delimiter);
+                    }
+                    text.back() = '\n';
+                }
+            } catch (...) {
+                publish(chunk + 1, kFailed);
+                throw;
+            }
+
+            // 块按顺序领取，前一块一定已有线程在处理，等待只取决于其格式化耗时
+            ends[chunk].wait(kPending, std::memory_order_acquire);
+            std::int64_t offset = ends[chunk].load(std::memory_order_acquire);
+            if (offset == kFailed) {
+                publish(chunk + 1, kFailed);
+                return;
+            }
+            publish(chunk + 1, offset + static_cast<std::int64_t>(text.size()));
+            if (!pwriteFully(fd, text.data(), text.size(), static_cast<std::size_t>(offset)))
+                throw std::runtime_error("Write output failed: " + output);
+        });
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    result.bytes = static_cast<std::size_t>(ends[chunks].load());
+    return result;
+}
+
+}  // namespace utils
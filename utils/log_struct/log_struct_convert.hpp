@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+// 转换的输出格式
+enum class LogStructConvertFormat {
+    kCsv,      // 一个 CSV 文件，首行为字段名，数值用 std::to_chars 格式化，kBytes 字段输出十六进制
+    kColumns,  // 输出目录下每个字段一个 <name>.bin，按记录顺序紧凑存放原始值，可直接 np.fromfile
+};
+
+struct LogStructConvertOptions {
+    LogStructConvertFormat format = LogStructConvertFormat::kCsv;
+
+    // 输出的字段，按给定顺序；为空时输出全部字段
+    std::vector<std::string> fields;
+
+    // 时间范围 [from, to]（时间戳字段的取值），需要文件有 8 字节的时间戳字段
+    std::optional<std::int64_t> from;
+    std::optional<std::int64_t> to;
+
+    std::size_t threads       = 0;      // 0 表示 std::thread::hardware_concurrency()
+    std::size_t chunk_records = 65536;  // 每个任务处理的记录数
+    char        delimiter     = ',';
+    bool        header        = true;   // CSV 首行输出字段名
+};
+
+struct LogStructConvertResult {
+    std::size_t records = 0;  // 转换的记录数
+    std::size_t bytes   = 0;  // 写出的总字节数
+};
+
+// 把 LogStruct 文件 input 转换后写入 output（kColumns 时为目录，不存在时创建）。
+// 输入按记录对齐切分为 chunk_records 条一块，由 threads 个线程并行格式化；
+// 每块的输出偏移在前一块确定长度后立即可知，各线程用 pwrite 按偏移并发写出，输出顺序与输入一致。
+// 输入、输出或字段名非法，或输入为帧模式文件时抛出异常
+LogStructConvertResult convertLogStruct(const std::string& input, const std::string& output,
+                                        const LogStructConvertOptions& options = {});
+
+}  // namespace utils
@@ -0,0 +1,139 @@
+#include "log_struct_follower.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "log_struct_reader.hpp"
+
+namespace utils {
+
+LogStructFollower::LogStructFollower(const std::string& path, LogStructFollowStart start) {
+    open(path, std::nullopt);
+    if (start == LogStructFollowStart::kEnd)
+        position_ = available();
+}
+
+LogStructFollower::LogStructFollower(const std::string& path, std::int64_t timestamp) {
+    open(path, timestamp);
+}
+
+LogStructFollower::~LogStructFollower() { close(); }
+
+void LogStructFollower::open(const std::string& path, std::optional<std::int64_t> timestamp) {
+    {
+        // 文件头的校验和解析与 LogStructReader 相同
+        LogStructReader reader(path);
+        if (reader.header().flags & (kLogStructFlagBlocks | kLogStructFlagFramed))
+            throw std::runtime_error("Can not follow encoded or framed file: " + path);
+        header_ = reader.header();
+        fields_ = reader.fields();
+        if (timestamp)
+            position_ = reader.lowerBound(*timestamp);
+    }
+
+    fd_         = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    event_fd_   = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ == -1 || inotify_fd_ == -1 || event_fd_ == -1 ||
+        ::inotify_add_watch(inotify_fd_, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE) == -1) {
+        close();
+        throw std::runtime_error("Follow failed: " + path);
+    }
+}
+
+void LogStructFollower::close() {
+    if (map_)
+        ::munmap(map_, map_size_);
+    for (int fd : {fd_, inotify_fd_, event_fd_}) {
+        if (fd != -1)
+            ::close(fd);
+    }
+    map_ = nullptr;
+    fd_  = inotify_fd_ = event_fd_ = -1;
+}
+
+std::size_t LogStructFollower::available() const {
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<std::size_t>(st.st_size) < header_.header_size)
+        return 0;
+    std::size_t data_size = static_cast<std::size_t>(st.st_size) - header_.header_size;
+
+    // kMmap 后端运行中文件末尾是预分配的全零区域，以 data_size 为准
+    LogStructFileHeader header;
+    if (::pread(fd_, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+        (header.flags & kLogStructFlagPreallocated))
+        data_size = std::min<std::size_t>(data_size, header.data_size);
+    return data_size / header_.record_size;
+}
+
+void LogStructFollower::map(std::size_t size) {
+    if (size <= map_size_)
+        return;
+
+    // 按两倍预留，文件增长时少做 mremap；超出文件末尾的部分不会被访问
+    std::size_t capacity = std::max(size * 2, std::size_t{1} << 20);
+    void*       map      = map_ ? ::mremap(map_, map_size_, capacity, MREMAP_MAYMOVE)
+                                : ::mmap(nullptr, capacity, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED)
+        throw std::runtime_error("Mmap failed");
+    map_      = map;
+    map_size_ = capacity;
+}
+
+std::span<const std::byte> LogStructFollower::next(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        // 先检查再等待：检查之后的追加一定会在 inotify 中留下事件
+        std::size_t count = available();
+        if (count > position_) {
+            map(header_.header_size + count * header_.record_size);
+            auto* begin = static_cast<const std::byte*>(map_) + header_.header_size +
+                          position_ * header_.record_size;
+            std::span<const std::byte> records(begin, (count - position_) * header_.record_size);
+            position_ = count;
+            return records;
+        }
+        if (!wait(deadline))
+            return {};
+    }
+}
+
+bool LogStructFollower::wait(std::chrono::steady_clock::time_point deadline) {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline)
+        return false;
+    auto     remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+    timespec timeout{static_cast<time_t>(remaining.count() / 1000000000),
+                     static_cast<long>(remaining.count() % 1000000000)};
+
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {event_fd_, POLLIN, 0}};
+    int    ready  = ::ppoll(fds, 2, &timeout, nullptr);
+    if (ready <= 0)
+        return ready < 0 && errno == EINTR;
+
+    if (fds[1].revents & POLLIN) {
+        std::uint64_t value;
+        ::read(event_fd_, &value, sizeof(value));
+        return false;
+    }
+    // 读空事件队列，事件内容不重要
+    alignas(inotify_event) char events[4096];
+    while (::read(inotify_fd_, events, sizeof(events)) > 0) {
+    }
+    return true;
+}
+
+void LogStructFollower::interrupt() {
+    std::uint64_t value = 1;
+    ::write(event_fd_, &value, sizeof(value));
+}
+
+}  // namespace utils
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "log_struct_format.hpp"
+
+namespace utils {
+
+// 跟随的起点
+enum class LogStructFollowStart {
+    kEnd,        // 打开时文件中已有的记录之后
+    kBeginning,  // 第一条记录
+};
+
+// 跟随正在写入的 LogStruct 文件：mmap 文件并用 inotify 等待追加，不轮询。
+// 每次只交出完整的记录，写入方正在追加的不完整尾部留到下一次。
+// 只支持未编码的文件（kMmap 后端的预分配文件以文件头的 data_size 为准，
+// 其写入对 inotify 不可见，延迟取决于后台线程更新文件头的间隔）。
+// 不跟随段轮转，打开失败或文件是编码文件时抛出 std::runtime_error
+class LogStructFollower {
+   public:
+    explicit LogStructFollower(const std::string& path,
+                               LogStructFollowStart start = LogStructFollowStart::kEnd);
+    // 从第一条 timestamp >= value 的记录开始，需要文件有 8 字节的时间戳字段
+    LogStructFollower(const std::string& path, std::int64_t timestamp);
+    ~LogStructFollower();
+
+    LogStructFollower(const LogStructFollower&)            = delete;
+    LogStructFollower& operator=(const LogStructFollower&) = delete;
+
+    const LogStructFileHeader&         header() const { return header_; }
+    const std::vector<LogStructField>& fields() const { return fields_; }
+    std::size_t                        recordSize() const { return header_.record_size; }
+
+    // 下一条要交出的记录下标（从文件开头计）
+    std::size_t position() const { return position_; }
+
+    // 等待新的完整记录，最多等待 timeout。返回从 position() 开始连续的若干条记录，
+    // 超时或被 interrupt() 打断时为空。返回的内存在下一次调用 next() 前有效
+    std::span<const std::byte> next(std::chrono::milliseconds timeout);
+
+    // 类型化版本，sizeof(T) 必须等于记录大小
+    template <typename T>
+    std::span<const T> next(std::chrono::milliseconds timeout) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (sizeof(T) != recordSize())
+            throw std::invalid_argument("record size mismatch");
+        auto bytes = next(timeout);
+        return {reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+    }
+
+    // 可在其他线程调用，唤醒阻塞中的 next()（尚未进入等待时作用于下一次等待）
+    void interrupt();
+
+   private:
+    // 解析文件头并打开 inotify，给出 timestamp 时按时间戳定位起点
+    void open(const std::string& path, std::optional<std::int64_t> timestamp);
+    void close();
+    // 当前文件中完整记录的数量
+    std::size_t available() const;
+    // 保证映射覆盖文件的前 size 字节
+    void map(std::size_t size);
+    // 等待文件变化，超时或被打断时返回 false
+    bool wait(std::chrono::steady_clock::time_point deadline);
+
+    int                         fd_         = -1;
+    int                         inotify_fd_ = -1;
+    int                         event_fd_   = -1;
+    void*                       map_        = nullptr;
+    std::size_t                 map_size_   = 0;
+    std::size_t                 position_   = 0;
+    LogStructFileHeader         header_     = {};
+    std::vector<LogStructField> fields_;
+};
+
+}  // namespace utils
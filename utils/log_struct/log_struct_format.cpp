@@ -0,0 +1,112 @@
+#include "log_struct_format.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <format>
+
+#include "version/version.hpp"
+
+namespace utils {
+
+std::vector<std::byte> buildLogStructHeader(std::size_t                        record_size,
+                                            const std::vector<LogStructField>& fields,
+                                            std::uint32_t                      flags) {
+    std::size_t size = sizeof(LogStructFileHeader) + fields.size() * sizeof(LogStructFieldDesc);
+    size = (size + kLogStructHeaderAlign - 1) / kLogStructHeaderAlign * kLogStructHeaderAlign;
+    std::vector<std::byte> bytes(size);
+
+    LogStructFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kLogStructMagic, sizeof(header.magic));
+    header.version         = kLogStructFormatVersion;
+    header.header_size     = static_cast<std::uint32_t>(size);
+    header.record_size     = static_cast<std::uint32_t>(record_size);
+    header.field_count     = static_cast<std::uint32_t>(fields.size());
+    header.flags           = flags;
+    header.timestamp_field = kLogStructNoTimestamp;
+
+    // 同一时刻采样两个时钟，读者可以把单调时钟时间戳换算为墙上时间
+    header.clock_base_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    header.steady_base_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now().time_since_epoch())
+                                .count();
+
+    auto build_id =
+        std::format("{}+{}{}", PROJECT_VERSION, GIT_COMMIT_ID, GIT_DIRTY ? "-dirty" : "");
+    std::memcpy(header.build_id, build_id.data(),
+                std::min(build_id.size(), sizeof(header.build_id) - 1));
+
+    auto* descs = reinterpret_cast<LogStructFieldDesc*>(bytes.data() + sizeof(header));
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        const auto&        field = fields[i];
+        LogStructFieldDesc desc;
+        std::memset(&desc, 0, sizeof(desc));
+        std::memcpy(desc.name, field.name.data(),
+                    std::min(field.name.size(), sizeof(desc.name) - 1));
+        desc.type   = static_cast<std::uint32_t>(field.type);
+        desc.offset = field.offset;
+        desc.size   = field.size;
+        desc.schema = field.schema;
+        std::memcpy(&descs[i], &desc, sizeof(desc));
+
+        if (field.name == "timestamp" && header.timestamp_field == kLogStructNoTimestamp &&
+            !(flags & kLogStructFlagFramed))
+            header.timestamp_field = static_cast<std::uint32_t>(i);
+    }
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return bytes;
+}
+
+std::string validateLogStructHeader(const LogStructFileHeader& header, std::size_t file_size) {
+    if (std::memcmp(header.magic, kLogStructMagic, sizeof(header.magic)) != 0)
+        return "bad magic";
+    if (header.version != kLogStructFormatVersion &&
+        (header.version != 1 || (header.flags & kLogStructFlagBlocks)))
+        return std::format("unsupported version {}", header.version);
+    if (header.record_size == 0)
+        return "zero record size";
+    std::size_t min_size =
+        sizeof(LogStructFileHeader) + header.field_count * sizeof(LogStructFieldDesc);
+    if (header.header_size < min_size || header.header_size > file_size)
+        return std::format("bad header size {}", header.header_size);
+    if (header.timestamp_field != kLogStructNoTimestamp &&
+        header.timestamp_field >= header.field_count)
+        return std::format("bad timestamp field {}", header.timestamp_field);
+    return {};
+}
+
+std::string logStructSegmentPath(const std::string& log_path, std::uint64_t seq) {
+    return std::format("{}.{:06}", log_path, seq);
+}
+
+std::vector<LogStructSegmentFile> listLogStructSegments(const std::string& log_path) {
+    std::filesystem::path base(log_path);
+    std::filesystem::path dir    = base.has_parent_path() ? base.parent_path() : ".";
+    std::string           prefix = base.filename().string() + ".";
+
+    std::vector<LogStructSegmentFile> segments;
+    std::error_code                   ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (!name.starts_with(prefix) || name.size() == prefix.size())
+            continue;
+        // 只接受纯数字后缀，排除 .idx 等 sidecar
+        std::uint64_t seq  = 0;
+        const char*   from = name.data() + prefix.size();
+        const char*   to   = name.data() + name.size();
+        auto [ptr, error]  = std::from_chars(from, to, seq);
+        if (error != std::errc() || ptr != to)
+            continue;
+        segments.push_back({seq, entry.path().string()});
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.seq < rhs.seq; });
+    return segments;
+}
+
+}  // namespace utils
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace utils {
+
+// LogStruct 文件格式：
+// [LogStructFileHeader][LogStructFieldDesc * field_count][填充到 header_size][记录 ...]
+inline constexpr char          kLogStructMagic[8]      = {'L', 'O', 'G', 'S', 'T', 'R', 'C', 'T'};
+// 版本 2：块头增加序号和 CRC32C，文件头增加 checkpoint。不分块的版本 1 文件格式相同，仍可读写
+inline constexpr std::uint32_t kLogStructFormatVersion = 2;
+inline constexpr std::uint32_t kLogStructHeaderAlign   = 4096;
+inline constexpr std::uint32_t kLogStructNoTimestamp   = static_cast<std::uint32_t>(-1);
+inline constexpr std::size_t   kLogStructFieldNameSize = 32;
+inline constexpr std::size_t   kLogStructBuildIdSize   = 64;
+
+// 文件头 flags
+// 写入方预分配了文件末尾（mmap 后端运行中或异常退出），有效数据长度以 data_size 为准
+inline constexpr std::uint32_t kLogStructFlagPreallocated = 1u << 0;
+// 数据区由编码块组成（见 log_struct_codec.hpp），不能按 record_size 直接寻址
+inline constexpr std::uint32_t kLogStructFlagBlocks = 1u << 1;
+// 数据区由变长帧组成（见 LogStructFrameHeader），record_size 为帧的对齐单位
+inline constexpr std::uint32_t kLogStructFlagFramed = 1u << 2;
+
+// 字段类型
+enum class FieldType : std::uint32_t {
+    kInt8,
+    kUInt8,
+    kInt16,
+    kUInt16,
+    kInt32,
+    kUInt32,
+    kInt64,
+    kUInt64,
+    kFloat,
+    kDouble,
+    kBytes,  // 不透明字节
+};
+
+// 记录中的一个字段
+struct LogStructField {
+    std::string   name;
+    FieldType     type   = FieldType::kBytes;
+    std::uint32_t offset = 0;  // 帧模式下为负载内的偏移
+    std::uint32_t size   = 0;
+    std::uint32_t schema = 0;  // 帧模式下字段所属的记录类型
+};
+
+// 帧模式中的一种记录类型及其字段
+struct LogStructSchema {
+    std::uint32_t               type;
+    std::vector<LogStructField> fields;
+};
+
+// 帧模式：每条记录为 [LogStructFrameHeader][负载][填充到 kLogStructFrameAlign]，
+// 不同类型的记录共用一个缓冲区、写线程和文件
+struct LogStructFrameHeader {
+    std::uint32_t type;
+    std::uint32_t size;  // 负载字节数，不含帧头和填充
+};
+static_assert(sizeof(LogStructFrameHeader) == 8);
+
+inline constexpr std::size_t kLogStructFrameAlign = 8;
+// 多生产者的预留越过缓冲区末尾时用于补齐剩余空间的填充帧，读者跳过
+inline constexpr std::uint32_t kLogStructPaddingFrame = static_cast<std::uint32_t>(-1);
+
+// 负载为 payload 字节的帧在缓冲区中占用的字节数
+constexpr std::size_t logStructFrameSize(std::size_t payload) {
+    return (sizeof(LogStructFrameHeader) + payload + kLogStructFrameAlign - 1) &
+           ~(kLogStructFrameAlign - 1);
+}
+
+// 文件头（小端，定长 128 字节）
+struct LogStructFileHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;      // 头部总长度，第一条记录从这里开始
+    std::uint32_t record_size;
+    std::uint32_t field_count;
+    std::int64_t  clock_base_us;    // 文件创建时的 system_clock（微秒）
+    std::int64_t  steady_base_ns;   // 同一时刻的 steady_clock（纳秒），用于换算单调时钟时间戳
+    std::uint64_t data_size;        // 有效数据字节数，仅在 kLogStructFlagPreallocated 置位时有效
+    std::uint32_t flags;
+    std::uint32_t timestamp_field;  // 时间戳字段下标，没有时为 kLogStructNoTimestamp
+    char          build_id[kLogStructBuildIdSize];  // 生产者的版本和 git commit
+    std::uint64_t checkpoint;  // 编码文件中已同步到磁盘的最后一个块的偏移，0 表示未知
+};
+static_assert(sizeof(LogStructFileHeader) == 128);
+
+// 文件中的字段描述（定长 48 字节）
+struct LogStructFieldDesc {
+    char          name[kLogStructFieldNameSize];
+    std::uint32_t type;
+    std::uint32_t offset;
+    std::uint32_t size;
+    std::uint32_t schema;  // 帧模式下字段所属的记录类型，否则为 0
+};
+static_assert(sizeof(LogStructFieldDesc) == 48);
+
+template <typename T>
+constexpr FieldType fieldTypeOf() {
+    if constexpr (std::is_same_v<T, std::int8_t>)
+        return FieldType::kInt8;
+    else if constexpr (std::is_same_v<T, std::uint8_t>)
+        return FieldType::kUInt8;
+    else if constexpr (std::is_same_v<T, std::int16_t>)
+        return FieldType::kInt16;
+    else if constexpr (std::is_same_v<T, std::uint16_t>)
+        return FieldType::kUInt16;
+    else if constexpr (std::is_same_v<T, std::int32_t>)
+        return FieldType::kInt32;
+    else if constexpr (std::is_same_v<T, std::uint32_t>)
+        return FieldType::kUInt32;
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 8)
+        return FieldType::kInt64;
+    else if constexpr (std::is_integral_v<T> && std::is_unsigned_v<T> && sizeof(T) == 8)
+        return FieldType::kUInt64;
+    else if constexpr (std::is_same_v<T, float>)
+        return FieldType::kFloat;
+    else if constexpr (std::is_same_v<T, double>)
+        return FieldType::kDouble;
+    else
+        return FieldType::kBytes;
+}
+
+// 按字段描述构造文件头，header_size 向上对齐到 kLogStructHeaderAlign。
+// 帧模式（flags 含 kLogStructFlagFramed）的文件没有时间戳字段
+std::vector<std::byte> buildLogStructHeader(std::size_t                        record_size,
+                                            const std::vector<LogStructField>& fields,
+                                            std::uint32_t                      flags = 0);
+
+// 校验文件头，失败时返回错误描述，成功返回空字符串
+std::string validateLogStructHeader(const LogStructFileHeader& header, std::size_t file_size);
+
+// 开启段轮转后，每个段是一个独立的 LogStruct 文件，命名为 <log_path>.<seq>（seq 补零到 6 位）
+struct LogStructSegmentFile {
+    std::uint64_t seq;
+    std::string   path;
+};
+
+std::string logStructSegmentPath(const std::string& log_path, std::uint64_t seq);
+
+// 按序号升序列出 log_path 的所有段
+std::vector<LogStructSegmentFile> listLogStructSegments(const std::string& log_path);
+
+}  // namespace utils
+
+// 描述结构体的一个字段，用法:
+// options.fields = {UTILS_LOG_STRUCT_FIELD(TestData, timestamp),
+//                   UTILS_LOG_STRUCT_FIELD(TestData, a)};
+#define UTILS_LOG_STRUCT_FIELD(Type, member)                                              \
+    utils::LogStructField {                                                               \
+        #member, utils::fieldTypeOf<std::remove_cvref_t<decltype(Type::member)>>(),       \
+            static_cast<std::uint32_t>(offsetof(Type, member)),                           \
+            static_cast<std::uint32_t>(sizeof(Type::member)), 0                           \
+    }
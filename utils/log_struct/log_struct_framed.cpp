@@ -0,0 +1,58 @@
+#include "log_struct.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace utils {
+
+namespace {
+
+// 所有记录类型的字段展开为文件头中的一个列表，schema 取所属的记录类型
+LogStructOptions framedOptions(const LogStructOptions&             options,
+                               const std::vector<LogStructSchema>& schemas) {
+    LogStructOptions framed = options;
+    framed.fields.clear();
+    for (const auto& schema : schemas) {
+        for (auto field : schema.fields) {
+            field.schema = schema.type;
+            framed.fields.push_back(std::move(field));
+        }
+    }
+    return framed;
+}
+
+}  // namespace
+
+LogStructFramed::LogStructFramed(const std::string& log_path, std::size_t buffer_bytes,
+                                 std::size_t                         polling_interval,
+                                 const std::vector<LogStructSchema>& schemas,
+                                 const LogStructOptions&             options)
+    : LogStruct(log_path, kLogStructFrameAlign, buffer_bytes / kLogStructFrameAlign,
+                polling_interval, framedOptions(options, schemas), true) {}
+
+bool LogStructFramed::write(std::uint32_t type, const std::byte* data, std::size_t size) {
+    ScopedLatency latency(histograms_ ? &histograms_->write : nullptr);
+
+    LogStructFrameHeader header{type, static_cast<std::uint32_t>(size)};
+    std::size_t          frame_size = logStructFrameSize(size);
+    Buffer*              buffer     = nullptr;
+    std::byte*           slot       = acquireSlot(frame_size, buffer);
+    if (!slot) {
+        if (overflow_ != LogStructOverflow::kSpill)
+            return false;
+        // 溢出文件需要连续的整帧
+        static thread_local std::vector<std::byte> frame;
+        frame.assign(frame_size, std::byte{0});
+        std::memcpy(frame.data(), &header, sizeof(header));
+        std::memcpy(frame.data() + sizeof(header), data, size);
+        return overflow(frame.data(), frame_size);
+    }
+
+    std::memcpy(slot, &header, sizeof(header));
+    std::memcpy(slot + sizeof(header), data, size);
+    std::memset(slot + sizeof(header) + size, 0, frame_size - sizeof(header) - size);
+    publishSlot(buffer, slot, frame_size);
+    return true;
+}
+
+}  // namespace utils
@@ -0,0 +1,200 @@
+#include "log_struct_index.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace utils {
+
+namespace {
+bool writeAll(int fd, const void* data, std::size_t size) {
+    auto* bytes = static_cast<const std::byte*>(data);
+    while (size > 0) {
+        ssize_t result = ::write(fd, bytes, size);
+        if (result < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return false;
+        }
+        bytes += result;
+        size -= static_cast<std::size_t>(result);
+    }
+    return true;
+}
+
+LogStructIndexHeader makeIndexHeader(const LogStructFileHeader& header,
+                                     std::size_t timestamp_offset, std::size_t stride) {
+    LogStructIndexHeader index_header;
+    std::memset(&index_header, 0, sizeof(index_header));
+    std::memcpy(index_header.magic, kLogStructIndexMagic, sizeof(index_header.magic));
+    index_header.version          = kLogStructIndexVersion;
+    index_header.stride           = static_cast<std::uint32_t>(stride);
+    index_header.record_size      = header.record_size;
+    index_header.timestamp_offset = static_cast<std::uint32_t>(timestamp_offset);
+    index_header.clock_base_us    = header.clock_base_us;
+    index_header.steady_base_ns   = header.steady_base_ns;
+    return index_header;
+}
+}  // namespace
+
+LogStructIndexBuilder::LogStructIndexBuilder(std::size_t header_size, std::size_t record_size,
+                                             std::size_t timestamp_offset, std::size_t stride)
+    : record_size_(record_size),
+      timestamp_offset_(timestamp_offset),
+      stride_(std::max<std::size_t>(stride, 1)),
+      header_size_(header_size) {
+    resume(nullptr);
+}
+
+void LogStructIndexBuilder::resume(const LogStructIndexEntry* last) {
+    if (last) {
+        end_           = last->offset + record_size_;
+        max_timestamp_ = last->timestamp;
+    } else {
+        end_           = header_size_;
+        max_timestamp_ = std::numeric_limits<std::int64_t>::min();
+    }
+}
+
+void LogStructIndexBuilder::feed(const std::byte* data, std::size_t size, std::uint64_t offset,
+                                 std::vector<LogStructIndexEntry>& entries) {
+    std::size_t record = static_cast<std::size_t>(offset - header_size_) / record_size_;
+    std::size_t pos    = 0;
+    for (; pos + record_size_ <= size; pos += record_size_, ++record) {
+        std::int64_t timestamp;
+        std::memcpy(&timestamp, data + pos + timestamp_offset_, sizeof(timestamp));
+        max_timestamp_ = std::max(max_timestamp_, timestamp);
+        if (record % stride_ == 0)
+            entries.push_back({max_timestamp_, offset + pos});
+    }
+    end_ = offset + pos;
+}
+
+LogStructIndexWriter::LogStructIndexWriter(const std::string& path,
+                                           const LogStructFileHeader& header,
+                                           std::size_t timestamp_offset, std::size_t stride)
+    : record_size_(header.record_size),
+      builder_(header.header_size, header.record_size, timestamp_offset, stride) {
+    std::uint32_t loaded_stride = 0;
+    bool loaded = loadLogStructIndex(path, header, timestamp_offset, loaded_stride, loaded_);
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd_ == -1)
+        return;
+
+    if (loaded && loaded_stride == stride) {
+        // 沿用已有的 sidecar，去掉末尾不完整的索引项
+        ::ftruncate(fd_, static_cast<off_t>(sizeof(LogStructIndexHeader) +
+                                            loaded_.size() * sizeof(LogStructIndexEntry)));
+        ::lseek(fd_, 0, SEEK_END);
+        return;
+    }
+
+    // 没有 sidecar 或已失效：重建
+    loaded_.clear();
+    auto index_header = makeIndexHeader(header, timestamp_offset, stride);
+    if (::ftruncate(fd_, 0) != 0 || !writeAll(fd_, &index_header, sizeof(index_header))) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+LogStructIndexWriter::~LogStructIndexWriter() {
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+void LogStructIndexWriter::trim(std::uint64_t data_end) {
+    if (fd_ < 0)
+        return;
+
+    // 数据文件可能被截断过（如 mmap 后端异常退出后的恢复），丢弃指向截断部分的索引项
+    std::size_t keep = loaded_.size();
+    while (keep > 0 && loaded_[keep - 1].offset + record_size_ > data_end) --keep;
+    if (keep != loaded_.size()) {
+        ::ftruncate(fd_, static_cast<off_t>(sizeof(LogStructIndexHeader) +
+                                            keep * sizeof(LogStructIndexEntry)));
+        ::lseek(fd_, 0, SEEK_END);
+    }
+    builder_.resume(keep > 0 ? &loaded_[keep - 1] : nullptr);
+    loaded_.clear();
+    loaded_.shrink_to_fit();
+}
+
+void LogStructIndexWriter::catchUp(int data_fd, std::uint64_t data_end) {
+    trim(data_end);
+    if (fd_ < 0)
+        return;
+
+    // 按块读取尚未建立索引的记录
+    constexpr std::size_t  kChunkRecords = 16384;
+    std::vector<std::byte> chunk(kChunkRecords * record_size_);
+    while (builder_.end() + record_size_ <= data_end) {
+        std::size_t size = std::min<std::uint64_t>(chunk.size(), data_end - builder_.end());
+        size -= size % record_size_;
+        ssize_t result =
+            ::pread(data_fd, chunk.data(), size, static_cast<off_t>(builder_.end()));
+        if (result <= 0)
+            break;
+        auto read_size = static_cast<std::size_t>(result);
+        append(chunk.data(), read_size - read_size % record_size_, builder_.end());
+        if (read_size < record_size_)
+            break;
+    }
+}
+
+void LogStructIndexWriter::append(const std::byte* data, std::size_t size, std::uint64_t offset) {
+    if (fd_ < 0)
+        return;
+    builder_.feed(data, size, offset, pending_);
+    writeEntries();
+}
+
+void LogStructIndexWriter::writeEntries() {
+    if (pending_.empty())
+        return;
+    if (!writeAll(fd_, pending_.data(), pending_.size() * sizeof(LogStructIndexEntry))) {
+        // sidecar 写失败不影响数据文件，下次打开时从数据文件恢复
+        ::close(fd_);
+        fd_ = -1;
+    }
+    pending_.clear();
+}
+
+bool loadLogStructIndex(const std::string& path, const LogStructFileHeader& header,
+                        std::size_t timestamp_offset, std::uint32_t& stride,
+                        std::vector<LogStructIndexEntry>& entries) {
+    entries.clear();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat          st;
+    LogStructIndexHeader index_header;
+    bool                 ok = false;
+    if (::fstat(fd, &st) == 0 && ::pread(fd, &index_header, sizeof(index_header), 0) ==
+                                     static_cast<ssize_t>(sizeof(index_header))) {
+        auto expected = makeIndexHeader(header, timestamp_offset, index_header.stride);
+        ok            = index_header.stride > 0 &&
+             std::memcmp(&index_header, &expected, sizeof(expected)) == 0;
+    }
+    if (ok) {
+        std::size_t count = (static_cast<std::size_t>(st.st_size) - sizeof(index_header)) /
+                            sizeof(LogStructIndexEntry);
+        entries.resize(count);
+        std::size_t bytes = count * sizeof(LogStructIndexEntry);
+        ok = ::pread(fd, entries.data(), bytes, sizeof(index_header)) ==
+             static_cast<ssize_t>(bytes);
+        stride = index_header.stride;
+    }
+    ::close(fd);
+    if (!ok)
+        entries.clear();
+    return ok;
+}
+
+}  // namespace utils
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "log_struct_format.hpp"
+
+namespace utils {
+
+// 稀疏时间戳索引 sidecar（<log_path>.idx）：
+// [LogStructIndexHeader][LogStructIndexEntry ...]
+// 每隔 stride 条记录一个索引项，timestamp 为截至该记录（含）的最大时间戳，
+// 因此索引项的 timestamp 单调不减，多生产者写入导致时间戳局部乱序时二分查找仍然正确
+inline constexpr char          kLogStructIndexMagic[8] = {'L', 'O', 'G', 'S', 'I', 'D', 'X', '1'};
+inline constexpr std::uint32_t kLogStructIndexVersion  = 1;
+inline constexpr std::size_t   kLogStructIndexStride   = 4096;
+inline constexpr const char*   kLogStructIndexSuffix   = ".idx";
+
+struct LogStructIndexHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t stride;
+    std::uint32_t record_size;
+    std::uint32_t timestamp_offset;
+    // 与数据文件头中的时钟基准一致，用于识别数据文件被重建后残留的旧 sidecar
+    std::int64_t clock_base_us;
+    std::int64_t steady_base_ns;
+};
+static_assert(sizeof(LogStructIndexHeader) == 40);
+
+struct LogStructIndexEntry {
+    std::int64_t  timestamp;  // 截至该记录的最大时间戳
+    // 记录在数据文件中的偏移；编码文件中为解码后的偏移，即 header_size + 下标 * record_size
+    std::uint64_t offset;
+};
+static_assert(sizeof(LogStructIndexEntry) == 16);
+
+// 按文件顺序扫描完整记录，每 stride 条生成一个索引项。写线程和读者共用
+class LogStructIndexBuilder {
+   public:
+    LogStructIndexBuilder(std::size_t header_size, std::size_t record_size,
+                          std::size_t timestamp_offset, std::size_t stride);
+
+    // 从索引项 last 之后继续扫描，last 为空时从第一条记录开始
+    void resume(const LogStructIndexEntry* last);
+
+    // 处理从文件偏移 offset 开始的连续完整记录，offset 必须等于 end()
+    void feed(const std::byte* data, std::size_t size, std::uint64_t offset,
+              std::vector<LogStructIndexEntry>& entries);
+
+    std::uint64_t end() const { return end_; }
+
+   private:
+    std::size_t   record_size_;
+    std::size_t   timestamp_offset_;
+    std::size_t   stride_;
+    std::uint64_t header_size_;
+    std::uint64_t end_;
+    std::int64_t  max_timestamp_;
+};
+
+// 写线程维护的 sidecar。打开时校验已有 sidecar，不匹配则重建；
+// catchUp() 从数据文件补齐 sidecar 缺失的部分（sidecar 丢失或写入方异常退出）
+class LogStructIndexWriter {
+   public:
+    LogStructIndexWriter(const std::string& path, const LogStructFileHeader& header,
+                         std::size_t timestamp_offset, std::size_t stride);
+    ~LogStructIndexWriter();
+
+    LogStructIndexWriter(const LogStructIndexWriter&)            = delete;
+    LogStructIndexWriter& operator=(const LogStructIndexWriter&) = delete;
+
+    bool valid() const { return fd_ >= 0; }
+
+    // 丢弃超出 data_end 的索引项，之后从 end() 继续建立索引
+    void trim(std::uint64_t data_end);
+    // trim(data_end) 后用 pread 扫描未编码的数据文件 [end(), data_end) 补齐
+    void catchUp(int data_fd, std::uint64_t data_end);
+
+    // 追加写线程刚落盘的连续记录
+    void append(const std::byte* data, std::size_t size, std::uint64_t offset);
+
+    std::uint64_t end() const { return builder_.end(); }
+
+   private:
+    void writeEntries();
+
+    int                              fd_ = -1;
+    std::size_t                      record_size_;
+    LogStructIndexBuilder            builder_;
+    std::vector<LogStructIndexEntry> loaded_;  // 打开时已有的索引项，trim() 后释放
+    std::vector<LogStructIndexEntry> pending_;
+};
+
+// 读取并校验 sidecar，失败返回 false；成功时 entries 为已持久化的索引项
+bool loadLogStructIndex(const std::string& path, const LogStructFileHeader& header,
+                        std::size_t timestamp_offset, std::uint32_t& stride,
+                        std::vector<LogStructIndexEntry>& entries);
+
+}  // namespace utils
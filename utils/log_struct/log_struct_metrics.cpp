@@ -0,0 +1,82 @@
+#include "log_struct_metrics.hpp"
+
+#include <bit>
+
+namespace utils {
+
+LatencyHistogram::LatencyHistogram() : shards_(new Shard[kShards]) {}
+
+std::size_t LatencyHistogram::shardIndex() {
+    static std::atomic<std::size_t> next{0};
+    static thread_local std::size_t shard =
+        next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t value) {
+    if (value < kSubBuckets)
+        return static_cast<std::size_t>(value);
+    int exponent = std::bit_width(value) - 1;
+    int shift    = exponent - kSubBucketBits;
+    return static_cast<std::size_t>(shift + 1) * kSubBuckets +
+           static_cast<std::size_t>((value >> shift) & (kSubBuckets - 1));
+}
+
+std::uint64_t LatencyHistogram::lowerBound(std::size_t bucket) {
+    if (bucket < kSubBuckets)
+        return bucket;
+    int shift = static_cast<int>(bucket / kSubBuckets) - 1;
+    return (kSubBuckets + bucket % kSubBuckets) << shift;
+}
+
+std::uint64_t LatencyHistogram::upperBound(std::size_t bucket) {
+    if (bucket < kSubBuckets)
+        return bucket;
+    int shift = static_cast<int>(bucket / kSubBuckets) - 1;
+    return lowerBound(bucket) + ((std::uint64_t{1} << shift) - 1);
+}
+
+LatencySnapshot LatencyHistogram::snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.buckets.assign(kBucketCount, 0);
+    for (std::size_t shard = 0; shard < kShards; ++shard) {
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            std::uint64_t count = shards_[shard].counts[i].load(std::memory_order_relaxed);
+            snapshot.buckets[i] += count;
+            snapshot.count += count;
+        }
+    }
+    return snapshot;
+}
+
+std::uint64_t LatencySnapshot::percentile(double q) const {
+    if (count == 0)
+        return 0;
+    auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count));
+    rank      = rank == 0 ? 1 : (rank > count ? count : rank);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return LatencyHistogram::upperBound(i);
+    }
+    return max();
+}
+
+std::uint64_t LatencySnapshot::max() const {
+    for (std::size_t i = buckets.size(); i > 0; --i) {
+        if (buckets[i - 1] > 0)
+            return LatencyHistogram::upperBound(i - 1);
+    }
+    return 0;
+}
+
+double LogStructMetrics::bytesPerSecond(const LogStructMetrics& previous) const {
+    std::chrono::duration<double> elapsed = time - previous.time;
+    if (elapsed.count() <= 0)
+        return 0;
+    return static_cast<double>(written_bytes - previous.written_bytes) / elapsed.count();
+}
+
+}  // namespace utils
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace utils {
+
+// 延迟直方图的快照，单位纳秒
+struct LatencySnapshot {
+    std::vector<std::uint64_t> buckets;  // 各桶计数，未开启统计时为空
+    std::uint64_t              count = 0;
+
+    // 分位数 q（0~1）所在桶的上界，没有样本时返回 0
+    std::uint64_t percentile(double q) const;
+    // 最大样本所在桶的上界
+    std::uint64_t max() const;
+};
+
+// HDR 风格的对数线性直方图：每个 2 的幂区间再均分为 16 档，相对误差不超过 1/16。
+// 计数分片存放，不同线程大多落在不同的分片上，record() 只有一次 relaxed fetch_add
+class LatencyHistogram {
+   public:
+    static constexpr int         kSubBucketBits = 4;
+    static constexpr std::size_t kSubBuckets    = std::size_t{1} << kSubBucketBits;
+    static constexpr std::size_t kBucketCount   = (64 - kSubBucketBits + 1) * kSubBuckets;
+    static constexpr std::size_t kShards        = 4;
+
+    LatencyHistogram();
+
+    void record(std::uint64_t value) {
+        shards_[shardIndex()].counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 各分片的计数之和，与并发的 record() 之间没有一致性要求
+    LatencySnapshot snapshot() const;
+
+    static std::size_t bucketOf(std::uint64_t value);
+    // 桶内取值范围 [lowerBound, upperBound]
+    static std::uint64_t lowerBound(std::size_t bucket);
+    static std::uint64_t upperBound(std::size_t bucket);
+
+   private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> counts[kBucketCount] = {};
+    };
+
+    static std::size_t shardIndex();
+
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// 作用域计时：析构时把耗时记入 histogram，histogram 为空时不读时钟
+class ScopedLatency {
+   public:
+    explicit ScopedLatency(LatencyHistogram* histogram) : histogram_(histogram) {
+        if (histogram_) [[unlikely]]
+            start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedLatency() {
+        if (histogram_) [[unlikely]] {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            histogram_->record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+    ScopedLatency(const ScopedLatency&)            = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+   private:
+    LatencyHistogram*                     histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// LogStruct 的运行指标快照，健康检查可以随时轮询，不会阻塞生产者和写线程
+struct LogStructMetrics {
+    LatencySnapshot write_latency;  // write() 耗时
+    LatencySnapshot flush_latency;  // flush() 耗时
+    LatencySnapshot io_latency;     // 写线程每次落盘调用（::write、io_uring 一批、msync）的耗时
+
+    std::uint64_t written_bytes   = 0;  // 已写入文件的数据字节数（编码后，不含文件头）
+    std::uint64_t dropped_records = 0;
+    std::uint64_t failed_flushes  = 0;
+    std::uint64_t write_errors    = 0;
+
+    std::chrono::steady_clock::time_point time;  // 快照时刻
+
+    // 与更早的快照 previous 之间的写入速率（字节/秒）
+    double bytesPerSecond(const LogStructMetrics& previous) const;
+};
+
+}  // namespace utils
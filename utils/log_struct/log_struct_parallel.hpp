@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+// 在 threads 个线程（含调用线程）上按顺序领取 [0, count) 的任务，调用 task(index, worker)，
+// worker 小于 threads，可用于索引各线程私有的状态。
+// 任一任务抛出异常时其余线程尽快退出，异常在返回前重新抛出
+template <typename Task>
+void parallelFor(std::size_t count, std::size_t threads, Task task) {
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool>        failed{false};
+    std::exception_ptr       error;
+    std::mutex               error_mutex;
+    auto                     worker = [&](std::size_t id) {
+        std::size_t i;
+        while (!failed.load(std::memory_order_relaxed) &&
+               (i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+            try {
+                task(i, id);
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                failed.store(true);
+            }
+        }
+    };
+    {
+        std::vector<std::jthread> pool;
+        for (std::size_t id = 1; id < std::min(threads, count); ++id)
+            pool.emplace_back(worker, id);
+        worker(0);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+}  // namespace utils
@@ -0,0 +1,368 @@
+#include "log_struct_query.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "log_struct_parallel.hpp"
+#include "log_struct_reader.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace utils {
+
+namespace {
+
+struct Reduction {
+    double min;
+    double max;
+    double sum;
+};
+
+// count 至少为 1。4 路累加打破依赖链
+Reduction reduceScalar(const double* values, std::size_t count) {
+    double      min[4] = {values[0], values[0], values[0], values[0]};
+    double      max[4] = {values[0], values[0], values[0], values[0]};
+    double      sum[4] = {};
+    std::size_t i      = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (std::size_t lane = 0; lane < 4; ++lane) {
+            double value = values[i + lane];
+            min[lane]    = value < min[lane] ? value : min[lane];
+            max[lane]    = value > max[lane] ? value : max[lane];
+            sum[lane] += value;
+        }
+    }
+    for (; i < count; ++i) {
+        min[0] = values[i] < min[0] ? values[i] : min[0];
+        max[0] = values[i] > max[0] ? values[i] : max[0];
+        sum[0] += values[i];
+    }
+    return {std::min({min[0], min[1], min[2], min[3]}),
+            std::max({max[0], max[1], max[2], max[3]}), (sum[0] + sum[1]) + (sum[2] + sum[3])};
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx"))) Reduction reduceAvx(const double* values, std::size_t count) {
+    if (count < 8)
+        return reduceScalar(values, count);
+    // 两组寄存器交替累加，隐藏加法延迟
+    __m256d min0 = _mm256_loadu_pd(values);
+    __m256d max0 = min0;
+    __m256d sum0 = min0;
+    __m256d min1 = _mm256_loadu_pd(values + 4);
+    __m256d max1 = min1;
+    __m256d sum1 = min1;
+
+    std::size_t i = 8;
+    for (; i + 8 <= count; i += 8) {
+        __m256d v0 = _mm256_loadu_pd(values + i);
+        __m256d v1 = _mm256_loadu_pd(values + i + 4);
+        min0       = _mm256_min_pd(min0, v0);
+        max0       = _mm256_max_pd(max0, v0);
+        sum0       = _mm256_add_pd(sum0, v0);
+        min1       = _mm256_min_pd(min1, v1);
+        max1       = _mm256_max_pd(max1, v1);
+        sum1       = _mm256_add_pd(sum1, v1);
+    }
+
+    alignas(32) double min[4];
+    alignas(32) double max[4];
+    alignas(32) double sum[4];
+    _mm256_store_pd(min, _mm256_min_pd(min0, min1));
+    _mm256_store_pd(max, _mm256_max_pd(max0, max1));
+    _mm256_store_pd(sum, _mm256_add_pd(sum0, sum1));
+    Reduction result = {std::min({min[0], min[1], min[2], min[3]}),
+                        std::max({max[0], max[1], max[2], max[3]}),
+                        (sum[0] + sum[1]) + (sum[2] + sum[3])};
+    for (; i < count; ++i) {
+        result.min = std::min(result.min, values[i]);
+        result.max = std::max(result.max, values[i]);
+        result.sum += values[i];
+    }
+    return result;
+}
+#endif
+
+using Reduce = Reduction (*)(const double* values, std::size_t count);
+
+Reduce selectReduce() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx"))
+        return reduceAvx;
+#endif
+    return reduceScalar;
+}
+
+// 按字段类型调用 f(std::type_identity<V>{})，字段不是数值类型或大小与类型不符时返回 false
+template <typename V, typename F>
+bool visitAs(const LogStructField& field, F& f) {
+    if (field.size != sizeof(V))
+        return false;
+    f(std::type_identity<V>{});
+    return true;
+}
+
+template <typename F>
+bool visitNumeric(const LogStructField& field, F&& f) {
+    switch (field.type) {
+        case FieldType::kInt8:
+            return visitAs<std::int8_t>(field, f);
+        case FieldType::kUInt8:
+            return visitAs<std::uint8_t>(field, f);
+        case FieldType::kInt16:
+            return visitAs<std::int16_t>(field, f);
+        case FieldType::kUInt16:
+            return visitAs<std::uint16_t>(field, f);
+        case FieldType::kInt32:
+            return visitAs<std::int32_t>(field, f);
+        case FieldType::kUInt32:
+            return visitAs<std::uint32_t>(field, f);
+        case FieldType::kInt64:
+            return visitAs<std::int64_t>(field, f);
+        case FieldType::kUInt64:
+            return visitAs<std::uint64_t>(field, f);
+        case FieldType::kFloat:
+            return visitAs<float>(field, f);
+        case FieldType::kDouble:
+            return visitAs<double>(field, f);
+        case FieldType::kBytes:
+            return false;
+    }
+    return false;
+}
+
+// 按字段类型读取列的缓冲，std::get<std::vector<V>> 取用
+using TypedColumns =
+    std::tuple<std::vector<std::int8_t>, std::vector<std::uint8_t>, std::vector<std::int16_t>,
+               std::vector<std::uint16_t>, std::vector<std::int32_t>, std::vector<std::uint32_t>,
+               std::vector<std::int64_t>, std::vector<std::uint64_t>, std::vector<float>,
+               std::vector<double>>;
+
+// 每个工作线程复用的列缓冲
+struct Scratch {
+    TypedColumns                     typed;
+    std::vector<std::int64_t>        timestamps;
+    std::vector<std::vector<double>> values;  // 每个所选字段一列
+};
+
+// 一个桶的部分结果
+struct Partial {
+    std::size_t                      count = 0;
+    std::vector<Reduction>           stats;
+    std::vector<std::vector<double>> values;  // 需要分位数时保留的取值
+};
+
+using Partials = std::map<std::int64_t, Partial>;
+
+void merge(Partial& into, Partial& from) {
+    if (into.count == 0) {
+        into = std::move(from);
+        return;
+    }
+    into.count += from.count;
+    for (std::size_t f = 0; f < into.stats.size(); ++f) {
+        into.stats[f].min = std::min(into.stats[f].min, from.stats[f].min);
+        into.stats[f].max = std::max(into.stats[f].max, from.stats[f].max);
+        into.stats[f].sum += from.stats[f].sum;
+    }
+    for (std::size_t f = 0; f < into.values.size(); ++f) {
+        into.values[f].insert(into.values[f].end(), from.values[f].begin(),
+                              from.values[f].end());
+    }
+}
+
+}  // namespace
+
+LogStructQueryResult queryLogStruct(const LogStructReader&       reader,
+                                    const LogStructQueryOptions& options) {
+    static const Reduce reduce = selectReduce();
+    if (reader.framed())
+        throw std::invalid_argument("framed file");
+
+    const LogStructField* timestamp = nullptr;
+    if (reader.header().timestamp_field != kLogStructNoTimestamp &&
+        reader.fields()[reader.header().timestamp_field].size == sizeof(std::int64_t))
+        timestamp = &reader.fields()[reader.header().timestamp_field];
+    if (!timestamp && (options.from || options.to || options.bucket > 0))
+        throw std::invalid_argument("no timestamp field");
+
+    std::vector<const LogStructField*> fields;
+    if (options.fields.empty()) {
+        for (const auto& field : reader.fields()) {
+            if (&field != timestamp && visitNumeric(field, [](auto) {}))
+                fields.push_back(&field);
+        }
+    } else {
+        for (const auto& name : options.fields) {
+            const LogStructField* field = reader.findField(name);
+            if (!field)
+                throw std::invalid_argument("Unknown field: " + name);
+            if (!visitNumeric(*field, [](auto) {}))
+                throw std::invalid_argument("Not a numeric field: " + name);
+            fields.push_back(field);
+        }
+    }
+    for (double q : options.percentiles) {
+        if (!(q >= 0 && q <= 1))
+            throw std::invalid_argument("percentile out of range");
+    }
+
+    // 借助索引项（截至该记录的最大时间戳）确定需要扫描的记录区间，与 lowerBound / upperBound 一致；
+    // 只用索引项而不读取记录，编码文件不会因此整体解码
+    std::size_t first = 0;
+    std::size_t last  = reader.size();
+    if (options.from || options.to) {
+        const auto& entries  = reader.index();
+        auto        recordOf = [&](const LogStructIndexEntry& entry) {
+            return static_cast<std::size_t>(entry.offset - reader.header().header_size) /
+                   reader.recordSize();
+        };
+        if (options.from) {
+            auto it = std::partition_point(entries.begin(), entries.end(), [&](const auto& entry) {
+                return entry.timestamp < *options.from;
+            });
+            first   = it == entries.begin() ? 0 : recordOf(*std::prev(it)) + 1;
+        }
+        if (options.to) {
+            auto it = std::partition_point(entries.begin(), entries.end(), [&](const auto& entry) {
+                return entry.timestamp <= *options.to;
+            });
+            last    = it == entries.end() ? reader.size() : recordOf(*it) + 1;
+        }
+    }
+    std::vector<std::size_t> blocks;
+    for (std::size_t block = 0; block < reader.blockCount(); ++block) {
+        auto [begin, end] = reader.blockRange(block);
+        if (begin < last && end > first)
+            blocks.push_back(block);
+    }
+
+    std::int64_t from  = options.from.value_or(std::numeric_limits<std::int64_t>::min());
+    std::int64_t to    = options.to.value_or(std::numeric_limits<std::int64_t>::max());
+    std::int64_t width = options.bucket;
+    bool         keep  = !options.percentiles.empty();
+
+    std::size_t threads = options.threads > 0 ? options.threads
+                                              : std::max(1u, std::thread::hardware_concurrency());
+    threads             = std::max<std::size_t>(std::min(threads, blocks.size()), 1);
+    std::vector<Scratch>  scratches(threads);
+    std::vector<Partials> partials(threads);
+
+    parallelFor(blocks.size(), threads, [&](std::size_t task, std::size_t worker) {
+        Scratch&  scratch = scratches[worker];
+        Partials& buckets = partials[worker];
+
+        std::size_t block = blocks[task];
+        auto [block_first, block_last] = reader.blockRange(block);
+        // 块内下标，只扫描与 [first, last) 相交的部分
+        std::size_t begin = std::max(block_first, first) - block_first;
+        std::size_t end   = std::min(block_last, last) - block_first;
+
+        if (timestamp)
+            reader.column(block, *timestamp, scratch.timestamps);
+        scratch.values.resize(fields.size());
+        for (std::size_t f = 0; f < fields.size(); ++f) {
+            auto& values = scratch.values[f];
+            visitNumeric(*fields[f], [&]<typename V>(std::type_identity<V>) {
+                auto& typed = std::get<std::vector<V>>(scratch.typed);
+                reader.column(block, *fields[f], typed);
+                values.resize(typed.size());
+                std::transform(typed.begin(), typed.end(), values.begin(),
+                               [](V value) { return static_cast<double>(value); });
+            });
+        }
+
+        // 连续落在同一个桶内的记录为一段，整段做一次归约
+        auto inRange = [&](std::size_t i) {
+            return !timestamp || (scratch.timestamps[i] >= from && scratch.timestamps[i] <= to);
+        };
+        for (std::size_t i = begin; i < end;) {
+            if (!inRange(i)) {
+                ++i;
+                continue;
+            }
+            std::int64_t start = 0;
+            std::size_t  j     = i + 1;
+            if (width > 0) {
+                std::int64_t ts     = scratch.timestamps[i];
+                std::int64_t offset = ts % width;
+                start               = ts - (offset < 0 ? offset + width : offset);
+                while (j < end && inRange(j) && scratch.timestamps[j] >= start &&
+                       scratch.timestamps[j] - start < width)
+                    ++j;
+            } else {
+                while (j < end && inRange(j)) ++j;
+            }
+
+            Partial& partial = buckets[start];
+            if (partial.count == 0) {
+                partial.stats.assign(fields.size(), {});
+                partial.values.resize(keep ? fields.size() : 0);
+            }
+            for (std::size_t f = 0; f < fields.size(); ++f) {
+                const double* values = scratch.values[f].data() + i;
+                Reduction     run    = reduce(values, j - i);
+                Reduction&    stats  = partial.stats[f];
+                if (partial.count == 0) {
+                    stats = run;
+                } else {
+                    stats.min = std::min(stats.min, run.min);
+                    stats.max = std::max(stats.max, run.max);
+                    stats.sum += run.sum;
+                }
+                if (keep)
+                    partial.values[f].insert(partial.values[f].end(), values, values + (j - i));
+            }
+            partial.count += j - i;
+            i = j;
+        }
+    });
+
+    for (std::size_t worker = 1; worker < threads; ++worker) {
+        for (auto& [start, partial] : partials[worker]) merge(partials[0][start], partial);
+    }
+
+    LogStructQueryResult result;
+    for (const auto* field : fields) result.fields.push_back(field->name);
+    std::vector<Partial*> merged;
+    for (auto& [start, partial] : partials[0]) {
+        LogStructQueryBucket bucket;
+        bucket.start = start;
+        bucket.count = partial.count;
+        for (const auto& stats : partial.stats) {
+            auto& field = bucket.fields.emplace_back();
+            field.min   = stats.min;
+            field.max   = stats.max;
+            field.sum   = stats.sum;
+            field.mean  = stats.sum / static_cast<double>(partial.count);
+        }
+        result.buckets.push_back(std::move(bucket));
+        merged.push_back(&partial);
+    }
+
+    // 分位数：每个桶的每个字段一个任务，nth_element 取最近秩（与 LatencySnapshot 相同）
+    if (keep) {
+        parallelFor(merged.size() * fields.size(), threads, [&](std::size_t task, std::size_t) {
+            std::size_t b      = task / fields.size();
+            std::size_t f      = task % fields.size();
+            auto&       values = merged[b]->values[f];
+            for (double q : options.percentiles) {
+                auto rank = static_cast<std::size_t>(q * static_cast<double>(values.size()));
+                rank      = std::clamp<std::size_t>(rank, 1, values.size());
+                std::nth_element(values.begin(), values.begin() + (rank - 1), values.end());
+                result.buckets[b].fields[f].percentiles.push_back(values[rank - 1]);
+            }
+            std::vector<double>().swap(values);
+        });
+    }
+    return result;
+}
+
+}  // namespace utils
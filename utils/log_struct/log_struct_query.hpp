@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+class LogStructReader;
+
+struct LogStructQueryOptions {
+    // 参与统计的数值字段，按给定顺序；为空时为时间戳之外的全部数值字段
+    std::vector<std::string> fields;
+
+    // 时间范围 [from, to]（时间戳字段的取值）
+    std::optional<std::int64_t> from;
+    std::optional<std::int64_t> to;
+
+    // 时间桶宽度，单位与时间戳字段相同，桶的起点为宽度的整数倍；0 表示整个范围为一个桶
+    std::int64_t bucket = 0;
+
+    // 需要的分位数（0~1），为空时不保留取值
+    std::vector<double> percentiles;
+
+    std::size_t threads = 0;  // 0 表示 std::thread::hardware_concurrency()
+};
+
+struct LogStructFieldStats {
+    double min  = 0;
+    double max  = 0;
+    double sum  = 0;
+    double mean = 0;
+
+    std::vector<double> percentiles;  // 与 LogStructQueryOptions::percentiles 一一对应
+};
+
+struct LogStructQueryBucket {
+    std::int64_t                     start = 0;  // 桶起点，bucket 为 0 时为 0
+    std::size_t                      count = 0;  // 桶内记录数
+    std::vector<LogStructFieldStats> fields;     // 与 LogStructQueryResult::fields 一一对应
+};
+
+struct LogStructQueryResult {
+    std::vector<std::string>          fields;
+    std::vector<LogStructQueryBucket> buckets;  // 按 start 升序，只含非空的桶
+};
+
+// 按时间桶统计各字段的 min / max / sum / mean 和分位数，统计值按 double 计算。
+// 按块并行扫描：每块只读取时间戳列和所选字段的列（编码文件只解码这些列），
+// 有时间范围时借助时间戳索引只扫描覆盖该范围的块。
+// 时间范围的边界与 LogStructReader::timeRange() 一致，范围内的记录不要求按时间戳有序。
+// 分位数为精确值，需要在内存中保留范围内所选字段的全部取值。
+// 字段名非法、字段不是数值类型、文件为帧模式或文件没有时间戳字段却按时间查询时
+// 抛出 std::invalid_argument
+LogStructQueryResult queryLogStruct(const LogStructReader&       reader,
+                                    const LogStructQueryOptions& options = {});
+
+}  // namespace utils
@@ -0,0 +1,63 @@
+#include <CLI/CLI.hpp>
+#include <chrono>
+#include <iostream>
+
+#include "log_struct_query.hpp"
+#include "log_struct_reader.hpp"
+
+// 用法：log_struct_query trace.log -f price,volume --bucket 1000000000 -p 0.5,0.99 > stats.csv
+// 输出 CSV：start,count，之后每个字段依次为 min,max,mean 和各分位数
+int main(int argc, char** argv) {
+    CLI::App app{"Aggregate LogStruct fields per time bucket"};
+
+    std::string                  input;
+    utils::LogStructQueryOptions options;
+    std::int64_t                 from = 0;
+    std::int64_t                 to   = 0;
+
+    app.add_option("input", input, "LogStruct file")->required()->check(CLI::ExistingFile);
+    app.add_option("-f,--fields", options.fields, "Numeric fields, all by default")
+        ->delimiter(',');
+    auto* from_option = app.add_option("--from", from, "Lower bound of the timestamp field");
+    auto* to_option   = app.add_option("--to", to, "Upper bound of the timestamp field");
+    app.add_option("-b,--bucket", options.bucket,
+                   "Bucket width in timestamp units, 0 for a single bucket");
+    app.add_option("-p,--percentiles", options.percentiles, "Percentiles in [0, 1]")
+        ->delimiter(',');
+    app.add_option("-j,--threads", options.threads, "Worker threads, 0 for all cores");
+    CLI11_PARSE(app, argc, argv);
+
+    if (*from_option)
+        options.from = from;
+    if (*to_option)
+        options.to = to;
+
+    try {
+        auto                   start  = std::chrono::steady_clock::now();
+        utils::LogStructReader reader(input);
+        auto                   result = utils::queryLogStruct(reader, options);
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "start,count";
+        for (const auto& field : result.fields) {
+            std::cout << ',' << field << ".min," << field << ".max," << field << ".mean";
+            for (double q : options.percentiles) std::cout << ',' << field << ".p" << q * 100;
+        }
+        std::cout << '\n';
+        for (const auto& bucket : result.buckets) {
+            std::cout << bucket.start << ',' << bucket.count;
+            for (const auto& stats : bucket.fields) {
+                std::cout << ',' << stats.min << ',' << stats.max << ',' << stats.mean;
+                for (double value : stats.percentiles) std::cout << ',' << value;
+            }
+            std::cout << '\n';
+        }
+        std::cerr << result.buckets.size() << " buckets in " << elapsed.count() << " s"
+                  << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
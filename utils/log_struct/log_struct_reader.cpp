@@ -0,0 +1,268 @@
+#include "log_struct_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "log_struct_codec.hpp"
+
+namespace utils {
+
+LogStructReader::LogStructReader(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ == -1)
+        throw std::runtime_error("Open failed: " + path);
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(header_)) {
+        ::close(fd_);
+        throw std::runtime_error("Not a LogStruct file: " + path);
+    }
+    map_size_ = static_cast<std::size_t>(st.st_size);
+
+    map_ = ::mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("Mmap failed: " + path);
+    }
+    // 顺序扫描为主，提示内核加大预读
+    ::madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+    auto* base = static_cast<const std::byte*>(map_);
+    std::memcpy(&header_, base, sizeof(header_));
+    if (auto error = validateLogStructHeader(header_, map_size_); !error.empty()) {
+        ::munmap(map_, map_size_);
+        ::close(fd_);
+        throw std::runtime_error("Invalid LogStruct header (" + error + "): " + path);
+    }
+
+    auto* descs = reinterpret_cast<const LogStructFieldDesc*>(base + sizeof(header_));
+    fields_.reserve(header_.field_count);
+    for (std::uint32_t i = 0; i < header_.field_count; ++i) {
+        LogStructFieldDesc desc;
+        std::memcpy(&desc, &descs[i], sizeof(desc));
+        fields_.push_back({std::string(desc.name, strnlen(desc.name, sizeof(desc.name))),
+                           static_cast<FieldType>(desc.type), desc.offset, desc.size,
+                           desc.schema});
+    }
+
+    // 写入方预分配了文件末尾时以 data_size 为准，避免读到全零的预分配区域
+    std::size_t data_size = map_size_ - header_.header_size;
+    if (header_.flags & kLogStructFlagPreallocated)
+        data_size = std::min<std::size_t>(data_size, header_.data_size);
+    if (header_.flags & kLogStructFlagBlocks) {
+        scanBlocks(base + header_.header_size, base + header_.header_size + data_size);
+    } else if (header_.flags & kLogStructFlagFramed) {
+        scanFrames(base + header_.header_size, base + header_.header_size + data_size);
+        decoded_.store(true, std::memory_order_relaxed);
+    } else {
+        data_  = base + header_.header_size;
+        count_ = data_size / header_.record_size;
+        decoded_.store(true, std::memory_order_relaxed);
+    }
+
+    if (header_.timestamp_field != kLogStructNoTimestamp &&
+        fields_[header_.timestamp_field].size == sizeof(std::int64_t)) {
+        timestamp_field_ = &fields_[header_.timestamp_field];
+    }
+    path_ = path;
+}
+
+LogStructReader::~LogStructReader() {
+    ::munmap(map_, map_size_);
+    ::close(fd_);
+}
+
+void LogStructReader::scanBlocks(const std::byte* begin, const std::byte* end) {
+    for (const std::byte* pos = begin; pos + sizeof(LogStructBlockHeader) <= end;) {
+        LogStructBlockHeader header;
+        std::memcpy(&header, pos, sizeof(header));
+        if (!validLogStructBlock(header, static_cast<std::uint64_t>(pos - begin),
+                                 static_cast<std::uint64_t>(end - begin)) ||
+            header.sequence != count_)
+            break;
+        blocks_.push_back({header, pos + sizeof(header), count_});
+        count_ += header.record_count;
+        pos += sizeof(header) + header.payload_size;
+    }
+    // 写入方中途退出且尚未恢复时，最后一块可能只写了一部分
+    if (!blocks_.empty() && !checkLogStructBlock(blocks_.back().header, blocks_.back().payload)) {
+        count_ -= blocks_.back().header.record_count;
+        blocks_.pop_back();
+    }
+    columns_ = planLogStructColumns(recordSize(), fields_, header_.timestamp_field);
+}
+
+void LogStructReader::scanFrames(const std::byte* begin, const std::byte* end) {
+    data_ = begin;
+    for (const std::byte* pos = begin; pos + sizeof(LogStructFrameHeader) <= end;) {
+        LogStructFrameHeader header;
+        std::memcpy(&header, pos, sizeof(header));
+        std::size_t frame_size = logStructFrameSize(header.size);
+        if (frame_size > static_cast<std::size_t>(end - pos))
+            break;
+        if (header.type != kLogStructPaddingFrame)
+            frames_.push_back({header.type, header.size, pos + sizeof(header)});
+        pos += frame_size;
+    }
+    count_ = frames_.size();
+}
+
+void LogStructReader::decodeBlocks() const {
+    std::call_once(decode_once_, [this] {
+        auto buffer = std::make_unique_for_overwrite<std::byte[]>(count_ * recordSize());
+
+        // 块之间相互独立，按块并行解码
+        std::atomic<std::size_t> next{0};
+        std::atomic<bool>        failed{false};
+        auto                     worker = [&] {
+            std::size_t i;
+            while ((i = next.fetch_add(1, std::memory_order_relaxed)) < blocks_.size()) {
+                const auto& block = blocks_[i];
+                if (!checkLogStructBlock(block.header, block.payload) ||
+                    !decodeLogStructBlock(columns_, recordSize(), block.header, block.payload,
+                                          buffer.get() + block.first * recordSize()))
+                    failed.store(true, std::memory_order_relaxed);
+            }
+        };
+        std::size_t threads = std::min<std::size_t>(
+            std::max(1u, std::thread::hardware_concurrency()), blocks_.size());
+        {
+            std::vector<std::jthread> pool;
+            for (std::size_t i = 1; i < threads; ++i) pool.emplace_back(worker);
+            worker();
+        }
+        if (failed.load())
+            throw std::runtime_error("Corrupt block: " + path_);
+
+        decode_buffer_ = std::move(buffer);
+        data_          = decode_buffer_.get();
+        decoded_.store(true, std::memory_order_release);
+    });
+}
+
+std::size_t LogStructReader::blockCount() const {
+    if (header_.flags & kLogStructFlagBlocks)
+        return blocks_.size();
+    if (framed())
+        return 0;
+    return (count_ + kRawBlockRecords - 1) / kRawBlockRecords;
+}
+
+std::pair<std::size_t, std::size_t> LogStructReader::blockRange(std::size_t block) const {
+    if (header_.flags & kLogStructFlagBlocks)
+        return {blocks_[block].first, blocks_[block].first + blocks_[block].header.record_count};
+    std::size_t first = block * kRawBlockRecords;
+    return {first, std::min(first + kRawBlockRecords, count_)};
+}
+
+void LogStructReader::readColumn(std::size_t block, const LogStructField& field,
+                                 std::byte* values) const {
+    auto [first, last] = blockRange(block);
+    auto gather        = [&](const std::byte* records) {
+        for (std::size_t i = 0; i < last - first; ++i) {
+            std::memcpy(values + i * field.size, records + i * recordSize() + field.offset,
+                        field.size);
+        }
+    };
+    if (!(header_.flags & kLogStructFlagBlocks)) {
+        gather(data_ + first * recordSize());
+        return;
+    }
+
+    const auto& info = blocks_[block];
+    auto        it   = std::find_if(columns_.begin(), columns_.end(), [&](const auto& column) {
+        return column.field >= 0 && column.offset == field.offset && column.size == field.size;
+    });
+    if (it != columns_.end()) {
+        if (!decodeLogStructColumn(columns_, static_cast<std::size_t>(it - columns_.begin()),
+                                   info.header, info.payload, values))
+            throw std::runtime_error("Corrupt block: " + path_);
+        return;
+    }
+
+    // 字段不是独立的一列（如字段描述重叠时整条记录作为一列）：解码整块后取出
+    std::vector<std::byte> records(info.header.record_count * recordSize());
+    if (!decodeLogStructBlock(columns_, recordSize(), info.header, info.payload, records.data()))
+        throw std::runtime_error("Corrupt block: " + path_);
+    gather(records.data());
+}
+
+std::string_view LogStructReader::buildId() const {
+    return {header_.build_id, strnlen(header_.build_id, sizeof(header_.build_id))};
+}
+
+std::int64_t LogStructReader::timestampAt(std::size_t index) const {
+    std::int64_t value;
+    std::memcpy(&value, record(index) + timestamp_field_->offset, sizeof(value));
+    return value;
+}
+
+std::size_t LogStructReader::recordOf(const LogStructIndexEntry& entry) const {
+    return static_cast<std::size_t>(entry.offset - header_.header_size) / recordSize();
+}
+
+void LogStructReader::loadIndex() const {
+    std::call_once(index_once_, [this] {
+        std::uint32_t stride = kLogStructIndexStride;
+        loadLogStructIndex(path_ + kLogStructIndexSuffix, header_, timestamp_field_->offset,
+                           stride, index_);
+
+        // 丢弃指向文件末尾之外的索引项，再从最后一个索引项之后补齐
+        while (!index_.empty() && recordOf(index_.back()) >= count_) index_.pop_back();
+        LogStructIndexBuilder builder(header_.header_size, recordSize(), timestamp_field_->offset,
+                                      stride);
+        builder.resume(index_.empty() ? nullptr : &index_.back());
+        // sidecar 已覆盖全部记录时不访问记录，编码文件不会因此整体解码
+        std::uint64_t end = header_.header_size + count_ * recordSize();
+        if (end > builder.end())
+            builder.feed(recordData() + (builder.end() - header_.header_size),
+                         end - builder.end(), builder.end(), index_);
+    });
+}
+
+const std::vector<LogStructIndexEntry>& LogStructReader::index() const {
+    if (!timestamp_field_)
+        throw std::logic_error("no timestamp field");
+    loadIndex();
+    return index_;
+}
+
+template <typename Before>
+std::size_t LogStructReader::search(Before before) const {
+    const auto& entries = index();
+
+    // 第一个前缀最大值不满足 before 的索引项 e：e 之前一个索引项及更早的记录都满足 before，
+    // 目标记录位于 (prev(e), e] 之间
+    auto it = std::partition_point(entries.begin(), entries.end(), [&](const auto& entry) {
+        return before(entry.timestamp);
+    });
+    std::size_t from  = it == entries.begin() ? 0 : recordOf(*std::prev(it)) + 1;
+    std::size_t limit = it == entries.end() ? count_ : recordOf(*it) + 1;
+    for (std::size_t i = from; i < limit; ++i) {
+        if (!before(timestampAt(i)))
+            return i;
+    }
+    return count_;
+}
+
+std::size_t LogStructReader::lowerBound(std::int64_t value) const {
+    return search([value](std::int64_t timestamp) { return timestamp < value; });
+}
+
+std::size_t LogStructReader::upperBound(std::int64_t value) const {
+    return search([value](std::int64_t timestamp) { return timestamp <= value; });
+}
+
+const LogStructField* LogStructReader::findField(std::string_view name) const {
+    auto it = std::find_if(fields_.begin(), fields_.end(),
+                           [&](const LogStructField& field) { return field.name == name; });
+    return it == fields_.end() ? nullptr : &*it;
+}
+
+}  // namespace utils
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "log_struct_codec.hpp"
+#include "log_struct_format.hpp"
+#include "log_struct_index.hpp"
+
+namespace utils {
+
+// 帧模式文件中的一条记录
+struct LogStructFrame {
+    std::uint32_t    type;
+    std::uint32_t    size;  // 负载字节数
+    const std::byte* data;  // 负载，按 kLogStructFrameAlign 对齐
+
+    // 负载按 T 解释，sizeof(T) 必须等于负载大小
+    template <typename T>
+    const T& as() const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (sizeof(T) != size)
+            throw std::invalid_argument("frame size mismatch");
+        return *reinterpret_cast<const T*>(data);
+    }
+};
+
+// LogStruct 文件的只读视图：mmap 整个文件并校验文件头，按下标 O(1) 访问记录。
+// 编码文件在首次按记录访问时并行解码到内存中，之后的访问方式与未编码文件相同；
+// 只读取少数字段时用 column() 按块读取单列，不需要解码整条记录。
+// 打开失败或文件头非法时抛出 std::runtime_error，编码文件的块解码失败时同样抛出
+class LogStructReader {
+   public:
+    // 未编码文件按此条数划分为虚拟块
+    static constexpr std::size_t kRawBlockRecords = 65536;
+
+    explicit LogStructReader(const std::string& path);
+    ~LogStructReader();
+
+    LogStructReader(const LogStructReader&)            = delete;
+    LogStructReader& operator=(const LogStructReader&) = delete;
+
+    const LogStructFileHeader&         header() const { return header_; }
+    const std::vector<LogStructField>& fields() const { return fields_; }
+    std::string_view                   buildId() const;
+
+    // 按名称查找字段，不存在时返回 nullptr
+    const LogStructField* findField(std::string_view name) const;
+
+    std::size_t recordSize() const { return header_.record_size; }
+    // 完整记录的数量，末尾不完整的记录被忽略。编码文件忽略第一个块头非法或序号不连续的块
+    // 及之后的块，以及 CRC 不一致的最后一块；其余块的 CRC 在整体解码时校验，
+    // 不一致时抛出 std::runtime_error。
+    // 帧模式文件为不含填充帧的帧数
+    std::size_t size() const { return count_; }
+    bool        empty() const { return count_ == 0; }
+
+    const std::byte* record(std::size_t index) const {
+        return recordData() + index * recordSize();
+    }
+
+    // 读取第 index 条记录的一个字段，V 的大小必须与字段一致
+    template <typename V>
+    V field(std::size_t index, const LogStructField& field) const {
+        static_assert(std::is_trivially_copyable_v<V>);
+        if (sizeof(V) != field.size)
+            throw std::invalid_argument("field size mismatch: " + field.name);
+        V value;
+        std::memcpy(&value, record(index) + field.offset, sizeof(V));
+        return value;
+    }
+
+    // 类型化视图，可用于范围 for 和随机访问；sizeof(T) 必须等于记录大小
+    template <typename T>
+    std::span<const T> records() const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (sizeof(T) != recordSize() || framed())
+            throw std::invalid_argument("record size mismatch");
+        // 记录从按页对齐的 header_size（编码文件为 new 分配的解码缓冲区）开始，
+        // 步长为 sizeof(T)，满足 T 的对齐要求
+        return {reinterpret_cast<const T*>(recordData()), count_};
+    }
+
+    // 帧模式（LogStructFramed 写入）的文件按记录顺序列出全部帧，跳过填充帧；
+    // record()、records<T>() 和按块、按时间戳的读取不适用于帧模式文件
+    bool framed() const { return header_.flags & kLogStructFlagFramed; }
+    const std::vector<LogStructFrame>& frames() const { return frames_; }
+
+    // 按块读取：编码文件的块即写入时的块，未编码文件每 kRawBlockRecords 条记录一块。
+    // 帧模式文件没有块
+    std::size_t blockCount() const;
+    // 块内记录的下标范围 [first, last)
+    std::pair<std::size_t, std::size_t> blockRange(std::size_t block) const;
+
+    // 读取一个块中某个字段的全部取值，按记录顺序存放，V 的大小必须与字段一致。
+    // kColumnar 块只触及该列的字节，kDelta 块只解码该列，都不校验 CRC
+    template <typename V>
+    void column(std::size_t block, const LogStructField& field, std::vector<V>& values) const {
+        static_assert(std::is_trivially_copyable_v<V>);
+        if (sizeof(V) != field.size)
+            throw std::invalid_argument("field size mismatch: " + field.name);
+        auto [first, last] = blockRange(block);
+        values.resize(last - first);
+        readColumn(block, field, reinterpret_cast<std::byte*>(values.data()));
+    }
+
+    // 按时间戳查找记录，需要文件头中有 8 字节的时间戳字段，否则抛出 std::logic_error。
+    // 首次调用时加载 <path>.idx，sidecar 缺失或落后于数据文件时在内存中补齐，
+    // 之后二分查找索引项，最多再顺序扫描 stride 条记录
+
+    // 第一条 timestamp >= value 的记录下标，没有时返回 size()
+    std::size_t lowerBound(std::int64_t value) const;
+    // 第一条 timestamp > value 的记录下标，没有时返回 size()
+    std::size_t upperBound(std::int64_t value) const;
+    // [lowerBound(from), upperBound(to))
+    std::pair<std::size_t, std::size_t> timeRange(std::int64_t from, std::int64_t to) const {
+        return {lowerBound(from), upperBound(to)};
+    }
+
+    const std::vector<LogStructIndexEntry>& index() const;
+
+   private:
+    struct Block {
+        LogStructBlockHeader header;
+        const std::byte*     payload;
+        std::size_t          first;  // 块内第一条记录的下标
+    };
+
+    // 记录区起点，编码文件首次调用时解码全部块
+    const std::byte* recordData() const {
+        if (!decoded_.load(std::memory_order_acquire)) [[unlikely]]
+            decodeBlocks();
+        return data_;
+    }
+    void readColumn(std::size_t block, const LogStructField& field, std::byte* values) const;
+
+    std::int64_t timestampAt(std::size_t index) const;
+    std::size_t  recordOf(const LogStructIndexEntry& entry) const;
+    // 扫描 [begin, end) 内的连续块，记录块表
+    void scanBlocks(const std::byte* begin, const std::byte* end);
+    // 扫描 [begin, end) 内的完整帧
+    void scanFrames(const std::byte* begin, const std::byte* end);
+    void decodeBlocks() const;
+    void loadIndex() const;
+    // 第一条满足 !before(timestamp) 的记录下标，before 关于前缀最大值单调
+    template <typename Before>
+    std::size_t search(Before before) const;
+
+    std::string                 path_;
+    int                         fd_       = -1;
+    void*                       map_      = nullptr;
+    std::size_t                 map_size_ = 0;
+    std::size_t                 count_    = 0;
+    LogStructFileHeader         header_   = {};
+    std::vector<LogStructField> fields_;
+
+    // 编码文件的块表和列划分；解码结果保存在 decode_buffer_ 中，data_ 在解码后才有效
+    std::vector<Block>                   blocks_;
+    std::vector<LogStructColumn>         columns_;
+    mutable const std::byte*             data_ = nullptr;
+    mutable std::unique_ptr<std::byte[]> decode_buffer_;
+    mutable std::once_flag               decode_once_;
+    mutable std::atomic<bool>            decoded_{false};
+
+    std::vector<LogStructFrame> frames_;
+
+    const LogStructField*                    timestamp_field_ = nullptr;
+    mutable std::once_flag                   index_once_;
+    mutable std::vector<LogStructIndexEntry> index_;
+};
+
+}  // namespace utils
@@ -0,0 +1,227 @@
+#include "log_struct.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+namespace utils {
+
+void LogStruct::openSegments() {
+    if (!rotating_) {
+        segment_path_ = log_path_;
+        return;
+    }
+    auto segments = listLogStructSegments(log_path_);
+    segment_seq_  = segments.empty() ? 1 : segments.back().seq;
+    segment_path_ = logStructSegmentPath(log_path_, segment_seq_);
+}
+
+std::size_t LogStruct::segmentBatch(std::size_t tail, std::size_t head) {
+    if (!rotating_)
+        return head;
+
+    auto sealed = [this](std::size_t seq) {
+        return buffers_[seq % buffer_count_].sealed_size.load(std::memory_order_acquire);
+    };
+
+    // 当前段已有数据且写入下一块后会超出大小、或已到期时切换；切换失败时继续写当前段。
+    // 空缓冲区（析构时的最后一次切换）不触发切换，避免留下只有文件头的段。
+    // used 为段中已写出的文件字节数；待写的块在编码前长度未知，按编码前的长度估计
+    std::size_t used    = static_cast<std::size_t>(file_offset_) - header_size_;
+    bool        full    = rotate_bytes_ > 0 && used + sealed(tail) > rotate_bytes_;
+    bool        expired = rotate_interval_.count() > 0 &&
+                   std::chrono::system_clock::now() >= segment_deadline_;
+    if (used > 0 && sealed(tail) > 0 && (full || expired) && rotateSegment())
+        used = 0;
+
+    // 本批只包含当前段能容纳的缓冲区，至少一块
+    std::size_t end = tail;
+    do {
+        used += sealed(end++);
+    } while (end != head && (rotate_bytes_ == 0 || used + sealed(end) <= rotate_bytes_));
+    return end;
+}
+
+bool LogStruct::rotateSegment() {
+    {
+        std::lock_guard lock(segment_mutex_);
+        if (!next_segment_) {
+            // 后台线程还没准备好下一段，不在写线程中同步创建
+            delayed_rotations_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    // 之后的 fdatasync 只覆盖新段，切换前先同步当前段中已写出的记录。
+    // 同步期间不持有 segment_mutex_，不阻塞后台线程；准备好的下一段只有写线程会取走
+    syncFile(true);
+
+    {
+        std::lock_guard lock(segment_mutex_);
+        auto next = std::move(next_segment_);
+
+        // 当前段交给后台线程 fsync 并关闭
+        retired_segments_.push_back({fd_, segment_seq_, std::move(index_)});
+        fd_           = next->fd;
+        index_        = std::move(next->index);
+        segment_seq_  = next->seq;
+        segment_path_ = logStructSegmentPath(log_path_, segment_seq_);
+    }
+    segment_cv_.notify_one();
+
+    file_offset_            = static_cast<off_t>(header_size_);
+    logical_offset_         = header_size_;
+    last_block_             = 0;
+    file_header_.checkpoint = 0;
+    writeback_begin_        = file_offset_;
+    writeback_done_         = file_offset_;
+    segment_deadline_       = std::chrono::system_clock::now() + rotate_interval_;
+    rotated_segments_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::unique_ptr<LogStruct::Segment> LogStruct::createSegment(std::uint64_t seq) {
+    std::string path = logStructSegmentPath(log_path_, seq);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1)
+        return nullptr;
+
+    auto        header  = buildLogStructHeader(struct_size_, fields_, headerFlags());
+    std::size_t written = 0;
+    while (written < header.size()) {
+        ssize_t result = ::pwrite(fd, header.data() + written, header.size() - written,
+                                  static_cast<off_t>(written));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0) {
+            ::close(fd);
+            ::unlink(path.c_str());
+            return nullptr;
+        }
+        written += static_cast<std::size_t>(result);
+    }
+
+    // 预分配磁盘空间但保持文件大小不变：读者只看到已写入的数据。
+    // 文件系统不支持时忽略
+    if (rotate_bytes_ > 0)
+        ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(header_size_ + rotate_bytes_));
+
+    auto segment = std::make_unique<Segment>();
+    segment->fd  = fd;
+    segment->seq = seq;
+
+    LogStructFileHeader file_header;
+    std::memcpy(&file_header, header.data(), sizeof(file_header));
+    if (index_stride_ > 0 && file_header.timestamp_field != kLogStructNoTimestamp &&
+        fields_[file_header.timestamp_field].size == sizeof(std::int64_t)) {
+        auto index = std::make_unique<LogStructIndexWriter>(
+            path + kLogStructIndexSuffix, file_header, fields_[file_header.timestamp_field].offset,
+            index_stride_);
+        if (index->valid())
+            segment->index = std::move(index);
+    }
+    return segment;
+}
+
+void LogStruct::closeSegment(Segment& segment) {
+    ::fsync(segment.fd);
+    ::close(segment.fd);
+    segment.index.reset();
+}
+
+void LogStruct::applyRetention() {
+    if (retention_count_ == 0 && retention_bytes_ == 0)
+        return;
+
+    std::uint64_t current;
+    {
+        std::lock_guard lock(segment_mutex_);
+        current = segment_seq_;
+    }
+
+    // 预先创建的下一段不计入
+    auto segments = listLogStructSegments(log_path_);
+    std::erase_if(segments, [&](const auto& segment) { return segment.seq > current; });
+
+    std::error_code          ec;
+    std::vector<std::size_t> sizes;
+    std::size_t              total = 0;
+    for (const auto& segment : segments) {
+        sizes.push_back(std::filesystem::file_size(segment.path, ec));
+        total += sizes.back();
+    }
+
+    // 从最旧的段开始删除，当前段永远保留
+    for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+        std::size_t count = segments.size() - i;
+        if ((retention_count_ == 0 || count <= retention_count_) &&
+            (retention_bytes_ == 0 || total <= retention_bytes_))
+            break;
+        std::filesystem::remove(segments[i].path, ec);
+        std::filesystem::remove(segments[i].path + kLogStructIndexSuffix, ec);
+        total -= sizes[i];
+    }
+}
+
+void LogStruct::manageSegments(std::stop_token st) {
+    applyRetention();
+
+    while (true) {
+        std::vector<Segment> retired;
+        bool                 need_next = false;
+        std::uint64_t        next_seq  = 0;
+        {
+            std::unique_lock lock(segment_mutex_);
+            segment_cv_.wait(lock, st,
+                             [this] { return !retired_segments_.empty() || !next_segment_; });
+            retired.swap(retired_segments_);
+            need_next = !next_segment_ && !st.stop_requested();
+            next_seq  = segment_seq_ + 1;
+        }
+
+        for (auto& segment : retired) {
+            closeSegment(segment);
+        }
+
+        if (need_next) {
+            auto next = createSegment(next_seq);
+            if (!next) {
+                // 稍后重试，期间写线程继续写当前段
+                segment_errors_.fetch_add(1, std::memory_order_relaxed);
+                std::unique_lock lock(segment_mutex_);
+                segment_cv_.wait_for(lock, st, std::chrono::seconds(1),
+                                     [this] { return !retired_segments_.empty(); });
+            } else {
+                std::lock_guard lock(segment_mutex_);
+                next_segment_ = std::move(next);
+            }
+        }
+        if (!retired.empty())
+            applyRetention();
+
+        if (st.stop_requested())
+            break;
+    }
+
+    // 写线程已经退出：删除未使用的预分配段
+    {
+        std::lock_guard lock(segment_mutex_);
+        for (auto& segment : retired_segments_) {
+            closeSegment(segment);
+        }
+        retired_segments_.clear();
+        if (next_segment_) {
+            std::string path = logStructSegmentPath(log_path_, next_segment_->seq);
+            closeSegment(*next_segment_);
+            ::unlink(path.c_str());
+            ::unlink((path + kLogStructIndexSuffix).c_str());
+            next_segment_.reset();
+        }
+    }
+    applyRetention();
+}
+
+}  // namespace utils
@@ -1,9 +1,24 @@
 #include "log_struct.hpp"
 
 #include <gtest/gtest.h>
+#include <sys/resource.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <csignal>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "log_struct_convert.hpp"
+#include "log_struct_follower.hpp"
+#include "log_struct_query.hpp"
+#include "log_struct_reader.hpp"
 
 struct TestData {
     int64_t timestamp;
@@ -19,54 +34,50 @@ struct TestData {
     double  j;
 };
 
+const std::vector<utils::LogStructField> kTestDataFields = {
+    UTILS_LOG_STRUCT_FIELD(TestData, timestamp), UTILS_LOG_STRUCT_FIELD(TestData, a),
+    UTILS_LOG_STRUCT_FIELD(TestData, b),         UTILS_LOG_STRUCT_FIELD(TestData, c),
+    UTILS_LOG_STRUCT_FIELD(TestData, d),         UTILS_LOG_STRUCT_FIELD(TestData, e),
+    UTILS_LOG_STRUCT_FIELD(TestData, f),         UTILS_LOG_STRUCT_FIELD(TestData, g),
+    UTILS_LOG_STRUCT_FIELD(TestData, h),         UTILS_LOG_STRUCT_FIELD(TestData, i),
+    UTILS_LOG_STRUCT_FIELD(TestData, j),
+};
+
 std::string log_path = "/tmp/test.log";
 
+// 性能数据见 benchmark_log_struct，这里只生成 Read 使用的文件
 TEST(LogStructTest, Write) {
     std::filesystem::remove(log_path);
-    utils::LogStruct log_struct(log_path, sizeof(TestData), 102400, 1000);
+    utils::LogStruct log_struct(log_path, sizeof(TestData), 102400, 1000,
+                                {.fields = kTestDataFields});
 
-    auto        all_start_time = std::chrono::steady_clock::now();
-    std::size_t time_count     = 0;
     for (int i = 0; i < 100000; ++i) {
         TestData test_data;
         test_data.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
                                   std::chrono::system_clock::now().time_since_epoch())
                                   .count();
-        test_data.a     = i;
-        test_data.b     = i + 1.0;
-        test_data.c     = i + 2.0;
-        test_data.d     = i + 3.0;
-        test_data.e     = i + 4.0;
-        test_data.f     = i + 5.0;
-        auto start_time = std::chrono::steady_clock::now();
-        log_struct.write(reinterpret_cast<const std::byte*>(&test_data));
-        auto end_time = std::chrono::steady_clock::now();
-        time_count +=
-            std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
-    }
-    auto all_end_time = std::chrono::steady_clock::now();
-    std::cout << "time_count: " << time_count << std::endl;
-    std::cout << "all_time_count: "
-              << std::chrono::duration_cast<std::chrono::microseconds>(all_end_time -
-                                                                       all_start_time)
-                     .count()
-              << std::endl;
+        test_data.a = i;
+        test_data.b = i + 1.0;
+        test_data.c = i + 2.0;
+        test_data.d = i + 3.0;
+        test_data.e = i + 4.0;
+        test_data.f = i + 5.0;
+        EXPECT_TRUE(log_struct.write(reinterpret_cast<const std::byte*>(&test_data)));
+    }
+    EXPECT_EQ(log_struct.stats().dropped_records, 0u);
 }
 
 TEST(LogStructTest, Read) {
-    std::ifstream ifs(log_path, std::ios::binary);
-    if (!ifs.is_open()) {
-        FAIL() << "Failed to open log file";
-    }
+    utils::LogStructReader reader(log_path);
+    EXPECT_EQ(reader.recordSize(), sizeof(TestData));
+    EXPECT_FALSE(reader.buildId().empty());
+    ASSERT_EQ(reader.fields().size(), kTestDataFields.size());
+    EXPECT_EQ(reader.fields()[reader.header().timestamp_field].name, "timestamp");
+    std::cout << "Read " << reader.size() << " data, build id: " << reader.buildId()
+              << std::endl;
 
     std::size_t index = 0;
-    while (ifs.good()) {
-        TestData test_data;
-        if (!ifs.read(reinterpret_cast<char*>(&test_data), sizeof(TestData))) {
-            std::cout << "Read " << index << " data" << std::endl;
-            break;
-        }
+    for (const auto& test_data : reader.records<TestData>()) {
         EXPECT_EQ(test_data.a, index);
         EXPECT_TRUE(std::abs(test_data.b - (index + 1.0)) < 1e-6);
         EXPECT_TRUE(std::abs(test_data.c - (index + 2.0)) < 1e-6);
@@ -75,5 +86,1297 @@ TEST(LogStructTest, Read) {
         EXPECT_TRUE(std::abs(test_data.f - (index + 5.0)) < 1e-6);
         index++;
     }
-    ifs.close();
+    EXPECT_EQ(index, reader.size());
+
+    // 按字段描述随机访问
+    const auto* field = reader.findField("f");
+    ASSERT_NE(field, nullptr);
+    EXPECT_EQ(field->type, utils::FieldType::kDouble);
+    if (reader.size() > 0) {
+        std::size_t last = reader.size() - 1;
+        EXPECT_TRUE(std::abs(reader.field<double>(last, *field) - (last + 5.0)) < 1e-6);
+    }
+}
+
+// 文件头：已有文件追加时保留原文件头，记录大小不一致时拒绝打开
+TEST(LogStructTest, ReaderHeader) {
+    std::string header_log_path = "/tmp/test_header.log";
+    std::filesystem::remove(header_log_path);
+
+    for (int round = 0; round < 2; ++round) {
+        utils::LogStructT<TestData> log_struct(header_log_path, 1024, 1000,
+                                               {.fields = kTestDataFields});
+        for (int i = 0; i < 1000; ++i) {
+            TestData test_data{};
+            test_data.a = round * 1000 + i;
+            log_struct.write(test_data);
+        }
+    }
+
+    utils::LogStructReader reader(header_log_path);
+    EXPECT_EQ(reader.header().header_size % utils::kLogStructHeaderAlign, 0u);
+    ASSERT_EQ(reader.size(), 2000u);
+    auto records = reader.records<TestData>();
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i].a, static_cast<int64_t>(i));
+    }
+
+    EXPECT_THROW(utils::LogStruct(header_log_path, sizeof(TestData) / 2, 1024, 1000),
+                 std::runtime_error);
+    EXPECT_THROW(reader.records<int64_t>(), std::invalid_argument);
+}
+
+// 稀疏时间戳索引：按时间范围定位记录，sidecar 丢失后可以恢复
+TEST(LogStructTest, TimestampIndex) {
+    std::string index_log_path  = "/tmp/test_index.log";
+    std::string index_side_path = index_log_path + utils::kLogStructIndexSuffix;
+    std::filesystem::remove(index_log_path);
+    std::filesystem::remove(index_side_path);
+
+    constexpr int kRecords = 100000;
+    auto          write    = [&](int from, int to) {
+        utils::LogStructT<TestData> log_struct(
+            index_log_path, kRecords, 1000, {.fields = kTestDataFields, .index_stride = 100});
+        for (int i = from; i < to; ++i) {
+            TestData test_data{};
+            test_data.timestamp = i * 10;
+            test_data.a         = i;
+            log_struct.write(test_data);
+        }
+    };
+    auto check = [&](const utils::LogStructReader& reader, std::size_t stride) {
+        ASSERT_EQ(reader.size(), static_cast<std::size_t>(kRecords));
+        EXPECT_EQ(reader.lowerBound(12345), 1235u);
+        EXPECT_EQ(reader.upperBound(12340), 1235u);
+        EXPECT_EQ(reader.lowerBound(-1), 0u);
+        EXPECT_EQ(reader.lowerBound(kRecords * 10), reader.size());
+        auto [from, to] = reader.timeRange(500000, 500990);
+        EXPECT_EQ(from, 50000u);
+        EXPECT_EQ(to, 50100u);
+        EXPECT_EQ(reader.index().size(), (kRecords + stride - 1) / stride);
+    };
+
+    write(0, kRecords / 2);
+    write(kRecords / 2, kRecords);
+    EXPECT_EQ(std::filesystem::file_size(index_side_path),
+              sizeof(utils::LogStructIndexHeader) +
+                  kRecords / 100 * sizeof(utils::LogStructIndexEntry));
+    check(utils::LogStructReader(index_log_path), 100);
+
+    // sidecar 丢失：读者按默认间隔在内存中重建，写入方下次打开时补齐
+    std::filesystem::remove(index_side_path);
+    check(utils::LogStructReader(index_log_path), utils::kLogStructIndexStride);
+    write(0, 0);
+    EXPECT_EQ(std::filesystem::file_size(index_side_path),
+              sizeof(utils::LogStructIndexHeader) +
+                  kRecords / 100 * sizeof(utils::LogStructIndexEntry));
+    check(utils::LogStructReader(index_log_path), 100);
+}
+
+// 块编码：两次打开追加写入，读者透明解码，结果与原记录逐字节一致；按块读取单列
+TEST(LogStructTest, BlockCodec) {
+    constexpr int kRecords = 200000;
+    auto          make     = [](int i) {
+        TestData test_data{};
+        test_data.timestamp = 1700000000000000 + i * 100 + (i * 7919) % 13;
+        test_data.a         = i / 3 - 1000;
+        test_data.b         = 100.0 + (i % 50) * 0.01;
+        test_data.c         = 42.0;
+        test_data.d         = -1.5 * (i % 7);
+        test_data.e         = i % 2 ? -0.0 : std::numeric_limits<double>::quiet_NaN();
+        test_data.f         = std::numeric_limits<double>::max();
+        test_data.g         = std::ldexp(1.0, i % 2000 - 1000);
+        std::uint64_t bits  = static_cast<std::uint64_t>(i) * 0x9e3779b97f4a7c15ull;
+        std::memcpy(&test_data.h, &bits, sizeof(bits));
+        return test_data;
+    };
+
+    for (auto [codec, backend] :
+         {std::pair{utils::LogStructCodec::kDelta, utils::LogStructBackend::kWrite},
+          std::pair{utils::LogStructCodec::kDelta, utils::LogStructBackend::kIoUring},
+          std::pair{utils::LogStructCodec::kColumnar, utils::LogStructBackend::kWrite}}) {
+        std::string codec_log_path = "/tmp/test_codec.log";
+        std::filesystem::remove(codec_log_path);
+        std::filesystem::remove(codec_log_path + utils::kLogStructIndexSuffix);
+
+        auto write = [&](int from, int to) {
+            utils::LogStructT<TestData> log_struct(codec_log_path, 10000, 1000,
+                                                   {.buffer_count = 4,
+                                                    .backend      = backend,
+                                                    .fields       = kTestDataFields,
+                                                    .index_stride = 100,
+                                                    .codec        = codec});
+            for (int i = from; i < to; ++i) {
+                while (!log_struct.write(make(i))) std::this_thread::yield();
+            }
+        };
+        write(0, kRecords / 2);
+        write(kRecords / 2, kRecords);
+
+        auto file_size = std::filesystem::file_size(codec_log_path);
+        std::cout << "codec: " << static_cast<int>(codec) << " raw: " << kRecords * sizeof(TestData)
+                  << " encoded: " << file_size << std::endl;
+        if (codec == utils::LogStructCodec::kDelta) {
+            EXPECT_LT(file_size, kRecords * sizeof(TestData) / 2);
+        }
+
+        {
+            utils::LogStructReader reader(codec_log_path);
+            EXPECT_NE(reader.header().flags & utils::kLogStructFlagBlocks, 0u);
+            ASSERT_EQ(reader.size(), static_cast<std::size_t>(kRecords));
+            auto records = reader.records<TestData>();
+            for (int i = 0; i < kRecords; ++i) {
+                TestData expected = make(i);
+                ASSERT_EQ(std::memcmp(&records[i], &expected, sizeof(TestData)), 0) << i;
+            }
+            EXPECT_EQ(reader.lowerBound(make(12345).timestamp), 12345u);
+            EXPECT_EQ(reader.index().size(), kRecords / 100u);
+        }
+        {
+            utils::LogStructReader reader(codec_log_path);
+            const auto*            h = reader.findField("h");
+            const auto*            a = reader.findField("a");
+            std::vector<double>    hs;
+            std::vector<int64_t>   as;
+            std::size_t            total = 0;
+            for (std::size_t block = 0; block < reader.blockCount(); ++block) {
+                auto [first, last] = reader.blockRange(block);
+                EXPECT_EQ(first, total);
+                reader.column(block, *h, hs);
+                reader.column(block, *a, as);
+                ASSERT_EQ(hs.size(), last - first);
+                for (std::size_t i = first; i < last; ++i) {
+                    TestData expected = make(static_cast<int>(i));
+                    ASSERT_EQ(std::memcmp(&hs[i - first], &expected.h, sizeof(double)), 0) << i;
+                    ASSERT_EQ(as[i - first], expected.a) << i;
+                }
+                total = last;
+            }
+            EXPECT_EQ(total, static_cast<std::size_t>(kRecords));
+        }
+
+        // 末尾写了一半的块：读者忽略，写入方重新打开时截掉
+        std::filesystem::resize_file(codec_log_path, file_size - 1);
+        EXPECT_LT(utils::LogStructReader(codec_log_path).size(),
+                  static_cast<std::size_t>(kRecords));
+        write(0, 0);
+        utils::LogStructReader reader(codec_log_path);
+        EXPECT_LT(std::filesystem::file_size(codec_log_path), file_size);
+        EXPECT_EQ(reader.lowerBound(make(kRecords - 1).timestamp), reader.size());
+        EXPECT_EQ(reader.index().size(), (reader.size() + 99) / 100);
+    }
+}
+
+// 追加已有的编码文件：列布局来自文件头中的字段描述。不给出字段时沿用文件中的字段，
+// 给出不一致的字段时拒绝打开，已有数据不受影响。轮转时续写最后一个段同样如此
+TEST(LogStructTest, ReopenFields) {
+    struct SmallData {
+        int64_t timestamp;
+        int64_t a;
+        double  b;
+    };
+    const std::vector<utils::LogStructField> fields = {
+        UTILS_LOG_STRUCT_FIELD(SmallData, timestamp),
+        UTILS_LOG_STRUCT_FIELD(SmallData, a),
+        UTILS_LOG_STRUCT_FIELD(SmallData, b),
+    };
+    // 与文件中的字段长度相同但布局不同
+    const std::vector<utils::LogStructField> other_fields = {
+        {"timestamp", utils::FieldType::kInt64, 0, 8},
+        {"b", utils::FieldType::kDouble, 8, 8},
+        {"a", utils::FieldType::kInt64, 16, 8},
+    };
+    constexpr int     kRecords        = 500;
+    const std::string reopen_log_path = "/tmp/test_reopen.log";
+    auto              cleanup         = [&] {
+        std::filesystem::remove(reopen_log_path);
+        std::filesystem::remove(reopen_log_path + utils::kLogStructIndexSuffix);
+        for (const auto& segment : utils::listLogStructSegments(reopen_log_path)) {
+            std::filesystem::remove(segment.path);
+            std::filesystem::remove(segment.path + utils::kLogStructIndexSuffix);
+        }
+    };
+
+    for (auto codec : {utils::LogStructCodec::kDelta, utils::LogStructCodec::kColumnar}) {
+        for (bool rotating : {false, true}) {
+            cleanup();
+            auto options = [&](const std::vector<utils::LogStructField>& with_fields) {
+                return utils::LogStructOptions{.buffer_count = 4,
+                                               .fields       = with_fields,
+                                               .index_stride = 100,
+                                               .codec        = codec,
+                                               .rotate_bytes = rotating ? 1u << 20 : 0u};
+            };
+            auto write = [&](const std::vector<utils::LogStructField>& with_fields, int from) {
+                utils::LogStructT<SmallData> log_struct(reopen_log_path, 128, 1000,
+                                                        options(with_fields));
+                for (int i = from; i < from + kRecords; ++i) {
+                    SmallData data{1700000000000000 + i * 10, i * 3 - 7, i * 0.5};
+                    while (!log_struct.write(data)) std::this_thread::yield();
+                }
+            };
+            auto path = [&] {
+                return rotating ? utils::listLogStructSegments(reopen_log_path).back().path
+                                : reopen_log_path;
+            };
+
+            write(fields, 0);
+            write({}, kRecords);
+            EXPECT_THROW(write(other_fields, 2 * kRecords), std::runtime_error);
+            if (rotating) {
+                EXPECT_EQ(utils::listLogStructSegments(reopen_log_path).size(), 1u);
+            }
+
+            utils::LogStructReader reader(path());
+            ASSERT_EQ(reader.fields().size(), fields.size());
+            EXPECT_EQ(reader.fields()[2].name, "b");
+            auto records = reader.records<SmallData>();
+            ASSERT_EQ(records.size(), 2u * kRecords);
+            for (int i = 0; i < 2 * kRecords; ++i) {
+                ASSERT_EQ(records[i].timestamp, 1700000000000000 + i * 10) << i;
+                ASSERT_EQ(records[i].a, i * 3 - 7) << i;
+                ASSERT_EQ(records[i].b, i * 0.5) << i;
+            }
+            // 续写部分的索引由同一列布局解码得到
+            EXPECT_EQ(reader.index().size(), 2u * kRecords / 100);
+            EXPECT_EQ(reader.lowerBound(1700000000000000 + 777 * 10), 777u);
+        }
+    }
+    cleanup();
+}
+
+// 崩溃恢复：块头带序号和 CRC32C，重新打开时从文件头的 checkpoint 开始校验，截掉损坏的尾部
+TEST(LogStructTest, BlockRecovery) {
+    // CRC32C 的标准校验值
+    const std::string check_input = "123456789";
+    EXPECT_EQ(utils::crc32c(reinterpret_cast<const std::byte*>(check_input.data()),
+                            check_input.size()),
+              0xe3069283u);
+
+    constexpr int     kRecords          = 10000;
+    const std::string recovery_log_path = "/tmp/test_recovery.log";
+    std::filesystem::remove(recovery_log_path);
+    std::filesystem::remove(recovery_log_path + utils::kLogStructIndexSuffix);
+
+    auto write = [&](int from, int to) {
+        utils::LogStructT<TestData> log_struct(recovery_log_path, 1000, 1000,
+                                               {.buffer_count = 4,
+                                                .fields       = kTestDataFields,
+                                                .codec        = utils::LogStructCodec::kColumnar});
+        for (int i = from; i < to; ++i) {
+            TestData test_data{};
+            test_data.a = i;
+            while (!log_struct.write(test_data)) std::this_thread::yield();
+        }
+    };
+    auto corrupt = [&](std::uint64_t offset) {
+        std::fstream file(recovery_log_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.put('\x5a');
+    };
+    auto checkpoint = [&] { return utils::LogStructReader(recovery_log_path).header().checkpoint; };
+    auto check      = [&](std::size_t expected) {
+        utils::LogStructReader reader(recovery_log_path);
+        ASSERT_EQ(reader.size(), expected);
+        std::int64_t index = 0;
+        for (const auto& record : reader.records<TestData>()) ASSERT_EQ(record.a, index++);
+    };
+
+    write(0, kRecords);
+    auto last_block = checkpoint();
+    EXPECT_GT(last_block, utils::LogStructReader(recovery_log_path).header().header_size);
+    check(kRecords);
+
+    // 最后一块的负载损坏：读者忽略这一块，写入方重新打开时截掉后接着写
+    corrupt(last_block + sizeof(utils::LogStructBlockHeader) + 100);
+    std::size_t kept = utils::LogStructReader(recovery_log_path).size();
+    EXPECT_LT(kept, static_cast<std::size_t>(kRecords));
+    write(static_cast<int>(kept), kRecords);
+    check(kRecords);
+
+    // checkpoint 指向的不是合法的块：从头查找
+    auto set_checkpoint = [&](std::uint64_t value) {
+        std::fstream file(recovery_log_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetof(utils::LogStructFileHeader, checkpoint));
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    set_checkpoint(checkpoint() + 1);
+    write(kRecords, kRecords + 1);
+    check(kRecords + 1);
+
+    // checkpoint 之前的块损坏：恢复不再逐一校验，读者整体解码时发现
+    corrupt(utils::LogStructReader(recovery_log_path).header().header_size +
+            sizeof(utils::LogStructBlockHeader) + 100);
+    EXPECT_THROW(utils::LogStructReader(recovery_log_path).records<TestData>(),
+                 std::runtime_error);
+
+    // 从头查找时 kNone 只校验最后几块的 CRC；kPeriodic 逐块校验，截掉损坏的第一块及之后的数据
+    auto reopen = [&](utils::LogStructDurability durability) {
+        set_checkpoint(0);
+        utils::LogStructT<TestData> log_struct(recovery_log_path, 1000, 1000,
+                                               {.durability = durability,
+                                                .fields     = kTestDataFields,
+                                                .codec      = utils::LogStructCodec::kColumnar});
+    };
+    reopen(utils::LogStructDurability::kNone);
+    EXPECT_EQ(utils::LogStructReader(recovery_log_path).size(), kRecords + 1u);
+    reopen(utils::LogStructDurability::kPeriodic);
+    EXPECT_EQ(utils::LogStructReader(recovery_log_path).size(), 0u);
+
+    // 未编码文件末尾不完整的记录：重新打开时截掉，之后的记录不会错位
+    std::filesystem::remove(recovery_log_path);
+    TestData test_data{};
+    {
+        utils::LogStructT<TestData> log_struct(recovery_log_path, 1000, 1000);
+        for (test_data.a = 0; test_data.a < 10; ++test_data.a) log_struct.write(test_data);
+    }
+    std::filesystem::resize_file(recovery_log_path,
+                                 std::filesystem::file_size(recovery_log_path) - 3);
+    {
+        utils::LogStructT<TestData> log_struct(recovery_log_path, 1000, 1000);
+        test_data.a = 9;
+        log_struct.write(test_data);
+    }
+    check(10);
+}
+
+TEST(LogStructTest, Metrics) {
+    // 桶边界：小于 16 的值精确，之后每个 2 的幂区间 16 档
+    using utils::LatencyHistogram;
+    for (std::uint64_t value : {0ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull}) {
+        std::size_t bucket = LatencyHistogram::bucketOf(value);
+        ASSERT_LT(bucket, LatencyHistogram::kBucketCount);
+        EXPECT_LE(LatencyHistogram::lowerBound(bucket), value);
+        EXPECT_GE(LatencyHistogram::upperBound(bucket), value);
+        EXPECT_LE(LatencyHistogram::upperBound(bucket) - LatencyHistogram::lowerBound(bucket),
+                  value / 16);
+    }
+
+    std::string metrics_log_path = "/tmp/test_metrics.log";
+    std::filesystem::remove(metrics_log_path);
+
+    constexpr int           kRecords = 100000;
+    utils::LogStructMetrics before, after;
+    {
+        utils::LogStructT<TestData> log_struct(metrics_log_path, 1000, 1000,
+                                               {.buffer_count = 8, .metrics = true});
+        before = log_struct.metrics();
+        for (int i = 0; i < kRecords; ++i) {
+            TestData test_data{};
+            test_data.a = i;
+            log_struct.write(test_data);
+            if (i % 10000 == 0)
+                log_struct.flush();
+        }
+        while (!log_struct.flush()) std::this_thread::yield();
+        // 等待写线程写完最后一块
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            after = log_struct.metrics();
+        } while (after.written_bytes + after.dropped_records * sizeof(TestData) <
+                     kRecords * sizeof(TestData) &&
+                 std::chrono::steady_clock::now() < deadline);
+    }
+
+    EXPECT_EQ(after.write_latency.count, static_cast<std::uint64_t>(kRecords));
+    EXPECT_GT(after.flush_latency.count, kRecords / 10000u);
+    EXPECT_GT(after.io_latency.count, 0u);
+    EXPECT_LE(after.write_latency.percentile(0.5), after.write_latency.percentile(0.99));
+    EXPECT_LE(after.write_latency.percentile(0.99), after.write_latency.max());
+    EXPECT_EQ(after.written_bytes + after.dropped_records * sizeof(TestData),
+              kRecords * sizeof(TestData));
+    EXPECT_GT(after.bytesPerSecond(before), 0.0);
+
+    // 未开启统计时直方图为空，计数照常
+    utils::LogStructT<TestData> log_struct(metrics_log_path, 1000, 1000);
+    log_struct.write(TestData{});
+    auto metrics = log_struct.metrics();
+    EXPECT_TRUE(metrics.write_latency.buckets.empty());
+    EXPECT_EQ(metrics.write_latency.percentile(0.99), 0u);
+}
+
+// 段轮转：按大小切换段，保留策略删除最旧的段
+TEST(LogStructTest, SegmentRotation) {
+    std::string rotate_log_path = "/tmp/test_rotate.log";
+    auto        cleanup         = [&] {
+        for (const auto& segment : utils::listLogStructSegments(rotate_log_path)) {
+            std::filesystem::remove(segment.path);
+            std::filesystem::remove(segment.path + utils::kLogStructIndexSuffix);
+        }
+    };
+
+    constexpr std::size_t kSegmentRecords = 1000;
+    constexpr int         kRecords        = 20000;
+    for (std::size_t retention_count : {0, 3}) {
+        cleanup();
+        std::size_t           written_count = 0;
+        utils::LogStructStats stats;
+        {
+            utils::LogStructT<TestData> log_struct(
+                rotate_log_path, 256, 1000,
+                {.buffer_count    = 8,
+                 .fields          = kTestDataFields,
+                 .rotate_bytes    = kSegmentRecords * sizeof(TestData),
+                 .retention_count = retention_count});
+            for (int i = 0; i < kRecords; ++i) {
+                TestData test_data{};
+                test_data.timestamp = i;
+                test_data.a         = i;
+                if (log_struct.write(test_data))
+                    ++written_count;
+                if (i % 256 == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            // 等剩余记录写完（写线程可能因此再切换一次段）后再取统计
+            ASSERT_TRUE(log_struct.flushAndWait(log_struct.sequence()));
+            stats = log_struct.stats();
+        }
+        std::cout << "retention_count: " << retention_count << " written: " << written_count
+                  << " rotated_segments: " << stats.rotated_segments
+                  << " delayed_rotations: " << stats.delayed_rotations << std::endl;
+
+        // 未使用的预分配段在析构时被删除，段之间的记录连续递增
+        auto segments = utils::listLogStructSegments(rotate_log_path);
+        ASSERT_FALSE(segments.empty());
+        EXPECT_EQ(segments.size() - 1, retention_count == 0
+                                           ? stats.rotated_segments
+                                           : std::min(stats.rotated_segments, retention_count - 1));
+        std::size_t total = 0;
+        int64_t     last  = -1;
+        for (const auto& segment : segments) {
+            utils::LogStructReader reader(segment.path);
+            if (stats.delayed_rotations == 0) {
+                EXPECT_LE(reader.size(), kSegmentRecords);
+            }
+            for (const auto& test_data : reader.records<TestData>()) {
+                EXPECT_GT(test_data.a, last);
+                last = test_data.a;
+            }
+            total += reader.size();
+        }
+        if (retention_count == 0) {
+            EXPECT_EQ(total, written_count);
+        }
+    }
+    cleanup();
+}
+
+// 多生产者：每个线程写入 kRecordsPerProducer 条记录，统计 1 ~ N 个生产者的吞吐
+TEST(LogStructTest, MultiProducerWrite) {
+    constexpr int kRecordsPerProducer = 100000;
+    constexpr int kMaxProducers       = 8;
+
+    for (int producers = 1; producers <= kMaxProducers; producers *= 2) {
+        std::string mp_log_path = "/tmp/test_mp.log";
+        std::filesystem::remove(mp_log_path);
+
+        std::atomic<std::size_t> written_count{0};
+        auto                     all_start_time = std::chrono::steady_clock::now();
+        {
+            utils::LogStruct log_struct(mp_log_path, sizeof(TestData), 102400, 1000,
+                                        {.producer_mode = utils::ProducerMode::kMulti});
+
+            std::vector<std::jthread> threads;
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&, p]() {
+                    std::size_t count = 0;
+                    for (int i = 0; i < kRecordsPerProducer; ++i) {
+                        TestData test_data{};
+                        test_data.a = i;
+                        test_data.b = p;
+                        if (log_struct.write(reinterpret_cast<const std::byte*>(&test_data)))
+                            ++count;
+                    }
+                    written_count.fetch_add(count);
+                });
+            }
+        }
+        auto all_end_time = std::chrono::steady_clock::now();
+        auto elapsed_us   = std::chrono::duration_cast<std::chrono::microseconds>(all_end_time -
+                                                                                all_start_time)
+                              .count();
+        std::cout << "producers: " << producers << " written: " << written_count.load()
+                  << " all_time_count: " << elapsed_us << " records/s: "
+                  << written_count.load() * 1000000.0 / std::max<int64_t>(elapsed_us, 1)
+                  << std::endl;
+
+        // 文件中的记录数与写入成功数一致，且每个生产者内部保持顺序
+        utils::LogStructReader reader(mp_log_path);
+        std::vector<int>       last_index(producers, -1);
+        std::size_t            index = 0;
+        for (const auto& test_data : reader.records<TestData>()) {
+            auto p = static_cast<int>(test_data.b);
+            ASSERT_GE(p, 0);
+            ASSERT_LT(p, producers);
+            EXPECT_GT(test_data.a, last_index[p]);
+            last_index[p] = static_cast<int>(test_data.a);
+            index++;
+        }
+        EXPECT_EQ(index, written_count.load());
+    }
+}
+
+// 类型化接口：reserve() 返回缓冲区内的记录，原地填充后 commit()
+TEST(LogStructTest, TypedReserveCommit) {
+    std::string typed_log_path = "/tmp/test_typed.log";
+    std::filesystem::remove(typed_log_path);
+
+    constexpr int kRecords        = 100000;
+    std::size_t   committed_count = 0;
+    {
+        utils::LogStructT<TestData> log_struct(typed_log_path, 1024, 1000);
+        for (int i = 0; i < kRecords; ++i) {
+            TestData& test_data = log_struct.reserve();
+            test_data.timestamp = i;
+            test_data.a         = i;
+            test_data.b         = i + 1.0;
+            if (log_struct.commit(test_data))
+                ++committed_count;
+        }
+    }
+
+    utils::LogStructReader reader(typed_log_path);
+    std::size_t            index = 0;
+    int64_t                last  = -1;
+    for (const auto& test_data : reader.records<TestData>()) {
+        EXPECT_GT(test_data.a, last);
+        EXPECT_TRUE(std::abs(test_data.b - (test_data.a + 1.0)) < 1e-6);
+        last = test_data.a;
+        index++;
+    }
+    EXPECT_GT(committed_count, 0u);
+    EXPECT_EQ(index, committed_count);
+}
+
+// 环形缓冲区：丢弃计数与实际落盘记录数一致
+TEST(LogStructTest, RingBufferStats) {
+    std::string ring_log_path = "/tmp/test_ring.log";
+    std::filesystem::remove(ring_log_path);
+
+    constexpr int            kProducers          = 4;
+    constexpr int            kRecordsPerProducer = 100000;
+    std::atomic<std::size_t> written_count{0};
+    utils::LogStructStats    stats;
+    {
+        utils::LogStruct log_struct(ring_log_path, sizeof(TestData), 256, 1000,
+                                    {.producer_mode = utils::ProducerMode::kMulti,
+                                     .buffer_count  = 8});
+
+        std::vector<std::jthread> threads;
+        for (int p = 0; p < kProducers; ++p) {
+            threads.emplace_back([&, p]() {
+                std::size_t count = 0;
+                for (int i = 0; i < kRecordsPerProducer; ++i) {
+                    TestData test_data{};
+                    test_data.a = i;
+                    test_data.b = p;
+                    if (log_struct.write(reinterpret_cast<const std::byte*>(&test_data)))
+                        ++count;
+                }
+                written_count.fetch_add(count);
+            });
+        }
+        threads.clear();
+        stats = log_struct.stats();
+    }
+    std::cout << "buffer_count: " << stats.buffer_count
+              << " high_water_buffers: " << stats.high_water_buffers
+              << " dropped_records: " << stats.dropped_records
+              << " failed_flushes: " << stats.failed_flushes << std::endl;
+
+    EXPECT_EQ(stats.buffer_count, 8u);
+    EXPECT_GE(stats.high_water_buffers, 2u);
+    EXPECT_LE(stats.high_water_buffers, 8u);
+    EXPECT_EQ(stats.dropped_records + written_count.load(),
+              static_cast<std::size_t>(kProducers) * kRecordsPerProducer);
+
+    EXPECT_EQ(utils::LogStructReader(ring_log_path).size(), written_count.load());
+}
+
+// 溢出策略：缓冲区很小时各策略的计数与落盘记录一致
+TEST(LogStructTest, OverflowPolicies) {
+    constexpr int     kRecords          = 200000;
+    const std::string overflow_log_path = "/tmp/test_overflow.log";
+    const std::string spill_path        = overflow_log_path + utils::kLogStructSpillSuffix;
+
+    for (auto policy : {utils::LogStructOverflow::kDropNewest, utils::LogStructOverflow::kBlock,
+                        utils::LogStructOverflow::kDropActiveBuffer,
+                        utils::LogStructOverflow::kSpill}) {
+        std::filesystem::remove(overflow_log_path);
+        std::filesystem::remove(spill_path);
+
+        std::size_t           accepted = 0;
+        utils::LogStructStats stats;
+        {
+            utils::LogStruct log_struct(overflow_log_path, sizeof(TestData), 16, 1000,
+                                        {.buffer_count = 2,
+                                         .overflow      = policy,
+                                         .block_timeout = std::chrono::microseconds{0}});
+            for (int i = 0; i < kRecords; ++i) {
+                TestData test_data{};
+                test_data.a = i;
+                if (log_struct.write(reinterpret_cast<const std::byte*>(&test_data)))
+                    ++accepted;
+            }
+            stats = log_struct.stats();
+        }
+
+        // 主文件中的记录保持写入顺序
+        utils::LogStructReader reader(overflow_log_path);
+        std::int64_t           last = -1;
+        for (const auto& record : reader.records<TestData>()) {
+            EXPECT_GT(record.a, last);
+            last = record.a;
+        }
+
+        switch (policy) {
+            case utils::LogStructOverflow::kDropNewest:
+                EXPECT_EQ(accepted + stats.dropped_records, static_cast<std::size_t>(kRecords));
+                EXPECT_EQ(reader.size(), accepted);
+                break;
+            case utils::LogStructOverflow::kBlock:
+                // 不限时等待：一条都不丢
+                EXPECT_EQ(accepted, static_cast<std::size_t>(kRecords));
+                EXPECT_EQ(stats.dropped_records, 0u);
+                EXPECT_EQ(stats.block_timeouts, 0u);
+                EXPECT_GT(stats.blocked_writes, 0u);
+                EXPECT_EQ(reader.size(), accepted);
+                break;
+            case utils::LogStructOverflow::kDropActiveBuffer:
+                // 从不阻塞也从不拒绝，随活动缓冲区丢弃的记录单独计数
+                EXPECT_EQ(accepted, static_cast<std::size_t>(kRecords));
+                EXPECT_EQ(stats.dropped_records, 0u);
+                EXPECT_GT(stats.discarded_records, 0u);
+                EXPECT_EQ(reader.size() + stats.discarded_records,
+                          static_cast<std::size_t>(kRecords));
+                EXPECT_EQ(last, kRecords - 1);
+                break;
+            case utils::LogStructOverflow::kSpill: {
+                EXPECT_EQ(accepted, static_cast<std::size_t>(kRecords));
+                EXPECT_EQ(stats.dropped_records, 0u);
+                EXPECT_GT(stats.spilled_records, 0u);
+                utils::LogStructReader spill(spill_path);
+                EXPECT_EQ(spill.size(), stats.spilled_records);
+                EXPECT_EQ(reader.size() + spill.size(), static_cast<std::size_t>(kRecords));
+                break;
+            }
+        }
+    }
+}
+
+// 写入失败：用 RLIMIT_FSIZE 让文件增长到上限后的写入失败，恢复上限后继续写入，
+// 失败的缓冲区整块丢弃并计数，文件中不留空洞，块编码的文件重新打开后所有块都能恢复；
+// 等待越过丢失记录的 flushAndWait() 返回 false
+TEST(LogStructTest, WriteErrors) {
+    constexpr int     kRecords       = 20000;
+    const std::string error_log_path = "/tmp/test_write_errors.log";
+
+    struct Case {
+        utils::LogStructBackend backend;
+        utils::LogStructCodec   codec;
+    };
+    for (auto [backend, codec] :
+         {Case{utils::LogStructBackend::kWrite, utils::LogStructCodec::kNone},
+          Case{utils::LogStructBackend::kWrite, utils::LogStructCodec::kColumnar},
+          Case{utils::LogStructBackend::kIoUring, utils::LogStructCodec::kNone},
+          Case{utils::LogStructBackend::kIoUring, utils::LogStructCodec::kColumnar}}) {
+        std::filesystem::remove(error_log_path);
+        std::filesystem::remove(error_log_path + utils::kLogStructIndexSuffix);
+
+        auto   old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit old_limit;
+        ::getrlimit(RLIMIT_FSIZE, &old_limit);
+
+        utils::LogStructStats stats;
+        {
+            utils::LogStructT<TestData> log_struct(error_log_path, 1000, 1000,
+                                                   {.buffer_count = 4,
+                                                    .overflow = utils::LogStructOverflow::kBlock,
+                                                    .backend  = backend,
+                                                    .fields   = kTestDataFields,
+                                                    .codec    = codec});
+            rlimit limit   = old_limit;
+            limit.rlim_cur =
+                std::filesystem::file_size(error_log_path) + 3 * sizeof(TestData) * 1000;
+            ::setrlimit(RLIMIT_FSIZE, &limit);
+
+            TestData test_data{};
+            for (int i = 0; i < kRecords / 2; ++i) {
+                test_data.a = i;
+                ASSERT_TRUE(log_struct.write(test_data));
+            }
+            // 越过丢失记录的 flushAndWait() 返回 false，之前的记录仍可以等待落盘
+            EXPECT_FALSE(log_struct.flushAndWait(log_struct.sequence()));
+            EXPECT_TRUE(log_struct.flushAndWait(1000));
+            ::setrlimit(RLIMIT_FSIZE, &old_limit);
+            for (int i = kRecords / 2; i < kRecords; ++i) {
+                test_data.a = i;
+                ASSERT_TRUE(log_struct.write(test_data));
+            }
+            EXPECT_FALSE(log_struct.flushAndWait(log_struct.sequence()));
+            stats = log_struct.stats();
+        }
+        std::signal(SIGXFSZ, old_handler);
+
+        EXPECT_GT(stats.write_errors, 0u);
+        EXPECT_GT(stats.lost_records, 0u);
+        auto check = [&] {
+            utils::LogStructReader reader(error_log_path);
+            EXPECT_EQ(reader.size() + stats.lost_records, static_cast<std::size_t>(kRecords));
+            std::int64_t last = -1;
+            for (const auto& record : reader.records<TestData>()) {
+                ASSERT_GT(record.a, last);
+                last = record.a;
+            }
+            EXPECT_EQ(last, kRecords - 1);
+        };
+        check();
+        { utils::LogStructT<TestData> log_struct(error_log_path, 1000, 1000, {.codec = codec}); }
+        check();
+    }
+}
+
+// 持久化：flushAndWait 等到指定序号之前的记录落盘，kPeriodic 无新写入时也按时同步
+TEST(LogStructTest, Durability) {
+    const std::string durable_log_path = "/tmp/test_durable.log";
+
+    struct Case {
+        utils::LogStructBackend    backend;
+        utils::LogStructDurability durability;
+    };
+    for (auto [backend, durability] :
+         {Case{utils::LogStructBackend::kWrite, utils::LogStructDurability::kNone},
+          Case{utils::LogStructBackend::kWrite, utils::LogStructDurability::kPeriodic},
+          Case{utils::LogStructBackend::kWrite, utils::LogStructDurability::kWriteback},
+          Case{utils::LogStructBackend::kIoUring, utils::LogStructDurability::kPeriodic},
+          Case{utils::LogStructBackend::kMmap, utils::LogStructDurability::kNone}}) {
+        std::filesystem::remove(durable_log_path);
+        utils::LogStruct log_struct(durable_log_path, sizeof(TestData), 1024, 1000,
+                                    {.producer_mode     = utils::ProducerMode::kMulti,
+                                     .buffer_count      = 4,
+                                     .backend           = backend,
+                                     .durability        = durability,
+                                     .sync_interval     = std::chrono::milliseconds{10},
+                                     .dirty_window      = 64 * sizeof(TestData),
+                                     .mmap_segment_size = std::size_t{1} << 20});
+
+        TestData test_data{};
+        for (int i = 0; i < 3000; ++i) {
+            test_data.a = i;
+            ASSERT_TRUE(log_struct.write(reinterpret_cast<const std::byte*>(&test_data)));
+        }
+        EXPECT_EQ(log_struct.sequence(), 3000u);
+        EXPECT_TRUE(log_struct.flushAndWait(log_struct.sequence()));
+        EXPECT_GE(log_struct.durableSequence(), 3000u);
+
+        // 多个线程同时等待
+        std::vector<std::jthread> threads;
+        for (int p = 0; p < 4; ++p) {
+            threads.emplace_back([&]() {
+                TestData record{};
+                for (int i = 0; i < 100; ++i) {
+                    ASSERT_TRUE(log_struct.write(reinterpret_cast<const std::byte*>(&record)));
+                    std::uint64_t seq = log_struct.sequence();
+                    EXPECT_TRUE(log_struct.flushAndWait(seq));
+                    EXPECT_GE(log_struct.durableSequence(), seq);
+                }
+            });
+        }
+        threads.clear();
+        EXPECT_GT(log_struct.stats().syncs, 0u);
+
+        if (durability == utils::LogStructDurability::kPeriodic) {
+            ASSERT_TRUE(log_struct.write(reinterpret_cast<const std::byte*>(&test_data)));
+            log_struct.flush();
+            std::uint64_t seq = log_struct.sequence();
+            for (int i = 0; i < 200 && log_struct.durableSequence() < seq; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            }
+            EXPECT_GE(log_struct.durableSequence(), seq);
+        }
+    }
+}
+
+// 切换间隔由写线程检查：多生产者模式下停止写入后数据仍按 polling_interval 落盘，
+// 单生产者模式下在下一次 write() 时切换
+TEST(LogStructTest, TimerFlush) {
+    const std::string timer_log_path = "/tmp/test_timer.log";
+
+    for (auto mode : {utils::ProducerMode::kMulti, utils::ProducerMode::kSingle}) {
+        std::filesystem::remove(timer_log_path);
+        utils::LogStruct log_struct(timer_log_path, sizeof(TestData), 1024, 10,
+                                    {.producer_mode = mode});
+        TestData test_data{};
+        for (int i = 0; i < 10; ++i) {
+            test_data.a = i;
+            ASSERT_TRUE(log_struct.write(reinterpret_cast<const std::byte*>(&test_data)));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        if (mode == utils::ProducerMode::kSingle)
+            ASSERT_TRUE(log_struct.write(reinterpret_cast<const std::byte*>(&test_data)));
+
+        std::size_t expected = mode == utils::ProducerMode::kMulti ? 10 : 11;
+        std::size_t size     = 0;
+        for (int i = 0; i < 200 && size < expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            size = utils::LogStructReader(timer_log_path).size();
+        }
+        EXPECT_EQ(size, expected);
+    }
+}
+
+// 各时钟源与 system_clock 的偏差在其精度范围内
+TEST(LogStructTest, ClockSource) {
+    for (auto [source, tolerance_us] :
+         {std::pair{utils::LogStructClockSource::kSystem, 1000},
+          std::pair{utils::LogStructClockSource::kCoarse, 20000},
+          std::pair{utils::LogStructClockSource::kTsc, 1000}}) {
+        utils::LogStructClock clock(source);
+        std::int64_t          last = clock.now();
+        for (int i = 0; i < 1000; ++i) {
+            std::int64_t now = clock.now();
+            EXPECT_GE(now, last);
+            last = now;
+        }
+
+        std::int64_t system = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count();
+        EXPECT_LT(std::abs(clock.now() - system), tolerance_us)
+            << "source " << static_cast<int>(clock.source());
+    }
+}
+
+// 跟随写入中的文件：按顺序交出完整记录，不丢不重；按时间戳定位起点；interrupt() 唤醒等待
+TEST(LogStructTest, Follower) {
+    constexpr int     kRecords        = 20000;
+    const std::string follow_log_path = "/tmp/test_follow.log";
+
+    for (auto backend : {utils::LogStructBackend::kWrite, utils::LogStructBackend::kMmap}) {
+        std::filesystem::remove(follow_log_path);
+        {
+            utils::LogStruct log_struct(follow_log_path, sizeof(TestData), 256, 1,
+                                        {.producer_mode = utils::ProducerMode::kMulti,
+                                         .buffer_count  = 8,
+                                         .backend       = backend,
+                                         .fields        = kTestDataFields});
+            utils::LogStructFollower follower(follow_log_path);
+
+            std::jthread producer([&]() {
+                for (int i = 0; i < kRecords; ++i) {
+                    TestData test_data{};
+                    test_data.timestamp = i;
+                    test_data.a         = i;
+                    while (!log_struct.write(reinterpret_cast<const std::byte*>(&test_data))) {
+                        std::this_thread::yield();
+                    }
+                    if (i % 1000 == 0)
+                        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                }
+            });
+
+            std::int64_t expected = 0;
+            while (expected < kRecords) {
+                auto records = follower.next<TestData>(std::chrono::seconds{5});
+                ASSERT_FALSE(records.empty()) << "stalled at " << expected;
+                for (const auto& record : records) {
+                    ASSERT_EQ(record.a, expected);
+                    ++expected;
+                }
+            }
+            EXPECT_EQ(follower.position(), static_cast<std::size_t>(kRecords));
+        }
+
+        utils::LogStructFollower from_time(follow_log_path, std::int64_t{12345});
+        auto records = from_time.next<TestData>(std::chrono::milliseconds{100});
+        ASSERT_EQ(records.size(), static_cast<std::size_t>(kRecords - 12345));
+        EXPECT_EQ(records.front().a, 12345);
+
+        // 文件不再增长：interrupt() 让阻塞的 next() 立即返回空
+        std::jthread interrupter([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            from_time.interrupt();
+        });
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_TRUE(from_time.next(std::chrono::seconds{10}).empty());
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{5});
+    }
+}
+
+// 并行转换：小块多线程下 CSV 的行顺序与输入一致，字段选择和时间范围生效；列输出按字段紧凑存放
+TEST(LogStructTest, Convert) {
+    constexpr int     kRecords         = 10000;
+    const std::string convert_log_path = "/tmp/test_convert.log";
+    const std::string csv_path         = "/tmp/test_convert.csv";
+    const std::string columns_path     = "/tmp/test_convert_columns";
+    std::filesystem::remove(convert_log_path);
+    std::filesystem::remove(csv_path);
+    std::filesystem::remove_all(columns_path);
+    {
+        utils::LogStructT<TestData> log_struct(convert_log_path, kRecords, 1000,
+                                               {.fields = kTestDataFields});
+        for (int i = 0; i < kRecords; ++i) {
+            TestData test_data{};
+            test_data.timestamp = i * 10;
+            test_data.a         = -i;
+            test_data.b         = i * 0.5;
+            log_struct.write(test_data);
+        }
+    }
+
+    auto result = utils::convertLogStruct(convert_log_path, csv_path,
+                                          {.fields        = {"a", "timestamp", "b"},
+                                           .from          = 1000,
+                                           .to            = 50000,
+                                           .threads       = 4,
+                                           .chunk_records = 37});
+    EXPECT_EQ(result.records, 4901u);
+    EXPECT_EQ(result.bytes, std::filesystem::file_size(csv_path));
+
+    std::ifstream csv(csv_path);
+    std::string   line;
+    ASSERT_TRUE(std::getline(csv, line));
+    EXPECT_EQ(line, "a,timestamp,b");
+    int i = 100;
+    for (; std::getline(csv, line); ++i) {
+        TestData    expected{.timestamp = i * 10, .a = -i, .b = i * 0.5};
+        std::string text = std::to_string(expected.a) + "," + std::to_string(expected.timestamp);
+        char        b[32];
+        text += "," + std::string(b, std::to_chars(b, b + sizeof(b), expected.b).ptr);
+        ASSERT_EQ(line, text);
+    }
+    EXPECT_EQ(i, 5001);
+
+    result = utils::convertLogStruct(convert_log_path, columns_path,
+                                     {.format        = utils::LogStructConvertFormat::kColumns,
+                                      .fields        = {"timestamp", "b"},
+                                      .threads       = 3,
+                                      .chunk_records = 1000});
+    EXPECT_EQ(result.records, static_cast<std::size_t>(kRecords));
+    ASSERT_EQ(std::filesystem::file_size(columns_path + "/timestamp.bin"),
+              kRecords * sizeof(int64_t));
+    ASSERT_EQ(std::filesystem::file_size(columns_path + "/b.bin"), kRecords * sizeof(double));
+    std::vector<double> b(kRecords);
+    std::ifstream(columns_path + "/b.bin", std::ios::binary)
+        .read(reinterpret_cast<char*>(b.data()), kRecords * sizeof(double));
+    for (int j = 0; j < kRecords; ++j) {
+        ASSERT_EQ(b[j], j * 0.5);
+    }
+
+    EXPECT_THROW(utils::convertLogStruct(convert_log_path, csv_path, {.fields = {"missing"}}),
+                 std::invalid_argument);
+}
+
+// 聚合查询：按时间桶统计，跨块的桶由多个线程的部分结果合并；编码文件与未编码文件结果一致
+TEST(LogStructTest, Query) {
+    constexpr int     kRecords       = 200000;
+    const std::string query_log_path = "/tmp/test_query.log";
+
+    for (auto codec : {utils::LogStructCodec::kNone, utils::LogStructCodec::kDelta}) {
+        std::filesystem::remove(query_log_path);
+        std::filesystem::remove(query_log_path + utils::kLogStructIndexSuffix);
+        {
+            utils::LogStructT<TestData> log_struct(
+                query_log_path, 10000, 1000,
+                {.buffer_count = 4, .fields = kTestDataFields, .codec = codec});
+            for (int i = 0; i < kRecords; ++i) {
+                TestData test_data{};
+                test_data.timestamp = i * 10;
+                test_data.a         = i % 1000;
+                test_data.b         = i * 0.5;
+                while (!log_struct.write(test_data)) std::this_thread::yield();
+            }
+        }
+
+        utils::LogStructReader reader(query_log_path);
+        // 每个桶 100 条记录：第 k 个桶为 i ∈ [100k, 100k + 100)
+        auto result = utils::queryLogStruct(reader, {.fields      = {"b", "a"},
+                                                     .from        = 5000,
+                                                     .to          = 1504990,
+                                                     .bucket      = 1000,
+                                                     .percentiles = {0.5, 0.99},
+                                                     .threads     = 4});
+        ASSERT_EQ(result.fields, (std::vector<std::string>{"b", "a"}));
+        ASSERT_EQ(result.buckets.size(), 1500u);
+        for (std::size_t n = 0; n < result.buckets.size(); ++n) {
+            const auto& bucket = result.buckets[n];
+            auto        k      = static_cast<std::int64_t>(n + 5);
+            ASSERT_EQ(bucket.start, k * 1000);
+            ASSERT_EQ(bucket.count, 100u);
+            const auto& b = bucket.fields[0];
+            EXPECT_EQ(b.min, k * 50.0);
+            EXPECT_EQ(b.max, k * 50.0 + 49.5);
+            EXPECT_EQ(b.mean, k * 50.0 + 24.75);
+            ASSERT_EQ(b.percentiles, (std::vector<double>{k * 50.0 + 24.5, k * 50.0 + 49}));
+            const auto& a = bucket.fields[1];
+            EXPECT_EQ(a.min, static_cast<double>(k * 100 % 1000));
+            EXPECT_EQ(a.sum, static_cast<double>(k * 100 % 1000 * 100 + 4950));
+        }
+
+        auto total = utils::queryLogStruct(reader);
+        ASSERT_EQ(total.buckets.size(), 1u);
+        EXPECT_EQ(total.fields.size(), kTestDataFields.size() - 1);
+        EXPECT_EQ(total.buckets[0].count, static_cast<std::size_t>(kRecords));
+        EXPECT_EQ(total.buckets[0].fields[0].max, 999.0);
+        EXPECT_EQ(total.buckets[0].fields[1].sum, (kRecords - 1.0) * kRecords / 4);
+
+        EXPECT_THROW(utils::queryLogStruct(reader, {.fields = {"missing"}}),
+                     std::invalid_argument);
+    }
+}
+
+// 帧模式：多个生产者向同一个文件写入两种定长记录和变长记录，缓冲区很小时频繁出现帧越过缓冲区末尾
+struct FramedTick {
+    int64_t seq;
+    int32_t producer;
+    int32_t qty;
+    double  price;
+};
+
+struct FramedNote {
+    int32_t producer;
+    int32_t seq;
+};
+
+TEST(LogStructTest, Framed) {
+    constexpr std::uint32_t kTick      = 1;
+    constexpr std::uint32_t kNote      = 2;
+    constexpr std::uint32_t kText      = 3;
+    constexpr int           kProducers = 4;
+    constexpr int           kRecords   = 20000;
+
+    const std::string framed_log_path = "/tmp/test_framed.log";
+    std::filesystem::remove(framed_log_path);
+
+    const std::vector<utils::LogStructSchema> schemas = {
+        {kTick,
+         {UTILS_LOG_STRUCT_FIELD(FramedTick, seq), UTILS_LOG_STRUCT_FIELD(FramedTick, producer),
+          UTILS_LOG_STRUCT_FIELD(FramedTick, qty), UTILS_LOG_STRUCT_FIELD(FramedTick, price)}},
+        {kNote,
+         {UTILS_LOG_STRUCT_FIELD(FramedNote, producer), UTILS_LOG_STRUCT_FIELD(FramedNote, seq)}},
+    };
+    // 变长记录的内容：生产者编号、序号和 seq % 23 个重复字节
+    auto text = [](int producer, int seq) {
+        std::vector<std::byte> data(2 * sizeof(int32_t) + seq % 23, std::byte(seq));
+        std::memcpy(data.data(), &producer, sizeof(producer));
+        std::memcpy(data.data() + sizeof(producer), &seq, sizeof(seq));
+        return data;
+    };
+
+    std::atomic<std::size_t> accepted{0};
+    {
+        utils::LogStructFramed log_struct(framed_log_path, 4096, 1000, schemas,
+                                          {.producer_mode = utils::ProducerMode::kMulti,
+                                           .buffer_count  = 4,
+                                           .overflow      = utils::LogStructOverflow::kBlock});
+        std::vector<std::jthread> threads;
+        for (int p = 0; p < kProducers; ++p) {
+            threads.emplace_back([&, p]() {
+                std::size_t count = 0;
+                for (int i = 0; i < kRecords; ++i) {
+                    FramedTick& tick = log_struct.reserve<FramedTick>(kTick);
+                    tick.seq         = i;
+                    tick.producer    = p;
+                    tick.qty         = i % 100;
+                    tick.price       = i * 0.5;
+                    count += log_struct.commit(tick);
+                    count += log_struct.write(kNote, FramedNote{p, i});
+                    auto data = text(p, i);
+                    count += log_struct.write(kText, data.data(), data.size());
+                }
+                accepted.fetch_add(count);
+            });
+        }
+    }
+    EXPECT_EQ(accepted.load(), static_cast<std::size_t>(3 * kProducers * kRecords));
+
+    // 每个生产者的每种记录保持写入顺序
+    auto check = [&](std::size_t expected) {
+        utils::LogStructReader reader(framed_log_path);
+        EXPECT_TRUE(reader.framed());
+        EXPECT_EQ(reader.blockCount(), 0u);
+        EXPECT_EQ(reader.size(), expected);
+        EXPECT_THROW(reader.records<FramedTick>(), std::invalid_argument);
+
+        std::vector<std::vector<int>> last(3, std::vector<int>(kProducers, -1));
+        for (const auto& frame : reader.frames()) {
+            ASSERT_GE(frame.type, kTick);
+            ASSERT_LE(frame.type, kText);
+            int producer = 0;
+            int seq      = 0;
+            if (frame.type == kTick) {
+                const auto& tick = frame.as<FramedTick>();
+                producer         = tick.producer;
+                seq              = static_cast<int>(tick.seq);
+                EXPECT_EQ(tick.qty, seq % 100);
+                EXPECT_EQ(tick.price, seq * 0.5);
+            } else if (frame.type == kNote) {
+                const auto& note = frame.as<FramedNote>();
+                producer         = note.producer;
+                seq              = note.seq;
+            } else {
+                std::memcpy(&producer, frame.data, sizeof(producer));
+                std::memcpy(&seq, frame.data + sizeof(producer), sizeof(seq));
+                auto data = text(producer, seq);
+                ASSERT_EQ(frame.size, data.size());
+                EXPECT_EQ(std::memcmp(frame.data, data.data(), data.size()), 0);
+            }
+            ASSERT_GE(producer, 0);
+            ASSERT_LT(producer, kProducers);
+            EXPECT_GT(seq, last[frame.type - 1][producer]);
+            last[frame.type - 1][producer] = seq;
+        }
+    };
+    check(accepted.load());
+
+    // 模拟中途退出留下的半帧：重新打开时截掉后追加，文件头中的字段带有所属的记录类型
+    {
+        utils::LogStructFrameHeader torn{kText, 64};
+        std::ofstream(framed_log_path, std::ios::binary | std::ios::app)
+            .write(reinterpret_cast<const char*>(&torn), sizeof(torn));
+    }
+    {
+        utils::LogStructFramed log_struct(framed_log_path, 4096, 1000, schemas);
+        EXPECT_TRUE(log_struct.write(kNote, FramedNote{0, kRecords}));
+    }
+    check(accepted.load() + 1);
+    auto fields = utils::LogStructReader(framed_log_path).fields();
+    ASSERT_EQ(fields.size(), 6u);
+    EXPECT_EQ(fields[0].name, "seq");
+    EXPECT_EQ(fields[0].schema, kTick);
+    EXPECT_EQ(fields[3].schema, kTick);
+    EXPECT_EQ(fields[4].name, "producer");
+    EXPECT_EQ(fields[4].schema, kNote);
+
+    // mmap 后端：更新文件头时保留帧模式标志，重新打开后继续追加
+    std::filesystem::remove(framed_log_path);
+    for (int round = 0; round < 2; ++round) {
+        utils::LogStructFramed log_struct(framed_log_path, 0, 1000, schemas,
+                                          {.backend           = utils::LogStructBackend::kMmap,
+                                           .mmap_segment_size = std::size_t{1} << 20});
+        EXPECT_EQ(log_struct.stats().backend, utils::LogStructBackend::kMmap);
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_TRUE(log_struct.write(kNote, FramedNote{round, i}));
+            auto data = text(round, i);
+            EXPECT_TRUE(log_struct.write(kText, data.data(), data.size()));
+        }
+    }
+    {
+        utils::LogStructReader reader(framed_log_path);
+        EXPECT_TRUE(reader.framed());
+        EXPECT_EQ(reader.header().flags & utils::kLogStructFlagPreallocated, 0u);
+        EXPECT_EQ(reader.size(), 400u);
+    }
+
+    // 定长文件不能以帧模式打开
+    std::filesystem::remove(framed_log_path);
+    { utils::LogStruct log_struct(framed_log_path, sizeof(FramedNote), 16, 1000); }
+    EXPECT_THROW(utils::LogStructFramed(framed_log_path, 4096, 1000, schemas),
+                 std::runtime_error);
+}
+
+// 后端对比：相同负载下阻塞 write 与 io_uring 的耗时
+TEST(LogStructTest, BackendComparison) {
+    constexpr int kRecords = 1000000;
+
+    for (auto backend : {utils::LogStructBackend::kWrite, utils::LogStructBackend::kIoUring}) {
+        for (bool sync_after_batch : {false, true}) {
+            std::string backend_log_path = "/tmp/test_backend.log";
+            std::filesystem::remove(backend_log_path);
+
+            std::size_t           written_count  = 0;
+            utils::LogStructStats stats;
+            auto                  all_start_time = std::chrono::steady_clock::now();
+            {
+                utils::LogStructT<TestData> log_struct(backend_log_path, 4096, 10,
+                                                       {.buffer_count     = 8,
+                                                        .backend          = backend,
+                                                        .sync_after_batch = sync_after_batch});
+                for (int i = 0; i < kRecords; ++i) {
+                    TestData& test_data = log_struct.reserve();
+                    test_data.a         = i;
+                    if (log_struct.commit(test_data))
+                        ++written_count;
+                }
+                stats = log_struct.stats();
+            }
+            auto all_end_time = std::chrono::steady_clock::now();
+            std::cout << "backend: "
+                      << (stats.backend == utils::LogStructBackend::kIoUring ? "io_uring" : "write")
+                      << " sync_after_batch: " << sync_after_batch
+                      << " written: " << written_count << " all_time_count: "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(all_end_time -
+                                                                               all_start_time)
+                             .count()
+                      << std::endl;
+
+            EXPECT_EQ(stats.write_errors, 0u);
+            utils::LogStructReader reader(backend_log_path);
+            EXPECT_EQ(reader.size(), written_count);
+
+            // 记录顺序不受批量提交影响
+            int64_t last = -1;
+            for (const auto& test_data : reader.records<TestData>()) {
+                ASSERT_GT(test_data.a, last);
+                last = test_data.a;
+            }
+        }
+    }
+}
+
+// mmap 后端：多生产者直接写入映射段，析构后文件截断到已发布的尾部
+TEST(LogStructTest, MmapSegment) {
+    std::string mmap_log_path = "/tmp/test_mmap.log";
+    std::filesystem::remove(mmap_log_path);
+
+    constexpr int            kProducers          = 4;
+    constexpr int            kRecordsPerProducer = 100000;
+    std::atomic<std::size_t> written_count{0};
+    utils::LogStructStats    stats;
+    {
+        utils::LogStructT<TestData> log_struct(
+            mmap_log_path, 0, 100,
+            {.producer_mode     = utils::ProducerMode::kMulti,
+             .backend           = utils::LogStructBackend::kMmap,
+             .mmap_segment_size = sizeof(TestData) * kProducers * kRecordsPerProducer / 2});
+
+        std::vector<std::jthread> threads;
+        for (int p = 0; p < kProducers; ++p) {
+            threads.emplace_back([&, p]() {
+                std::size_t count = 0;
+                for (int i = 0; i < kRecordsPerProducer; ++i) {
+                    TestData& test_data = log_struct.reserve();
+                    test_data.a         = i;
+                    test_data.b         = p;
+                    if (log_struct.commit(test_data))
+                        ++count;
+                }
+                written_count.fetch_add(count);
+            });
+        }
+        threads.clear();
+        stats = log_struct.stats();
+    }
+
+    // 段大小只够一半的记录
+    EXPECT_EQ(stats.backend, utils::LogStructBackend::kMmap);
+    EXPECT_EQ(written_count.load(), kProducers * kRecordsPerProducer / 2);
+    EXPECT_EQ(stats.dropped_records, kProducers * kRecordsPerProducer / 2);
+    EXPECT_EQ(stats.failed_flushes, 0u);  // 段写满后的丢弃不算作切换失败
+
+    utils::LogStructReader reader(mmap_log_path);
+    EXPECT_EQ(reader.header().flags & utils::kLogStructFlagPreallocated, 0u);
+    EXPECT_EQ(reader.size(), written_count.load());
+    EXPECT_EQ(std::filesystem::file_size(mmap_log_path),
+              reader.header().header_size + written_count.load() * sizeof(TestData));
+
+    std::vector<int> last_index(kProducers, -1);
+    for (const auto& test_data : reader.records<TestData>()) {
+        auto p = static_cast<int>(test_data.b);
+        ASSERT_GE(p, 0);
+        ASSERT_LT(p, kProducers);
+        EXPECT_GT(test_data.a, last_index[p]);
+        last_index[p] = static_cast<int>(test_data.a);
+    }
 }
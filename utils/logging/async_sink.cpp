@@ -0,0 +1,169 @@
+#include "async_sink.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+namespace utils {
+namespace logging {
+namespace spdlog_log {
+
+namespace {
+
+// 后台线程上没有调用方可以接收异常，与 spdlog 默认的错误处理一样输出到 stderr
+void report_error(const std::exception& ex) {
+    std::fprintf(stderr, "[*** LOG ERROR ***] %s\n", ex.what());
+}
+
+}  // namespace
+
+AsyncSink::AsyncSink(std::vector<spdlog::sink_ptr> sinks, const AsyncOptions& options)
+    : sinks_(std::move(sinks)),
+      queue_size_(std::max<std::size_t>(options.queue_size, 1)),
+      overflow_policy_(options.overflow_policy),
+      flush_interval_(options.flush_interval) {
+    std::size_t worker_count = std::max<std::size_t>(options.worker_count, 1);
+    for (std::size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+AsyncSink::~AsyncSink() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (auto& worker : workers_) worker.join();
+    // 等待被唤醒的 kBlock 调用方写完，之后才能销毁 sink
+    {
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [this] { return stalled_callers_ == 0; });
+    }
+    flush_sinks();
+}
+
+void AsyncSink::log(const spdlog::details::log_msg& msg) {
+    std::unique_lock lock(mutex_);
+    if (queue_.size() >= queue_size_ && !stopping_) {
+        if (overflow_policy_ == AsyncOverflowPolicy::kBlock) {
+            ++stalled_callers_;
+            not_full_.wait(lock, [this] { return queue_.size() < queue_size_ || stopping_; });
+            --stalled_callers_;
+        } else {
+            queue_.pop_front();
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (stopping_) {
+        // 后台线程可能已经退出，不再入队，在调用线程上直接写出
+        ++stalled_callers_;
+        lock.unlock();
+        write_sinks(msg);
+        lock.lock();
+        --stalled_callers_;
+        done_.notify_all();
+        return;
+    }
+    queue_.emplace_back(msg);
+    ++posted_;
+    lock.unlock();
+    not_empty_.notify_one();
+}
+
+void AsyncSink::flush() {
+    {
+        std::lock_guard lock(mutex_);
+        flush_requested_ = true;
+    }
+    not_empty_.notify_one();
+}
+
+void AsyncSink::set_pattern(const std::string& pattern) {
+    for (auto& sink : sinks_) sink->set_pattern(pattern);
+}
+
+void AsyncSink::set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) {
+    for (auto& sink : sinks_) sink->set_formatter(sink_formatter->clone());
+}
+
+void AsyncSink::flush_sync() {
+    std::unique_lock lock(mutex_);
+    // 编号小于 target 的日志都已离开队列，且包含它们的批都已写完
+    std::uint64_t target = posted_;
+    done_.wait(lock, [&] {
+        return posted_ - queue_.size() >= target &&
+               std::all_of(in_flight_.begin(), in_flight_.end(),
+                           [&](std::uint64_t begin) { return begin >= target; });
+    });
+    lock.unlock();
+    flush_sinks();
+}
+
+void AsyncSink::write_sinks(const spdlog::details::log_msg& msg) {
+    for (auto& sink : sinks_) {
+        if (!sink->should_log(msg.level))
+            continue;
+        // 单个 sink 出错不影响其他 sink 和计数，否则 flush_sync 会一直等待
+        try {
+            sink->log(msg);
+        } catch (const std::exception& ex) {
+            report_error(ex);
+        }
+    }
+}
+
+void AsyncSink::flush_sinks() {
+    for (auto& sink : sinks_) {
+        try {
+            sink->flush();
+        } catch (const std::exception& ex) {
+            report_error(ex);
+        }
+    }
+}
+
+void AsyncSink::worker_loop() {
+    std::deque<spdlog::details::log_msg_buffer> batch;
+    bool                                        unflushed = false;
+    while (true) {
+        bool          flush_requested;
+        std::uint64_t begin;
+        {
+            std::unique_lock lock(mutex_);
+            // 有未刷新的写出时最迟 flush_interval 后醒来刷新
+            auto ready = [this] { return !queue_.empty() || flush_requested_ || stopping_; };
+            if (unflushed && flush_interval_.count() > 0)
+                not_empty_.wait_for(lock, flush_interval_, ready);
+            else if (!unflushed)
+                not_empty_.wait(lock, ready);
+            if (queue_.empty() && stopping_)
+                break;
+            // 一次取走整个队列，调用线程随即可以继续入队
+            begin = posted_ - queue_.size();
+            batch.swap(queue_);
+            flush_requested = std::exchange(flush_requested_, false);
+            if (!batch.empty())
+                in_flight_.push_back(begin);
+        }
+        not_full_.notify_all();
+
+        for (const auto& msg : batch) write_sinks(msg);
+        unflushed = unflushed || !batch.empty();
+        if (flush_requested || (unflushed && batch.empty()) || flush_interval_.count() == 0) {
+            flush_sinks();
+            unflushed = false;
+        }
+        if (!batch.empty()) {
+            batch.clear();
+            std::lock_guard lock(mutex_);
+            in_flight_.erase(std::find(in_flight_.begin(), in_flight_.end(), begin));
+            done_.notify_all();
+        }
+    }
+}
+
+}  // namespace spdlog_log
+}  // namespace logging
+}  // namespace utils
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <spdlog/details/log_msg_buffer.h>
+#include <spdlog/sinks/sink.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "logging.hpp"
+
+namespace utils {
+namespace logging {
+namespace spdlog_log {
+
+// 异步 sink：调用线程只把日志拷贝进有界队列，后台线程每次取走整个队列，
+// 逐条格式化并写入底层 sink，写出后按 flush_interval 或 flush() 的请求刷新。
+// 底层 sink 需要是线程安全的（*_mt），worker_count 大于 1 时会被并发调用
+class AsyncSink : public spdlog::sinks::sink {
+   public:
+    AsyncSink(std::vector<spdlog::sink_ptr> sinks, const AsyncOptions& options);
+    // 写完队列中剩余的日志后停止后台线程。停止期间到达的日志（包括 kBlock 下正在等待空间的）
+    // 在调用线程上直接写出
+    ~AsyncSink() override;
+
+    AsyncSink(const AsyncSink&)            = delete;
+    AsyncSink& operator=(const AsyncSink&) = delete;
+
+    void log(const spdlog::details::log_msg& msg) override;
+    // 请求后台线程刷新，不等待（logger 的 flush() 和 flush_on() 走这里）
+    void flush() override;
+    void set_pattern(const std::string& pattern) override;
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override;
+
+    // 同步屏障：等待调用前进入队列的日志全部写出，然后在调用线程上刷新底层 sink
+    void flush_sync();
+
+    // kOverwriteOldest 策略下被丢弃的日志条数
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+   private:
+    void worker_loop();
+    void write_sinks(const spdlog::details::log_msg& msg);
+    void flush_sinks();
+
+    std::vector<spdlog::sink_ptr> sinks_;
+    std::size_t                   queue_size_;
+    AsyncOverflowPolicy           overflow_policy_;
+    std::chrono::milliseconds     flush_interval_;
+
+    std::mutex                                 mutex_;
+    std::condition_variable                    not_empty_;  // 有新日志、刷新请求或停止
+    std::condition_variable                    not_full_;   // kBlock 策略下等待空间
+    std::condition_variable                    done_;       // 一批写完或直接写出的调用返回
+    std::deque<spdlog::details::log_msg_buffer> queue_;
+    bool                                       flush_requested_ = false;
+    bool                                       stopping_        = false;
+    // 正在等待空间或停止期间直接写出的 log() 调用数，析构函数等待其归零
+    std::size_t                                stalled_callers_ = 0;
+
+    // 日志按进入队列的顺序编号，队列中为 [posted_ - queue_.size(), posted_)；
+    // in_flight_ 为后台线程正在写的各批的起始编号。由 mutex_ 保护
+    std::uint64_t              posted_ = 0;
+    std::vector<std::uint64_t> in_flight_;
+    std::atomic<std::uint64_t> dropped_{0};
+
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace spdlog_log
+}  // namespace logging
+}  // namespace utils
@@ -0,0 +1,596 @@
+#include "deferred_log.hpp"
+
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/os.h>
+#include <spdlog/logger.h>
+#include <spdlog/pattern_formatter.h>
+#include <spdlog/sinks/sink.h>
+#if defined(SPDLOG_FMT_EXTERNAL)
+#include <fmt/args.h>
+#else
+#include <spdlog/fmt/bundled/args.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace utils {
+namespace logging {
+namespace spdlog_log {
+
+std::atomic<bool> g_deferred_enabled{false};
+
+namespace {
+
+using ArgStore = fmt::dynamic_format_arg_store<fmt::format_context>;
+
+// 没有新日志时也至少每隔这么久刷新一次输出
+constexpr auto kFlushInterval = std::chrono::seconds(1);
+
+std::int64_t system_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// 把 deferred_ticks() 换算为 Unix 纪元起的纳秒数。启动时对照 system_clock 校准约 10ms，
+// 之后后台线程每轮采样一次，用启动以来的整段区间估计 TSC 频率
+class TickClock {
+   public:
+    void calibrate() {
+#if UTILS_LOGGING_HAS_TSC
+        auto start       = std::chrono::steady_clock::now();
+        auto start_ticks = __rdtsc();
+        auto end         = start;
+        while (end - start < std::chrono::milliseconds(10)) {
+            end = std::chrono::steady_clock::now();
+        }
+        auto end_ticks = __rdtsc();
+        std::chrono::duration<double, std::nano> elapsed = end - start;
+
+        ns_per_tick_ = elapsed.count() / static_cast<double>(end_ticks - start_ticks);
+        base_ticks_  = __rdtsc();
+        base_ns_     = system_ns();
+        last_ticks_  = base_ticks_;
+        last_ns_     = base_ns_;
+#endif
+    }
+
+    void update() {
+#if UTILS_LOGGING_HAS_TSC
+        auto ticks = __rdtsc();
+        auto ns    = system_ns();
+        // 区间太短时误差大，沿用校准值
+        if (ns - base_ns_ > 100000000)
+            ns_per_tick_ =
+                static_cast<double>(ns - base_ns_) / static_cast<double>(ticks - base_ticks_);
+        last_ticks_ = ticks;
+        last_ns_    = ns;
+#endif
+    }
+
+    std::int64_t to_ns(std::uint64_t ticks) const {
+#if UTILS_LOGGING_HAS_TSC
+        // 记录可能早于最近一次采样，差值按有符号数计算
+        auto delta = static_cast<double>(static_cast<std::int64_t>(ticks - last_ticks_));
+        return last_ns_ + static_cast<std::int64_t>(delta * ns_per_tick_);
+#else
+        return static_cast<std::int64_t>(ticks);
+#endif
+    }
+
+   private:
+    std::uint64_t base_ticks_  = 0;
+    std::int64_t  base_ns_     = 0;
+    std::uint64_t last_ticks_  = 0;
+    std::int64_t  last_ns_     = 0;
+    double        ns_per_tick_ = 1;
+};
+
+// 带边界检查的顺序读取
+class ByteReader {
+   public:
+    ByteReader(const std::byte* data, std::size_t size) : data_(data), end_(data + size) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (static_cast<std::size_t>(end_ - data_) < sizeof(T))
+            return false;
+        std::memcpy(&value, data_, sizeof(T));
+        data_ += sizeof(T);
+        return true;
+    }
+
+    bool read_string(std::string_view& value) {
+        std::uint32_t size;
+        if (!read(size) || static_cast<std::size_t>(end_ - data_) < size)
+            return false;
+        value = std::string_view(reinterpret_cast<const char*>(data_), size);
+        data_ += size;
+        return true;
+    }
+
+    const std::byte* position() const { return data_; }
+
+   private:
+    const std::byte* data_;
+    const std::byte* end_;
+};
+
+// 按调用点的参数类型解码，store 为空时只跳过。字符串参数指向 payload 内部
+bool decode_args(const DeferredSite& site, ByteReader& reader, ArgStore* store) {
+    for (auto type : site.arg_types) {
+        bool ok = false;
+        switch (type) {
+            case DeferredArgType::kBool: {
+                std::uint8_t value;
+                if ((ok = reader.read(value)) && store)
+                    store->push_back(value != 0);
+                break;
+            }
+            case DeferredArgType::kChar: {
+                char value;
+                if ((ok = reader.read(value)) && store)
+                    store->push_back(value);
+                break;
+            }
+            case DeferredArgType::kInt64: {
+                std::int64_t value;
+                if ((ok = reader.read(value)) && store)
+                    store->push_back(value);
+                break;
+            }
+            case DeferredArgType::kUInt64: {
+                std::uint64_t value;
+                if ((ok = reader.read(value)) && store)
+                    store->push_back(value);
+                break;
+            }
+            case DeferredArgType::kFloat: {
+                float value;
+                if ((ok = reader.read(value)) && store)
+                    store->push_back(value);
+                break;
+            }
+            case DeferredArgType::kDouble: {
+                double value;
+                if ((ok = reader.read(value)) && store)
+                    store->push_back(value);
+                break;
+            }
+            case DeferredArgType::kPointer: {
+                std::uint64_t value;
+                if ((ok = reader.read(value)) && store)
+                    store->push_back(
+                        reinterpret_cast<const void*>(static_cast<std::uintptr_t>(value)));
+                break;
+            }
+            case DeferredArgType::kString: {
+                std::string_view value;
+                if ((ok = reader.read_string(value)) && store)
+                    store->push_back(value);
+                break;
+            }
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+// 还原一条日志的文本。参数不完整或格式化失败时输出错误说明，与 spdlog 格式化失败时的处理一致
+void format_message(const DeferredSite& site, const std::byte* payload, std::size_t size,
+                   ArgStore& store, fmt::memory_buffer& out) {
+    out.clear();
+    store.clear();
+    ByteReader       reader(payload, size);
+    std::string_view text;
+    if (site.preformatted) {
+        if (reader.read_string(text)) {
+            out.append(text);
+            return;
+        }
+    } else if (decode_args(site, reader, &store)) {
+        try {
+            fmt::vformat_to(std::back_inserter(out), site.format, store);
+            return;
+        } catch (const fmt::format_error& ex) {
+            out.clear();
+            fmt::format_to(std::back_inserter(out), "[*** LOG ERROR ***] {}: {}", ex.what(),
+                           site.format);
+            return;
+        }
+    }
+    fmt::format_to(std::back_inserter(out), "[*** LOG ERROR ***] truncated arguments: {}",
+                   site.format);
+}
+
+spdlog::details::log_msg make_log_msg(const DeferredSite& site, std::uint32_t thread_id,
+                                    std::int64_t ns, spdlog::string_view_t logger_name,
+                                    const fmt::memory_buffer& text) {
+    spdlog::details::log_msg msg(
+        spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(
+            std::chrono::nanoseconds(ns))),
+        spdlog::source_loc{site.file.c_str(), site.line, site.function.c_str()}, logger_name,
+        site.level, spdlog::string_view_t(text.data(), text.size()));
+    msg.thread_id = thread_id;
+    return msg;
+}
+
+template <typename T>
+void append_bytes(std::vector<std::byte>& out, const T& value) {
+    auto bytes = reinterpret_cast<const std::byte*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void append_string(std::vector<std::byte>& out, std::string_view value) {
+    append_bytes(out, static_cast<std::uint32_t>(value.size()));
+    auto bytes = reinterpret_cast<const std::byte*>(value.data());
+    out.insert(out.end(), bytes, bytes + value.size());
+}
+
+class DeferredBackend {
+   public:
+    // 环的所属线程可能在退出阶段仍在记录日志，实例不析构
+    static DeferredBackend& instance() {
+        static auto* backend = new DeferredBackend();
+        return *backend;
+    }
+
+    std::uint32_t register_site(DeferredSite site) {
+        std::lock_guard lock(sites_mutex_);
+        sites_.push_back(std::move(site));
+        return static_cast<std::uint32_t>(sites_.size() - 1);
+    }
+
+    std::shared_ptr<DeferredRing> create_ring() {
+        auto ring = std::make_shared<DeferredRing>(ring_bytes_.load(std::memory_order_relaxed),
+                                                   drop_when_full_.load(std::memory_order_relaxed));
+        std::lock_guard lock(rings_mutex_);
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void start(const DeferredOptions& options, const std::shared_ptr<spdlog::logger>& logger,
+               const std::string& binary_path) {
+        stop();
+        std::lock_guard lock(consume_mutex_);
+        output_      = options.output;
+        logger_name_ = logger ? logger->name() : std::string();
+        sinks_       = logger ? logger->sinks() : std::vector<spdlog::sink_ptr>();
+        if (output_ == DeferredOutput::kBinary) {
+            binary_ = std::fopen(binary_path.c_str(), "wb");
+            if (!binary_)
+                throw spdlog::spdlog_ex("Failed opening file " + binary_path + " for writing",
+                                        errno);
+            std::setvbuf(binary_, nullptr, _IOFBF, 1 << 20);
+            std::fwrite(kDeferredLogMagic, 1, sizeof(kDeferredLogMagic), binary_);
+            site_written_.clear();
+        }
+        ring_bytes_.store(std::bit_ceil(std::max<std::size_t>(options.ring_bytes, 4096)),
+                          std::memory_order_relaxed);
+        drop_when_full_.store(options.drop_when_full, std::memory_order_relaxed);
+        poll_interval_ = std::max(options.poll_interval, std::chrono::milliseconds(1));
+        clock_.calibrate();
+        last_flush_ = std::chrono::steady_clock::now();
+        thread_     = std::jthread([this](std::stop_token stop) { run(stop); });
+        g_deferred_enabled.store(true, std::memory_order_relaxed);
+
+        // 正常退出时写完环中剩余的日志
+        static std::once_flag at_exit;
+        std::call_once(at_exit, [] { std::atexit([] { instance().stop(); }); });
+    }
+
+    void stop() {
+        g_deferred_enabled.store(false, std::memory_order_relaxed);
+        if (thread_.joinable()) {
+            thread_.request_stop();
+            thread_.join();
+        }
+        std::lock_guard lock(consume_mutex_);
+        drain();
+        flush_output();
+        if (binary_) {
+            std::fclose(binary_);
+            binary_ = nullptr;
+        }
+        sinks_.clear();
+    }
+
+    void flush() {
+        std::lock_guard lock(consume_mutex_);
+        clock_.update();
+        drain();
+        flush_output();
+    }
+
+    void wake() {
+        if (wake_.exchange(true, std::memory_order_acq_rel))
+            return;
+        // 加锁后通知，避免后台线程检查完条件、尚未进入等待时丢失唤醒
+        { std::lock_guard lock(wait_mutex_); }
+        wait_.notify_one();
+    }
+
+    std::uint64_t dropped() {
+        std::lock_guard lock(rings_mutex_);
+        std::uint64_t   total = retired_dropped_;
+        for (const auto& ring : rings_) total += ring->dropped();
+        return total;
+    }
+
+   private:
+    DeferredBackend() = default;
+
+    void run(std::stop_token stop) {
+        while (!stop.stop_requested()) {
+            {
+                std::unique_lock lock(wait_mutex_);
+                wait_.wait_for(lock, stop, poll_interval_,
+                               [this] { return wake_.exchange(false, std::memory_order_acq_rel); });
+            }
+            std::lock_guard lock(consume_mutex_);
+            clock_.update();
+            if (drain() > 0)
+                unflushed_ = true;
+            if (unflushed_ && std::chrono::steady_clock::now() - last_flush_ >= kFlushInterval)
+                flush_output();
+        }
+    }
+
+    // 取空所有环，返回处理的条数。调用方持有 consume_mutex_
+    std::size_t drain() {
+        std::vector<std::shared_ptr<DeferredRing>> rings;
+        {
+            std::lock_guard lock(rings_mutex_);
+            rings = rings_;
+        }
+        std::size_t count = 0;
+        for (const auto& ring : rings) {
+            // 先读退出标记：线程退出前提交的记录在这一轮一定能取到
+            bool retired = ring->retired();
+            count += ring->consume([&](const DeferredRecordHeader& header, const std::byte* payload,
+                                       std::size_t size) { output(*ring, header, payload, size); });
+            if (retired) {
+                std::lock_guard lock(rings_mutex_);
+                retired_dropped_ += ring->dropped();
+                rings_.erase(std::find(rings_.begin(), rings_.end(), ring));
+            }
+        }
+        return count;
+    }
+
+    const DeferredSite* find_site(std::uint32_t id) {
+        if (id >= site_cache_.size()) {
+            std::lock_guard lock(sites_mutex_);
+            for (std::size_t i = site_cache_.size(); i < sites_.size(); ++i)
+                site_cache_.push_back(&sites_[i]);
+        }
+        return id < site_cache_.size() ? site_cache_[id] : nullptr;
+    }
+
+    void output(const DeferredRing& ring, const DeferredRecordHeader& header,
+                const std::byte* payload, std::size_t size) {
+        const DeferredSite* site = find_site(header.site);
+        if (!site)
+            return;
+        std::int64_t ns = clock_.to_ns(header.ticks);
+        if (output_ == DeferredOutput::kBinary) {
+            write_binary(header.site, *site, ring.thread_id(), ns, payload, size);
+            return;
+        }
+        format_message(*site, payload, size, store_, text_);
+        auto msg = make_log_msg(*site, ring.thread_id(), ns, logger_name_, text_);
+        for (auto& sink : sinks_) {
+            if (!sink->should_log(msg.level))
+                continue;
+            try {
+                sink->log(msg);
+            } catch (const std::exception& ex) {
+                std::fprintf(stderr, "[*** LOG ERROR ***] %s\n", ex.what());
+            }
+        }
+    }
+
+    void write_binary(std::uint32_t id, const DeferredSite& site, std::uint32_t thread_id,
+                     std::int64_t ns, const std::byte* payload, std::size_t size) {
+        entry_.clear();
+        if (id >= site_written_.size())
+            site_written_.resize(id + 1, false);
+        if (!site_written_[id]) {
+            site_written_[id] = true;
+            append_bytes(entry_, DeferredEntry::kSite);
+            append_bytes(entry_, id);
+            append_bytes(entry_, static_cast<std::uint8_t>(site.level));
+            append_bytes(entry_, static_cast<std::uint8_t>(site.preformatted));
+            append_bytes(entry_, static_cast<std::int32_t>(site.line));
+            append_bytes(entry_, static_cast<std::uint16_t>(site.arg_types.size()));
+            for (auto type : site.arg_types) append_bytes(entry_, type);
+            append_string(entry_, site.format);
+            append_string(entry_, site.file);
+            append_string(entry_, site.function);
+        }
+        // 去掉记录末尾的对齐填充
+        ByteReader reader(payload, size);
+        decode_args(site, reader, nullptr);
+        auto used = static_cast<std::uint32_t>(reader.position() - payload);
+
+        append_bytes(entry_, DeferredEntry::kRecord);
+        append_bytes(entry_, id);
+        append_bytes(entry_, thread_id);
+        append_bytes(entry_, ns);
+        append_bytes(entry_, used);
+        entry_.insert(entry_.end(), payload, payload + used);
+        std::fwrite(entry_.data(), 1, entry_.size(), binary_);
+    }
+
+    void flush_output() {
+        for (auto& sink : sinks_) {
+            try {
+                sink->flush();
+            } catch (const std::exception& ex) {
+                std::fprintf(stderr, "[*** LOG ERROR ***] %s\n", ex.what());
+            }
+        }
+        if (binary_)
+            std::fflush(binary_);
+        unflushed_  = false;
+        last_flush_ = std::chrono::steady_clock::now();
+    }
+
+    std::mutex               sites_mutex_;
+    std::deque<DeferredSite> sites_;  // deque 保证已注册调用点的地址不变
+
+    std::mutex                                 rings_mutex_;
+    std::vector<std::shared_ptr<DeferredRing>> rings_;
+    std::uint64_t                              retired_dropped_ = 0;
+    std::atomic<std::size_t>                   ring_bytes_{1 << 20};
+    std::atomic<bool>                          drop_when_full_{false};
+    std::mutex                                 wait_mutex_;
+    std::condition_variable_any                wait_;
+    std::atomic<bool>                          wake_{false};
+
+    // 以下由 consume_mutex_ 保护
+    std::mutex                                consume_mutex_;
+    DeferredOutput                            output_ = DeferredOutput::kText;
+    std::string                               logger_name_;
+    std::vector<spdlog::sink_ptr>             sinks_;
+    std::FILE*                                binary_ = nullptr;
+    std::vector<bool>                         site_written_;
+    std::vector<const DeferredSite*>          site_cache_;
+    TickClock                                 clock_;
+    ArgStore                                  store_;
+    fmt::memory_buffer                        text_;
+    std::vector<std::byte>                    entry_;
+    bool                                      unflushed_ = false;
+    std::chrono::steady_clock::time_point     last_flush_;
+    std::chrono::milliseconds                 poll_interval_{1};
+    std::jthread                              thread_;
+};
+
+}  // namespace
+
+DeferredRing::DeferredRing(std::size_t capacity, bool drop_when_full)
+    : capacity_(capacity),
+      mask_(capacity - 1),
+      drop_when_full_(drop_when_full),
+      thread_id_(static_cast<std::uint32_t>(spdlog::details::os::thread_id())),
+      data_(std::make_unique<std::byte[]>(capacity)) {}
+
+std::uint32_t register_deferred_site(DeferredSite site) {
+    return DeferredBackend::instance().register_site(std::move(site));
+}
+
+std::shared_ptr<DeferredRing> create_deferred_ring() {
+    return DeferredBackend::instance().create_ring();
+}
+
+void wake_deferred_backend() {
+    DeferredBackend::instance().wake();
+}
+
+void start_deferred_logging(const DeferredOptions&                 options,
+                            const std::shared_ptr<spdlog::logger>& logger,
+                            const std::string&                     binary_path) {
+    DeferredBackend::instance().start(options, logger, binary_path);
+}
+
+void stop_deferred_logging() {
+    DeferredBackend::instance().stop();
+}
+
+void flush_deferred_logging() {
+    DeferredBackend::instance().flush();
+}
+
+std::uint64_t deferred_dropped() {
+    return DeferredBackend::instance().dropped();
+}
+
+std::size_t decode_deferred_log(const std::string& path, std::ostream& out,
+                                const std::string& pattern) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("cannot open " + path);
+    char magic[sizeof(kDeferredLogMagic)];
+    if (!in.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, kDeferredLogMagic, sizeof(magic)) != 0)
+        throw std::runtime_error(path + " is not a deferred log file");
+
+    auto read = [&](auto& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    };
+    auto read_string = [&](std::string& value) {
+        std::uint32_t size;
+        if (!read(size))
+            return false;
+        value.resize(size);
+        return static_cast<bool>(in.read(value.data(), size));
+    };
+
+    spdlog::pattern_formatter                        formatter(pattern);
+    std::unordered_map<std::uint32_t, DeferredSite>  sites;
+    std::vector<std::byte>                           payload;
+    ArgStore                                         store;
+    fmt::memory_buffer                               text;
+    spdlog::memory_buf_t                             line;
+    std::size_t                                      count = 0;
+    DeferredEntry                                    entry;
+    while (read(entry)) {
+        if (entry == DeferredEntry::kSite) {
+            std::uint32_t id;
+            std::uint8_t  level;
+            std::uint8_t  preformatted;
+            std::int32_t  line_number;
+            std::uint16_t arg_count;
+            DeferredSite  site;
+            if (!read(id) || !read(level) || !read(preformatted) || !read(line_number) ||
+                !read(arg_count))
+                break;
+            site.level        = static_cast<spdlog::level::level_enum>(level);
+            site.preformatted = preformatted != 0;
+            site.line         = line_number;
+            site.arg_types.resize(arg_count);
+            if (!in.read(reinterpret_cast<char*>(site.arg_types.data()), arg_count) ||
+                !read_string(site.format) || !read_string(site.file) || !read_string(site.function))
+                break;
+            sites[id] = std::move(site);
+        } else if (entry == DeferredEntry::kRecord) {
+            std::uint32_t id;
+            std::uint32_t thread_id;
+            std::int64_t  ns;
+            std::uint32_t size;
+            if (!read(id) || !read(thread_id) || !read(ns) || !read(size))
+                break;
+            payload.resize(size);
+            if (!in.read(reinterpret_cast<char*>(payload.data()), size))
+                break;
+            auto it = sites.find(id);
+            if (it == sites.end())
+                throw std::runtime_error("record refers to unknown call site " +
+                                         std::to_string(id));
+            format_message(it->second, payload.data(), payload.size(), store, text);
+            line.clear();
+            formatter.format(make_log_msg(it->second, thread_id, ns, "", text), line);
+            out.write(line.data(), static_cast<std::streamsize>(line.size()));
+            ++count;
+        } else {
+            throw std::runtime_error("unknown entry type " +
+                                     std::to_string(static_cast<int>(entry)) + " in " + path);
+        }
+    }
+    return count;
+}
+
+}  // namespace spdlog_log
+}  // namespace logging
+}  // namespace utils
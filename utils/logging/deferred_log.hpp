@@ -0,0 +1,389 @@
+#pragma once
+
+#include <spdlog/common.h>
+#include <spdlog/logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UTILS_LOGGING_HAS_TSC 1
+#else
+#define UTILS_LOGGING_HAS_TSC 0
+#endif
+
+// 延迟格式化后端（NanoLog 风格）：UTILS_LOG_* 在调用线程只把调用点 id、时间戳和参数的原始字节
+// 写入本线程的环形缓冲区。格式化由后台线程完成（kText），或者由后台线程写出紧凑的二进制文件，
+// 再用 deferred_log_decode 离线还原（kBinary）
+
+namespace utils {
+namespace logging {
+namespace spdlog_log {
+
+// 延迟格式化模式的输出方式
+enum class DeferredOutput {
+    kText,    // 后台线程格式化后写入文件和控制台 sink
+    kBinary,  // 后台线程写出二进制文件 <log_name>.bin，不格式化
+};
+
+struct DeferredOptions {
+    DeferredOutput output     = DeferredOutput::kText;
+    std::size_t    ring_bytes = 1 << 20;  // 每个线程的环形缓冲区大小，向上取整到 2 的幂
+    // 环满时丢弃新日志；否则调用线程等待后台线程腾出空间
+    bool                      drop_when_full = false;
+    std::chrono::milliseconds poll_interval{1};  // 后台线程没有被唤醒时的轮询间隔
+};
+
+// 二进制文件以 kDeferredLogMagic 开始，之后是一串条目，每个条目以一个字节的 DeferredEntry 开头
+inline constexpr char          kDeferredLogMagic[8] = {'U', 'T', 'L', 'D', 'L', 'O', 'G', '1'};
+inline constexpr char          kDeferredLogSuffix[] = ".bin";
+inline constexpr std::uint32_t kDeferredPadding     = 0xffffffff;
+
+enum class DeferredEntry : std::uint8_t {
+    // u32 id, u8 level, u8 preformatted, i32 line, u16 参数个数, 各参数的 DeferredArgType,
+    // 然后 format、file、function 各为 u32 长度 + 字节。调用点在第一条记录之前写出
+    kSite = 1,
+    // u32 site, u32 thread_id, i64 Unix 纪元起的纳秒数, u32 参数字节数, 参数
+    kRecord = 2,
+};
+
+// 参数在环形缓冲区和二进制文件中的编码。整数统一扩展为 64 位，字符串为 u32 长度 + 字节
+enum class DeferredArgType : std::uint8_t {
+    kBool,
+    kChar,
+    kInt64,
+    kUInt64,
+    kFloat,
+    kDouble,
+    kPointer,
+    kString,
+};
+
+// 调用点的静态信息，每个调用点第一次执行时注册一次
+struct DeferredSite {
+    spdlog::level::level_enum    level;
+    std::string                  format;
+    std::string                  file;
+    int                          line;
+    std::string                  function;
+    std::vector<DeferredArgType> arg_types;
+    // 参数中有无法编码的类型：调用线程已把整条日志格式化为一个字符串参数
+    bool preformatted = false;
+};
+
+// 返回调用点 id，线程安全
+std::uint32_t register_deferred_site(DeferredSite site);
+
+// 环形缓冲区中每条记录的头部，记录按 8 字节对齐
+struct DeferredRecordHeader {
+    std::uint32_t site;   // kDeferredPadding 表示环尾放不下记录时的填充
+    std::uint32_t size;   // 含头部
+    std::uint64_t ticks;  // deferred_ticks()，由后台线程换算为系统时间
+};
+
+// 时间戳：有 TSC 时为 rdtsc，否则为 system_clock 的纳秒数
+inline std::uint64_t deferred_ticks() {
+#if UTILS_LOGGING_HAS_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// 环满时唤醒后台线程立即取空，不必等到下一次轮询
+void wake_deferred_backend();
+
+// 延迟格式化模式是否开启，由 init_deferred_logging / init_logging 切换
+extern std::atomic<bool> g_deferred_enabled;
+
+inline bool deferred_logging_enabled() {
+    return g_deferred_enabled.load(std::memory_order_relaxed);
+}
+
+// 单生产者单消费者的字节环，生产者是所属线程，消费者是后台线程
+class DeferredRing {
+   public:
+    DeferredRing(std::size_t capacity, bool drop_when_full);
+
+    DeferredRing(const DeferredRing&)            = delete;
+    DeferredRing& operator=(const DeferredRing&) = delete;
+
+    // 预留 size（8 的倍数）字节的连续空间。环满且 drop_when_full，或者后台线程已经停止时
+    // 返回 nullptr
+    std::byte* reserve(std::size_t size) {
+        std::uint64_t head       = head_.load(std::memory_order_relaxed);
+        std::size_t   contiguous = capacity_ - (head & mask_);
+        std::size_t   needed     = contiguous < size ? contiguous + size : size;
+        if (needed > capacity_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        for (bool woken = false; head + needed - cached_tail_ > capacity_;) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head + needed - cached_tail_ <= capacity_)
+                break;
+            // 调用方通过开启检查之后后台线程才停止：没有人再取空环，不能继续等待
+            if (drop_when_full_ || !deferred_logging_enabled()) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            if (!std::exchange(woken, true))
+                wake_deferred_backend();
+            std::this_thread::yield();
+        }
+        if (contiguous < size) {
+            // 环尾放不下整条记录，写一个填充头后从环首开始，与记录一起发布
+            DeferredRecordHeader padding{kDeferredPadding, static_cast<std::uint32_t>(contiguous),
+                                         0};
+            std::memcpy(data_.get() + (head & mask_), &padding, sizeof(std::uint32_t) * 2);
+            head += contiguous;
+        }
+        reserved_ = head;
+        return data_.get() + (head & mask_);
+    }
+
+    // 发布 reserve 返回的记录
+    void commit(std::size_t size) { head_.store(reserved_ + size, std::memory_order_release); }
+
+    // 消费者：依次处理已发布的记录，返回处理的条数
+    template <typename F>
+    std::size_t consume(F&& f) {
+        std::uint64_t head  = head_.load(std::memory_order_acquire);
+        std::uint64_t tail  = tail_.load(std::memory_order_relaxed);
+        std::size_t   count = 0;
+        while (tail < head) {
+            DeferredRecordHeader header;
+            const std::byte*     record = data_.get() + (tail & mask_);
+            std::memcpy(&header, record, sizeof(std::uint32_t) * 2);
+            if (header.site != kDeferredPadding) {
+                std::memcpy(&header.ticks, record + sizeof(std::uint32_t) * 2,
+                            sizeof(header.ticks));
+                f(header, record + sizeof(header), header.size - sizeof(header));
+                ++count;
+            }
+            tail += header.size;
+        }
+        tail_.store(tail, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+    }
+
+    // 所属线程退出后由后台线程在取空后移除
+    void retire() { retired_.store(true, std::memory_order_release); }
+    bool retired() const { return retired_.load(std::memory_order_acquire); }
+
+    std::uint32_t thread_id() const { return thread_id_; }
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+   private:
+    std::size_t                  capacity_;
+    std::size_t                  mask_;
+    bool                         drop_when_full_;
+    std::uint32_t                thread_id_;
+    std::unique_ptr<std::byte[]> data_;
+
+    alignas(64) std::atomic<std::uint64_t> head_{0};
+    std::uint64_t reserved_    = 0;  // 生产者私有
+    std::uint64_t cached_tail_ = 0;  // 生产者私有
+    alignas(64) std::atomic<std::uint64_t> tail_{0};
+    std::atomic<bool>          retired_{false};
+    std::atomic<std::uint64_t> dropped_{0};
+};
+
+// 为当前线程创建环并登记给后台线程
+std::shared_ptr<DeferredRing> create_deferred_ring();
+
+// 当前线程的环，线程退出时交还给后台线程
+inline DeferredRing& deferred_thread_ring() {
+    struct Handle {
+        std::shared_ptr<DeferredRing> ring;
+        ~Handle() {
+            if (ring)
+                ring->retire();
+        }
+    };
+    thread_local Handle handle;
+    if (!handle.ring) [[unlikely]]
+        handle.ring = create_deferred_ring();
+    return *handle.ring;
+}
+
+// 启动后台线程。kText 写入 logger 的 sink，kBinary 写入 binary_path，
+// 打开失败时抛出 spdlog::spdlog_ex
+void start_deferred_logging(const DeferredOptions&                 options,
+                            const std::shared_ptr<spdlog::logger>& logger,
+                            const std::string&                     binary_path);
+// 写完所有环中的日志后停止后台线程，之后 UTILS_LOG_* 回到 spdlog 的同步路径
+void stop_deferred_logging();
+// 同步屏障：在调用线程上取空所有环并刷新输出
+void flush_deferred_logging();
+// 因环满、记录过大或后台线程已停止而被丢弃的日志条数
+std::uint64_t deferred_dropped();
+
+// 把二进制文件还原为文本，每条日志按 pattern 格式化为一行，返回日志条数。
+// 文件格式错误时抛出 std::runtime_error，末尾被截断的条目忽略
+std::size_t decode_deferred_log(const std::string& path, std::ostream& out,
+                                const std::string& pattern);
+
+namespace detail {
+
+template <typename T>
+inline constexpr bool kDeferredString =
+    std::is_same_v<T, const char*> || std::is_same_v<T, char*> || std::is_same_v<T, std::string> ||
+    std::is_same_v<T, std::string_view>;
+
+template <typename T>
+inline constexpr bool kDeferredPointer = std::is_same_v<T, const void*> ||
+                                         std::is_same_v<T, void*> ||
+                                         std::is_same_v<T, std::nullptr_t>;
+
+// 与 fmt 的参数映射一致：signed/unsigned char 按整数格式化，其他字符类型不编码
+template <typename T>
+inline constexpr bool kDeferredInteger =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char> &&
+    !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+    !std::is_same_v<T, char32_t> && sizeof(T) <= 8;
+
+template <typename T>
+inline constexpr bool kDeferredEncodable =
+    std::is_same_v<T, bool> || std::is_same_v<T, char> || kDeferredInteger<T> ||
+    std::is_same_v<T, float> || std::is_same_v<T, double> || kDeferredPointer<T> ||
+    kDeferredString<T>;
+
+template <typename T>
+constexpr DeferredArgType deferred_arg_type() {
+    if constexpr (std::is_same_v<T, bool>)
+        return DeferredArgType::kBool;
+    else if constexpr (std::is_same_v<T, char>)
+        return DeferredArgType::kChar;
+    else if constexpr (kDeferredInteger<T> && std::is_signed_v<T>)
+        return DeferredArgType::kInt64;
+    else if constexpr (kDeferredInteger<T>)
+        return DeferredArgType::kUInt64;
+    else if constexpr (std::is_same_v<T, float>)
+        return DeferredArgType::kFloat;
+    else if constexpr (std::is_same_v<T, double>)
+        return DeferredArgType::kDouble;
+    else if constexpr (kDeferredPointer<T>)
+        return DeferredArgType::kPointer;
+    else
+        return DeferredArgType::kString;
+}
+
+// 空指针按空字符串记录
+template <typename T>
+std::string_view deferred_string(const T& value) {
+    if constexpr (std::is_pointer_v<T>)
+        return value ? std::string_view(value) : std::string_view();
+    else
+        return std::string_view(value);
+}
+
+template <typename T>
+std::size_t deferred_arg_size(const T& value) {
+    using D = std::decay_t<T>;
+    if constexpr (kDeferredString<D>)
+        return sizeof(std::uint32_t) + deferred_string(value).size();
+    else if constexpr (std::is_same_v<D, bool> || std::is_same_v<D, char>)
+        return 1;
+    else if constexpr (std::is_same_v<D, float>)
+        return sizeof(float);
+    else
+        return 8;
+}
+
+template <typename T>
+std::byte* encode_deferred_arg(std::byte* out, const T& value) {
+    using D = std::decay_t<T>;
+    if constexpr (kDeferredString<D>) {
+        auto          str  = deferred_string(value);
+        std::uint32_t size = static_cast<std::uint32_t>(str.size());
+        std::memcpy(out, &size, sizeof(size));
+        std::memcpy(out + sizeof(size), str.data(), str.size());
+        return out + sizeof(size) + str.size();
+    } else if constexpr (std::is_same_v<D, bool> || std::is_same_v<D, char>) {
+        *out = static_cast<std::byte>(value);
+        return out + 1;
+    } else if constexpr (std::is_same_v<D, float> || std::is_same_v<D, double>) {
+        std::memcpy(out, &value, sizeof(D));
+        return out + sizeof(D);
+    } else if constexpr (kDeferredPointer<D>) {
+        auto address = reinterpret_cast<std::uintptr_t>(static_cast<const void*>(value));
+        std::uint64_t encoded = address;
+        std::memcpy(out, &encoded, sizeof(encoded));
+        return out + sizeof(encoded);
+    } else {
+        std::conditional_t<std::is_signed_v<D>, std::int64_t, std::uint64_t> encoded = value;
+        std::memcpy(out, &encoded, sizeof(encoded));
+        return out + sizeof(encoded);
+    }
+}
+
+template <typename... Args>
+void write_deferred_record(std::uint32_t site, const Args&... args) {
+    std::size_t payload = (std::size_t{0} + ... + deferred_arg_size(args));
+    std::size_t size    = (sizeof(DeferredRecordHeader) + payload + 7) & ~std::size_t{7};
+
+    DeferredRing& ring   = deferred_thread_ring();
+    std::byte*    record = ring.reserve(size);
+    if (!record)
+        return;
+    DeferredRecordHeader header{site, static_cast<std::uint32_t>(size), deferred_ticks()};
+    std::memcpy(record, &header, sizeof(header));
+    [[maybe_unused]] std::byte* out = record + sizeof(header);
+    ((out = encode_deferred_arg(out, args)), ...);
+    ring.commit(size);
+}
+
+}  // namespace detail
+
+// UTILS_LOG_* 在延迟格式化模式下的入口。Site 是调用点处定义的局部类型，
+// 每个调用点对应一个实例化，调用点 id 保存在其中的静态变量里
+template <typename Site, typename... Args>
+void deferred_log(spdlog::level::level_enum level, const spdlog::source_loc& loc,
+                  spdlog::format_string_t<Args...> fmt, Args&&... args) {
+    constexpr bool kEncodable = (detail::kDeferredEncodable<std::decay_t<Args>> && ...);
+
+    static const std::uint32_t site = register_deferred_site(DeferredSite{
+        .level        = level,
+        .format       = std::string(spdlog::string_view_t(fmt).data(),
+                                    spdlog::string_view_t(fmt).size()),
+        .file         = loc.filename ? loc.filename : "",
+        .line         = loc.line,
+        .function     = loc.funcname ? loc.funcname : "",
+        .arg_types    = kEncodable ? std::vector<DeferredArgType>{detail::deferred_arg_type<
+                                         std::decay_t<Args>>()...}
+                                   : std::vector<DeferredArgType>{DeferredArgType::kString},
+        .preformatted = !kEncodable});
+
+    if constexpr (kEncodable) {
+        detail::write_deferred_record(site, args...);
+    } else {
+        // 自定义类型等无法按字节记录的参数：在调用线程格式化，整条作为一个字符串参数
+        fmt::memory_buffer buffer;
+        fmt::format_to(std::back_inserter(buffer), fmt, std::forward<Args>(args)...);
+        detail::write_deferred_record(site, std::string_view(buffer.data(), buffer.size()));
+    }
+}
+
+}  // namespace spdlog_log
+}  // namespace logging
+}  // namespace utils
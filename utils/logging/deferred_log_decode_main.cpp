@@ -0,0 +1,39 @@
+#include <CLI/CLI.hpp>
+#include <fstream>
+#include <iostream>
+
+#include "logging.hpp"
+
+// 用法：deferred_log_decode app.log.bin > app.txt
+//      deferred_log_decode app.log.bin -o app.txt --pattern "%H:%M:%S.%f %l %v"
+int main(int argc, char** argv) {
+    CLI::App app{"Decode a binary log written by init_deferred_logging in kBinary mode"};
+
+    std::string input;
+    std::string output;
+    std::string pattern = utils::logging::spdlog_log::kDefaultLogPattern;
+
+    app.add_option("input", input, "Binary log file")->required()->check(CLI::ExistingFile);
+    app.add_option("-o,--output", output, "Text file, stdout by default");
+    app.add_option("-p,--pattern", pattern, "spdlog pattern for each line");
+    CLI11_PARSE(app, argc, argv);
+
+    try {
+        std::ofstream file;
+        if (!output.empty()) {
+            file.open(output);
+            if (!file) {
+                std::cerr << "cannot open " << output << std::endl;
+                return 1;
+            }
+        }
+        std::ostream& out = output.empty() ? std::cout : file;
+        auto count = utils::logging::spdlog_log::decode_deferred_log(input, out, pattern);
+        out.flush();
+        std::cerr << count << " records" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
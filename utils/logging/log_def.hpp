@@ -5,10 +5,26 @@
 #define UTILS_LOG_INIT(log_name, log_level) \
     utils::logging::spdlog_log::init_logging(log_name, log_level);
 
+// 异步模式，async_options 为 utils::logging::spdlog_log::AsyncOptions
+#define UTILS_LOG_INIT_ASYNC(log_name, log_level, async_options) \
+    utils::logging::spdlog_log::init_logging(log_name, log_level, async_options);
+
+// 延迟格式化模式，options 为 utils::logging::spdlog_log::DeferredOptions
+#define UTILS_LOG_INIT_DEFERRED(log_name, log_level, options) \
+    utils::logging::spdlog_log::init_deferred_logging(log_name, log_level, options);
+
 #define UTILS_LOG_FLUSH() utils::logging::spdlog_log::flush_logging();
 
+// 运行期修改模块级别，level 为级别字符串，如 "debug"
+#define UTILS_LOG_SET_MODULE_LEVEL(module, level) \
+    utils::logging::spdlog_log::set_module_level(module, level);
+
+// 监视模块级别配置文件，文件格式见 module_logger.hpp
+#define UTILS_LOG_WATCH_MODULE_LEVELS(path) utils::logging::spdlog_log::watch_module_levels(path);
+
 // 格式化字符串风格的日志宏（保留兼容性）
 // 用法: UTILS_LOG_TRACE("message {}", value)
+// 格式串在编译期检查；级别未开启时不求值参数，低于 UTILS_LOG_ACTIVE_LEVEL 时整条移除
 #define UTILS_LOG_TRACE(fmt, ...) UTILS_SPDLOG_LOG_TRACE(fmt, ##__VA_ARGS__)
 #define UTILS_LOG_DEBUG(fmt, ...) UTILS_SPDLOG_LOG_DEBUG(fmt, ##__VA_ARGS__)
 #define UTILS_LOG_INFO(fmt, ...) UTILS_SPDLOG_LOG_INFO(fmt, ##__VA_ARGS__)
@@ -16,23 +32,60 @@
 #define UTILS_LOG_ERROR(fmt, ...) UTILS_SPDLOG_LOG_ERROR(fmt, ##__VA_ARGS__)
 #define UTILS_LOG_FATAL(fmt, ...) UTILS_SPDLOG_LOG_FATAL(fmt, ##__VA_ARGS__)
 
-// 流式日志宏 - 返回临时 LogStream 对象，支持 << 操作符
+// 流式日志宏，支持 << 操作符
 // 用法: UTILS_LOG_STREAM_TRACE() << "message" << value
 // 或使用统一宏: UTILS_LOG(TRACE) << "message" << value
 // 使用 std::source_location 自动捕获文件路径、行号和函数名信息（C++20）
-#define UTILS_LOG_STREAM_TRACE() \
-    utils::logging::spdlog_log::LogStream(spdlog::level::trace, std::source_location::current())
-#define UTILS_LOG_STREAM_DEBUG() \
-    utils::logging::spdlog_log::LogStream(spdlog::level::debug, std::source_location::current())
-#define UTILS_LOG_STREAM_INFO() \
-    utils::logging::spdlog_log::LogStream(spdlog::level::info, std::source_location::current())
-#define UTILS_LOG_STREAM_WARN() \
-    utils::logging::spdlog_log::LogStream(spdlog::level::warn, std::source_location::current())
-#define UTILS_LOG_STREAM_ERROR() \
-    utils::logging::spdlog_log::LogStream(spdlog::level::err, std::source_location::current())
-#define UTILS_LOG_STREAM_FATAL() \
-    utils::logging::spdlog_log::LogStream(spdlog::level::critical, std::source_location::current())
+// 与 glog 的 LOG 相同，级别未开启时整条语句短路，<< 右侧的操作数不会被求值；
+// 低于 UTILS_LOG_ACTIVE_LEVEL 的级别条件为编译期常量，整条语句被编译器移除
+#define UTILS_LOG_STREAM_AT(level)                         \
+    static_cast<int>(level) < UTILS_LOG_ACTIVE_LEVEL ||    \
+            !utils::logging::spdlog_log::should_log(level) \
+        ? (void)0                                          \
+        : utils::logging::spdlog_log::LogStreamVoidify() & \
+              utils::logging::spdlog_log::LogStream(level, std::source_location::current())
+#define UTILS_LOG_STREAM_TRACE() UTILS_LOG_STREAM_AT(spdlog::level::trace)
+#define UTILS_LOG_STREAM_DEBUG() UTILS_LOG_STREAM_AT(spdlog::level::debug)
+#define UTILS_LOG_STREAM_INFO() UTILS_LOG_STREAM_AT(spdlog::level::info)
+#define UTILS_LOG_STREAM_WARN() UTILS_LOG_STREAM_AT(spdlog::level::warn)
+#define UTILS_LOG_STREAM_ERROR() UTILS_LOG_STREAM_AT(spdlog::level::err)
+#define UTILS_LOG_STREAM_FATAL() UTILS_LOG_STREAM_AT(spdlog::level::critical)
 
 // 统一流式日志宏 - UTILS_LOG(TRACE) << "message" << value
 // 注意: level 必须是 TRACE, DEBUG, INFO, WARN, ERROR, FATAL 之一（大写）
 #define UTILS_LOG(level) UTILS_LOG_STREAM_##level()
+
+// 模块日志宏，级别由各模块单独控制（见 module_logger.hpp），module 为字符串字面量
+// 用法: UTILS_MODULE_LOG_DEBUG("filesystem", "message {}", value)
+// 或流式: UTILS_MODULE_LOG("task", DEBUG) << "message" << value
+#define UTILS_MODULE_LOG_TRACE(module, fmt, ...) \
+    UTILS_SPDLOG_MODULE_LOG(module, spdlog::level::trace, fmt, ##__VA_ARGS__)
+#define UTILS_MODULE_LOG_DEBUG(module, fmt, ...) \
+    UTILS_SPDLOG_MODULE_LOG(module, spdlog::level::debug, fmt, ##__VA_ARGS__)
+#define UTILS_MODULE_LOG_INFO(module, fmt, ...) \
+    UTILS_SPDLOG_MODULE_LOG(module, spdlog::level::info, fmt, ##__VA_ARGS__)
+#define UTILS_MODULE_LOG_WARN(module, fmt, ...) \
+    UTILS_SPDLOG_MODULE_LOG(module, spdlog::level::warn, fmt, ##__VA_ARGS__)
+#define UTILS_MODULE_LOG_ERROR(module, fmt, ...) \
+    UTILS_SPDLOG_MODULE_LOG(module, spdlog::level::err, fmt, ##__VA_ARGS__)
+#define UTILS_MODULE_LOG_FATAL(module, fmt, ...) \
+    UTILS_SPDLOG_MODULE_LOG(module, spdlog::level::critical, fmt, ##__VA_ARGS__)
+
+#define UTILS_MODULE_LOG_STREAM_AT(module, level)                                    \
+    static_cast<int>(level) < UTILS_LOG_ACTIVE_LEVEL ||                              \
+            !UTILS_LOG_MODULE_HANDLE(module).should_log(level)                       \
+        ? (void)0                                                                    \
+        : utils::logging::spdlog_log::LogStreamVoidify() &                           \
+              utils::logging::spdlog_log::LogStream(UTILS_LOG_MODULE_HANDLE(module), \
+                                                    level, std::source_location::current())
+#define UTILS_MODULE_LOG_STREAM_TRACE(module) \
+    UTILS_MODULE_LOG_STREAM_AT(module, spdlog::level::trace)
+#define UTILS_MODULE_LOG_STREAM_DEBUG(module) \
+    UTILS_MODULE_LOG_STREAM_AT(module, spdlog::level::debug)
+#define UTILS_MODULE_LOG_STREAM_INFO(module) UTILS_MODULE_LOG_STREAM_AT(module, spdlog::level::info)
+#define UTILS_MODULE_LOG_STREAM_WARN(module) UTILS_MODULE_LOG_STREAM_AT(module, spdlog::level::warn)
+#define UTILS_MODULE_LOG_STREAM_ERROR(module) UTILS_MODULE_LOG_STREAM_AT(module, spdlog::level::err)
+#define UTILS_MODULE_LOG_STREAM_FATAL(module) \
+    UTILS_MODULE_LOG_STREAM_AT(module, spdlog::level::critical)
+
+#define UTILS_MODULE_LOG(module, level) UTILS_MODULE_LOG_STREAM_##level(module)
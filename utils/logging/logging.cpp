@@ -5,14 +5,24 @@
 #include <memory>
 #include <vector>
 
+#include "async_sink.hpp"
+
 namespace utils {
 namespace logging {
 namespace spdlog_log {
 
 std::shared_ptr<spdlog::logger> g_logger = nullptr;
+// 异步模式下 g_logger 唯一的 sink，同步模式为空
+std::shared_ptr<AsyncSink> g_async_sink = nullptr;
+// 始终等于 g_logger.get()
+std::atomic<spdlog::logger*> g_logger_raw{nullptr};
 
-int init_logging(const std::string& log_name, const std::string& log_level) {
+int init_logging(const std::string& log_name, const std::string& log_level,
+                 const std::optional<AsyncOptions>& async_options) {
     try {
+        // 重新初始化时先写完延迟格式化模式中剩余的日志
+        stop_deferred_logging();
+
         // 创建 sinks
         std::vector<spdlog::sink_ptr> sinks;
 
@@ -26,37 +36,71 @@ int init_logging(const std::string& log_name, const std::string& log_level) {
         sinks.push_back(file_sink);
         sinks.push_back(console_sink);
 
-        // 创建 logger
-        g_logger = std::make_shared<spdlog::logger>("multi_sink", sinks.begin(), sinks.end());
+        // 创建 logger，异步模式下文件和控制台由 AsyncSink 的后台线程写入。
+        // 重新初始化时旧的 AsyncSink 在最后一个引用释放时写完剩余日志
+        g_async_sink = nullptr;
+        if (async_options) {
+            g_async_sink = std::make_shared<AsyncSink>(std::move(sinks), *async_options);
+            g_logger     = std::make_shared<spdlog::logger>("multi_sink", g_async_sink);
+        } else {
+            g_logger = std::make_shared<spdlog::logger>("multi_sink", sinks.begin(), sinks.end());
+        }
 
         // 设置默认 logger
         spdlog::set_default_logger(g_logger);
+        g_logger_raw.store(g_logger.get(), std::memory_order_release);
 
-        // 解析日志等级字符串
-        std::string lower_level = log_level;
-        std::transform(lower_level.begin(), lower_level.end(), lower_level.begin(), ::tolower);
-
+        // 解析日志等级字符串，无法识别时使用 info
         spdlog::level::level_enum level = spdlog::level::info;
-        if (lower_level == "trace")
-            level = spdlog::level::trace;
-        else if (lower_level == "debug")
-            level = spdlog::level::debug;
-        else if (lower_level == "info")
-            level = spdlog::level::info;
-        else if (lower_level == "warning")
-            level = spdlog::level::warn;
-        else if (lower_level == "error")
-            level = spdlog::level::err;
-        else if (lower_level == "fatal")
-            level = spdlog::level::critical;
+        parse_log_level(log_level, level);
 
         // 设置日志级别（同时设置全局和 logger 的级别）
         spdlog::set_level(level);
         g_logger->set_level(level);
 
-        // 设置日志格式: [时间] [级别] [线程ID] 消息
-        spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%t] [%g:%#] %v");
+        // 设置日志格式
+        spdlog::set_pattern(kDefaultLogPattern);
+
+        // 模块 logger 改用新的 sink
+        rebind_module_loggers(g_logger);
+
+        return 0;
+    } catch (const spdlog::spdlog_ex& ex) {
+        return -1;
+    }
+}
+
+bool parse_log_level(std::string_view text, spdlog::level::level_enum& level) {
+    std::string lower_level(text);
+    std::transform(lower_level.begin(), lower_level.end(), lower_level.begin(), ::tolower);
+
+    if (lower_level == "trace")
+        level = spdlog::level::trace;
+    else if (lower_level == "debug")
+        level = spdlog::level::debug;
+    else if (lower_level == "info")
+        level = spdlog::level::info;
+    else if (lower_level == "warning")
+        level = spdlog::level::warn;
+    else if (lower_level == "error")
+        level = spdlog::level::err;
+    else if (lower_level == "fatal")
+        level = spdlog::level::critical;
+    else if (lower_level == "off")
+        level = spdlog::level::off;
+    else
+        return false;
+    return true;
+}
 
+int init_deferred_logging(const std::string& log_name, const std::string& log_level,
+                          const DeferredOptions& options) {
+    int ret = init_logging(log_name, log_level);
+    if (ret != 0)
+        return ret;
+    try {
+        // kText 与同步模式共用文件和控制台 sink
+        start_deferred_logging(options, g_logger, log_name + kDeferredLogSuffix);
         return 0;
     } catch (const spdlog::spdlog_ex& ex) {
         return -1;
@@ -67,6 +111,14 @@ void flush_logging() {
     if (g_logger) {
         g_logger->flush_on(spdlog::level::critical);
     }
+    // 延迟格式化模式：在当前线程取空各线程的环并刷新输出
+    if (deferred_logging_enabled())
+        flush_deferred_logging();
+    // 异步模式：等待后台线程写完之前的日志，再在当前线程刷新文件和控制台
+    if (auto async_sink = g_async_sink) {
+        async_sink->flush_sync();
+        return;
+    }
     spdlog::get("multi_sink")->flush();
 }
 
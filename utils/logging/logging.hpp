@@ -4,39 +4,156 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ostream>
 #include <source_location>
 #include <sstream>
+#include <streambuf>
 #include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "deferred_log.hpp"
+#include "module_logger.hpp"
 
 namespace utils {
 namespace logging {
 namespace spdlog_log {
 
-// 初始化日志系统
-int init_logging(const std::string& log_name, const std::string& log_level);
+// 异步模式下队列满时的处理方式
+enum class AsyncOverflowPolicy {
+    kBlock,            // 调用线程等待后台线程腾出空间
+    kOverwriteOldest,  // 丢弃队列中最旧的一条日志
+};
+
+// 异步模式：日志先进入有界队列，由后台线程成批格式化并写入文件和控制台
+struct AsyncOptions {
+    std::size_t         queue_size      = 8192;  // 队列容量（条）
+    AsyncOverflowPolicy overflow_policy = AsyncOverflowPolicy::kBlock;
+    std::size_t         worker_count    = 1;  // 后台线程数，大于 1 时各批之间可能乱序
+    // 后台线程写出后最迟多久刷新一次底层 sink
+    std::chrono::milliseconds flush_interval{1000};
+};
+
+// 初始化日志系统。不给出 async_options 时调用线程同步写入文件和控制台
+int init_logging(const std::string& log_name, const std::string& log_level,
+                 const std::optional<AsyncOptions>& async_options = std::nullopt);
+
+// 解析级别字符串（不区分大小写）：trace、debug、info、warning、error、fatal、off，
+// 无法识别时返回 false 且不修改 level
+bool parse_log_level(std::string_view text, spdlog::level::level_enum& level);
+
+// 延迟格式化模式（见 deferred_log.hpp）：UTILS_LOG_* 格式化字符串风格的日志只记录参数的原始字节，
+// 由后台线程格式化或写出二进制文件。流式日志和直接使用 logger 的日志仍按同步模式写入
+int init_deferred_logging(const std::string& log_name, const std::string& log_level,
+                          const DeferredOptions& options = {});
 
-// 刷新日志
+// 日志格式: [时间] [级别] [线程ID] [文件:行号] 消息
+inline constexpr char kDefaultLogPattern[] = "[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%t] [%g:%#] %v";
+
+// 刷新日志。异步模式下等待调用前产生的日志全部写入并刷新后返回，可在 abort 前作为同步屏障
 void flush_logging();
 
 // 获取默认日志记录器
 std::shared_ptr<spdlog::logger> get_default_logger();
 
-// 流式日志包装类
+// 默认日志记录器的裸指针，不增减引用计数，供热路径使用。
+// init_logging 替换 logger 时旧 logger 随即释放，因此不能与日志调用并发执行
+extern std::atomic<spdlog::logger*> g_logger_raw;
+
+inline spdlog::logger* default_logger_raw() {
+    return g_logger_raw.load(std::memory_order_acquire);
+}
+
+// 默认日志记录器是否输出该级别
+inline bool should_log(spdlog::level::level_enum level) {
+    auto* logger = default_logger_raw();
+    return logger && logger->should_log(level);
+}
+
+// std::ostream 的输出直接追加到 fmt::memory_buffer
+class LogStreamBuf : public std::streambuf {
+   public:
+    explicit LogStreamBuf(fmt::memory_buffer& buffer) : buffer_(buffer) {}
+
+   protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            buffer_.push_back(traits_type::to_char_type(ch));
+        return traits_type::not_eof(ch);
+    }
+    std::streamsize xsputn(const char* s, std::streamsize count) override {
+        buffer_.append(s, s + count);
+        return count;
+    }
+
+   private:
+    fmt::memory_buffer& buffer_;
+};
+
+// 每个线程复用的格式化缓冲区，ostream 只在需要 operator<< 或流操作符时使用
+struct LogStreamState {
+    fmt::memory_buffer buffer;
+    LogStreamBuf       streambuf{buffer};
+    std::ostream       stream{&streambuf};
+    bool               in_use = false;
+};
+
+// 整数、字符串和浮点数直接写入缓冲区，输出与 ostream 的默认格式一致。
+// bool、signed/unsigned char 等 fmt 与 ostream 输出不同的类型走 ostream
+template <typename T>
+inline constexpr bool kLogStreamDirect =
+    std::is_same_v<T, char> || std::is_floating_point_v<T> ||
+    (std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, signed char> &&
+     !std::is_same_v<T, unsigned char> && !std::is_same_v<T, wchar_t> &&
+     !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+     !std::is_same_v<T, char32_t>) ||
+    std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+    std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>;
+
+// 流式日志包装类。日志先格式化进线程局部缓冲区，析构时整条交给 logger，
+// 除了 logger 和 sink 自身外没有堆分配
 class LogStream {
    public:
     LogStream(spdlog::level::level_enum   level,
               const std::source_location& loc = std::source_location::current())
-        : level_(level), loc_(loc) {}
+        : level_(level), loc_(loc) {
+        logger_ = default_logger_raw();
+        if (!logger_ || !logger_->should_log(level_)) {
+            logger_ = nullptr;
+            return;
+        }
+        start();
+    }
+
+    // 写入模块 logger，级别由模块句柄决定
+    LogStream(const ModuleLogger& module, spdlog::level::level_enum level,
+              const std::source_location& loc = std::source_location::current())
+        : level_(level), loc_(loc) {
+        logger_ = module.logger();
+        if (!logger_ || !module.should_log(level_)) {
+            logger_ = nullptr;
+            return;
+        }
+        start();
+    }
 
     ~LogStream() {
-        if (logger_) {
-            auto msg = stream_.str();
-            if (!msg.empty()) {
-                spdlog::source_loc spdlog_loc{loc_.file_name(), static_cast<int>(loc_.line()),
-                                              loc_.function_name()};
-                logger_->log(spdlog_loc, level_, "{}", msg);
-            }
+        if (!logger_)
+            return;
+        if (state_->buffer.size() > 0) {
+            spdlog::source_loc spdlog_loc{loc_.file_name(), static_cast<int>(loc_.line()),
+                                          loc_.function_name()};
+            logger_->log(spdlog_loc, level_,
+                         spdlog::string_view_t(state_->buffer.data(), state_->buffer.size()));
         }
+        state_->in_use = false;
     }
 
     // 禁止拷贝和移动
@@ -48,71 +165,190 @@ class LogStream {
     // 重载 << 操作符
     template <typename T>
     LogStream& operator<<(const T& value) {
-        stream_ << value;
+        if (!logger_)
+            return *this;
+        // 用过流操作符后格式由 ostream 的状态决定，之后的操作数都走 ostream
+        if constexpr (kLogStreamDirect<T>) {
+            if (!use_stream_) {
+                append(value);
+                return *this;
+            }
+        }
+        stream() << value;
         return *this;
     }
 
     // 支持 std::endl 等流操作符
     LogStream& operator<<(std::ostream& (*manip)(std::ostream&)) {
-        manip(stream_);
+        if (logger_)
+            manip(stream());
         return *this;
     }
 
    private:
+    void start() {
+        static thread_local LogStreamState state;
+        if (!state.in_use) {
+            state_ = &state;
+        } else {
+            // 操作数的 operator<< 内部又写了日志，嵌套的那条使用自己的缓冲区
+            nested_ = std::make_unique<LogStreamState>();
+            state_  = nested_.get();
+        }
+        state_->in_use = true;
+        state_->buffer.clear();
+    }
+
+    template <typename T>
+    void append(const T& value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            // 与 ostream 默认的 %g、精度 6 一致，比 fmt 的 {:g} 快
+            char chars[32];
+            auto result = std::to_chars(chars, chars + sizeof(chars), value,
+                                        std::chars_format::general, 6);
+            state_->buffer.append(chars, result.ptr);
+        } else if constexpr (std::is_array_v<T>) {
+            state_->buffer.append(std::string_view(value));
+        } else if constexpr (std::is_pointer_v<T>) {
+            // 空指针不输出；ostream 会置 badbit 并丢掉之后的全部内容
+            if (value)
+                state_->buffer.append(std::string_view(value));
+        } else if constexpr (std::is_same_v<T, std::string> ||
+                             std::is_same_v<T, std::string_view>) {
+            state_->buffer.append(value);
+        } else {
+            fmt::format_to(std::back_inserter(state_->buffer), "{}", value);
+        }
+    }
+
+    // 第一次使用 ostream 时恢复默认格式，避免沿用上一条日志设置的状态
+    std::ostream& stream() {
+        if (!use_stream_) {
+            use_stream_ = true;
+            state_->stream.clear();
+            state_->stream.flags(std::ios_base::dec | std::ios_base::skipws);
+            state_->stream.width(0);
+            state_->stream.precision(6);
+            state_->stream.fill(' ');
+        }
+        return state_->stream;
+    }
+
     spdlog::level::level_enum       level_;
     std::source_location            loc_;
-    std::ostringstream              stream_;
-    std::shared_ptr<spdlog::logger> logger_{get_default_logger()};
+    spdlog::logger*                 logger_     = nullptr;
+    LogStreamState*                 state_      = nullptr;
+    std::unique_ptr<LogStreamState> nested_;
+    bool                            use_stream_ = false;
+};
+
+// 供 UTILS_SPDLOG_LOG_STRIPPED 检查格式串与参数，从不调用
+template <typename... Args>
+void check_log_format(spdlog::format_string_t<Args...>, Args&&...) {}
+
+// 把 LogStream 表达式转为 void，使 UTILS_LOG 的条件表达式两边类型一致
+// （同 glog 的 LogMessageVoidify）
+struct LogStreamVoidify {
+    // & 的优先级低于 <<，整条 << 链先求值
+    void operator&(const LogStream&) {}
 };
 
 }  // namespace spdlog_log
 }  // namespace logging
 }  // namespace utils
 
-#define UTILS_SPDLOG_LOG_TRACE(fmt, ...)                                         \
-    do {                                                                         \
-        if (auto logger = ::utils::logging::spdlog_log::get_default_logger()) {  \
-            logger->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, \
-                        spdlog::level::trace, fmt, ##__VA_ARGS__);               \
-        }                                                                        \
-    } while (0)
+// 编译期日志级别：低于 UTILS_LOG_ACTIVE_LEVEL 的日志语句整条被移除，运行时没有任何开销。
+// 按编译单元生效，例如 target_compile_definitions(xxx PRIVATE
+// UTILS_LOG_ACTIVE_LEVEL=UTILS_LOG_LEVEL_INFO)。取值与 spdlog::level 一致
+#define UTILS_LOG_LEVEL_TRACE 0
+#define UTILS_LOG_LEVEL_DEBUG 1
+#define UTILS_LOG_LEVEL_INFO 2
+#define UTILS_LOG_LEVEL_WARN 3
+#define UTILS_LOG_LEVEL_ERROR 4
+#define UTILS_LOG_LEVEL_FATAL 5
+#define UTILS_LOG_LEVEL_OFF 6
 
-#define UTILS_SPDLOG_LOG_DEBUG(fmt, ...)                                         \
-    do {                                                                         \
-        if (auto logger = ::utils::logging::spdlog_log::get_default_logger()) {  \
-            logger->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, \
-                        spdlog::level::debug, fmt, ##__VA_ARGS__);               \
-        }                                                                        \
-    } while (0)
+#ifndef UTILS_LOG_ACTIVE_LEVEL
+#define UTILS_LOG_ACTIVE_LEVEL UTILS_LOG_LEVEL_TRACE
+#endif
 
-#define UTILS_SPDLOG_LOG_INFO(fmt, ...)                                          \
-    do {                                                                         \
-        if (auto logger = ::utils::logging::spdlog_log::get_default_logger()) {  \
-            logger->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, \
-                        spdlog::level::info, fmt, ##__VA_ARGS__);                \
-        }                                                                        \
+// logger 已通过级别检查，写一条日志。logger->log 和 deferred_log 的格式串参数为
+// spdlog::format_string_t（即 fmt::format_string），格式串与参数不匹配时编译报错。
+// 延迟格式化模式下 UtilsLogSite 让每个调用点对应 deferred_log 的一个实例化，调用点 id 只注册一次；
+// 后台线程统一以默认 logger 的名字写出
+#define UTILS_SPDLOG_LOG_TO(logger, level, fmt, ...)                        \
+    do {                                                                    \
+        spdlog::source_loc utils_loc_{__FILE__, __LINE__, SPDLOG_FUNCTION}; \
+        if (::utils::logging::spdlog_log::deferred_logging_enabled()) {     \
+            struct UtilsLogSite {};                                         \
+            ::utils::logging::spdlog_log::deferred_log<UtilsLogSite>(       \
+                level, utils_loc_, fmt, ##__VA_ARGS__);                     \
+        } else {                                                            \
+            (logger)->log(utils_loc_, level, fmt, ##__VA_ARGS__);           \
+        }                                                                   \
     } while (0)
 
-#define UTILS_SPDLOG_LOG_WARN(fmt, ...)                                          \
-    do {                                                                         \
-        if (auto logger = ::utils::logging::spdlog_log::get_default_logger()) {  \
-            logger->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, \
-                        spdlog::level::warn, fmt, ##__VA_ARGS__);                \
-        }                                                                        \
+// 级别未开启时不求值参数
+#define UTILS_SPDLOG_LOG(level, fmt, ...)                                         \
+    do {                                                                          \
+        auto* utils_logger_ = ::utils::logging::spdlog_log::default_logger_raw(); \
+        if (utils_logger_ && utils_logger_->should_log(level))                    \
+            UTILS_SPDLOG_LOG_TO(utils_logger_, level, fmt, ##__VA_ARGS__);        \
     } while (0)
 
-#define UTILS_SPDLOG_LOG_ERROR(fmt, ...)                                         \
-    do {                                                                         \
-        if (auto logger = ::utils::logging::spdlog_log::get_default_logger()) {  \
-            logger->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, \
-                        spdlog::level::err, fmt, ##__VA_ARGS__);                 \
-        }                                                                        \
+// 模块日志：只读取模块句柄上的级别和 logger，不加锁。
+// 低于 UTILS_LOG_ACTIVE_LEVEL 的级别条件为编译期常量，整条语句被编译器移除
+#define UTILS_SPDLOG_MODULE_LOG(module, level, fmt, ...)                       \
+    do {                                                                       \
+        if (static_cast<int>(level) >= UTILS_LOG_ACTIVE_LEVEL) {               \
+            auto& utils_module_ = UTILS_LOG_MODULE_HANDLE(module);             \
+            auto* utils_logger_ = utils_module_.logger();                      \
+            if (utils_logger_ && utils_module_.should_log(level))              \
+                UTILS_SPDLOG_LOG_TO(utils_logger_, level, fmt, ##__VA_ARGS__); \
+        }                                                                      \
     } while (0)
 
-#define UTILS_SPDLOG_LOG_FATAL(fmt, ...)                                         \
-    do {                                                                         \
-        if (auto logger = ::utils::logging::spdlog_log::get_default_logger()) {  \
-            logger->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, \
-                        spdlog::level::critical, fmt, ##__VA_ARGS__);            \
-        }                                                                        \
+// 编译期移除的日志：不生成代码，参数不求值，但格式串和参数仍与开启时一样做类型检查；
+// 只在日志中使用的变量也不会产生未使用警告
+#define UTILS_SPDLOG_LOG_STRIPPED(fmt, ...)                                     \
+    do {                                                                        \
+        if constexpr (false)                                                    \
+            ::utils::logging::spdlog_log::check_log_format(fmt, ##__VA_ARGS__); \
     } while (0)
+
+#if UTILS_LOG_ACTIVE_LEVEL <= UTILS_LOG_LEVEL_TRACE
+#define UTILS_SPDLOG_LOG_TRACE(fmt, ...) UTILS_SPDLOG_LOG(spdlog::level::trace, fmt, ##__VA_ARGS__)
+#else
+#define UTILS_SPDLOG_LOG_TRACE(fmt, ...) UTILS_SPDLOG_LOG_STRIPPED(fmt, ##__VA_ARGS__)
+#endif
+
+#if UTILS_LOG_ACTIVE_LEVEL <= UTILS_LOG_LEVEL_DEBUG
+#define UTILS_SPDLOG_LOG_DEBUG(fmt, ...) UTILS_SPDLOG_LOG(spdlog::level::debug, fmt, ##__VA_ARGS__)
+#else
+#define UTILS_SPDLOG_LOG_DEBUG(fmt, ...) UTILS_SPDLOG_LOG_STRIPPED(fmt, ##__VA_ARGS__)
+#endif
+
+#if UTILS_LOG_ACTIVE_LEVEL <= UTILS_LOG_LEVEL_INFO
+#define UTILS_SPDLOG_LOG_INFO(fmt, ...) UTILS_SPDLOG_LOG(spdlog::level::info, fmt, ##__VA_ARGS__)
+#else
+#define UTILS_SPDLOG_LOG_INFO(fmt, ...) UTILS_SPDLOG_LOG_STRIPPED(fmt, ##__VA_ARGS__)
+#endif
+
+#if UTILS_LOG_ACTIVE_LEVEL <= UTILS_LOG_LEVEL_WARN
+#define UTILS_SPDLOG_LOG_WARN(fmt, ...) UTILS_SPDLOG_LOG(spdlog::level::warn, fmt, ##__VA_ARGS__)
+#else
+#define UTILS_SPDLOG_LOG_WARN(fmt, ...) UTILS_SPDLOG_LOG_STRIPPED(fmt, ##__VA_ARGS__)
+#endif
+
+#if UTILS_LOG_ACTIVE_LEVEL <= UTILS_LOG_LEVEL_ERROR
+#define UTILS_SPDLOG_LOG_ERROR(fmt, ...) UTILS_SPDLOG_LOG(spdlog::level::err, fmt, ##__VA_ARGS__)
+#else
+#define UTILS_SPDLOG_LOG_ERROR(fmt, ...) UTILS_SPDLOG_LOG_STRIPPED(fmt, ##__VA_ARGS__)
+#endif
+
+#if UTILS_LOG_ACTIVE_LEVEL <= UTILS_LOG_LEVEL_FATAL
+#define UTILS_SPDLOG_LOG_FATAL(fmt, ...) \
+    UTILS_SPDLOG_LOG(spdlog::level::critical, fmt, ##__VA_ARGS__)
+#else
+#define UTILS_SPDLOG_LOG_FATAL(fmt, ...) UTILS_SPDLOG_LOG_STRIPPED(fmt, ##__VA_ARGS__)
+#endif
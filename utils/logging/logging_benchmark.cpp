@@ -0,0 +1,164 @@
+#include <benchmark/benchmark.h>
+
+#include <spdlog/sinks/null_sink.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <string>
+
+#include "log_def.hpp"
+
+// 用法：benchmark_logging --benchmark_format=json --benchmark_out=logging.json
+// logger 的 sink 换成 null_sink，只测调用线程上的开销；allocs_per_log 统计 operator new 次数
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+
+const std::string kBenchmarkLogPath = "/tmp/logging_benchmark.log";
+
+// 统计参数被求值的次数，验证未开启的级别不会求值
+std::size_t g_evaluations = 0;
+
+int expensive(int value) {
+    ++g_evaluations;
+    return value * 31;
+}
+
+void setUp(const std::string& level) {
+    UTILS_LOG_INIT(kBenchmarkLogPath, level);
+    auto logger = utils::logging::spdlog_log::get_default_logger();
+    logger->sinks().clear();
+    logger->sinks().push_back(std::make_shared<spdlog::sinks::null_sink_mt>());
+    utils::logging::spdlog_log::rebind_module_loggers(logger);
+}
+
+void tearDown(benchmark::State& state, std::size_t allocations) {
+    state.counters["allocs_per_log"] =
+        benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    state.counters["evaluations"] = static_cast<double>(g_evaluations);
+    g_evaluations                 = 0;
+    std::filesystem::remove(kBenchmarkLogPath);
+}
+
+// 级别未开启：只有一次 level 比较
+void BM_LogStreamDisabled(benchmark::State& state) {
+    setUp("info");
+    std::size_t before = g_allocations.load(std::memory_order_relaxed);
+    int         i      = 0;
+    for (auto _ : state) {
+        UTILS_LOG(DEBUG) << "value " << i << " expensive " << expensive(i);
+        ++i;
+    }
+    tearDown(state, g_allocations.load(std::memory_order_relaxed) - before);
+}
+BENCHMARK(BM_LogStreamDisabled);
+
+void BM_LogStreamEnabled(benchmark::State& state) {
+    setUp("info");
+    std::string name   = "scheduler";
+    std::size_t before = g_allocations.load(std::memory_order_relaxed);
+    int         i      = 0;
+    for (auto _ : state) {
+        UTILS_LOG(INFO) << "task " << i << " on " << name << " took " << 1.5 << " ms";
+        ++i;
+    }
+    tearDown(state, g_allocations.load(std::memory_order_relaxed) - before);
+}
+BENCHMARK(BM_LogStreamEnabled);
+
+void BM_LogFormatDisabled(benchmark::State& state) {
+    setUp("info");
+    std::size_t before = g_allocations.load(std::memory_order_relaxed);
+    int         i      = 0;
+    for (auto _ : state) {
+        UTILS_LOG_DEBUG("value {} expensive {}", i, expensive(i));
+        ++i;
+    }
+    tearDown(state, g_allocations.load(std::memory_order_relaxed) - before);
+}
+BENCHMARK(BM_LogFormatDisabled);
+
+// 对照：格式化字符串风格的宏
+void BM_LogFormatEnabled(benchmark::State& state) {
+    setUp("info");
+    std::string name   = "scheduler";
+    std::size_t before = g_allocations.load(std::memory_order_relaxed);
+    int         i      = 0;
+    for (auto _ : state) {
+        UTILS_LOG_INFO("task {} on {} took {} ms", i, name, 1.5);
+        ++i;
+    }
+    tearDown(state, g_allocations.load(std::memory_order_relaxed) - before);
+}
+BENCHMARK(BM_LogFormatEnabled);
+
+// 模块日志：编译期已知的模块直接使用静态句柄，运行期注册的模块使用缓存的句柄
+void BM_ModuleLogDisabled(benchmark::State& state) {
+    setUp("info");
+    std::size_t before = g_allocations.load(std::memory_order_relaxed);
+    int         i      = 0;
+    for (auto _ : state) {
+        UTILS_MODULE_LOG_DEBUG("task", "value {} expensive {}", i, expensive(i));
+        ++i;
+    }
+    tearDown(state, g_allocations.load(std::memory_order_relaxed) - before);
+}
+BENCHMARK(BM_ModuleLogDisabled);
+
+void BM_ModuleLogEnabled(benchmark::State& state) {
+    setUp("info");
+    utils::logging::spdlog_log::set_module_level("benchmark", spdlog::level::debug);
+    std::string name   = "scheduler";
+    std::size_t before = g_allocations.load(std::memory_order_relaxed);
+    int         i      = 0;
+    for (auto _ : state) {
+        UTILS_MODULE_LOG_DEBUG("benchmark", "task {} on {} took {} ms", i, name, 1.5);
+        ++i;
+    }
+    tearDown(state, g_allocations.load(std::memory_order_relaxed) - before);
+    utils::logging::spdlog_log::reset_module_level("benchmark");
+}
+BENCHMARK(BM_ModuleLogEnabled);
+
+// 延迟格式化：调用线程只把参数写进环形缓冲，格式化和写出在后台线程
+void BM_LogDeferredEnabled(benchmark::State& state) {
+    utils::logging::spdlog_log::DeferredOptions options;
+    options.output = utils::logging::spdlog_log::DeferredOutput::kBinary;
+    UTILS_LOG_INIT_DEFERRED(kBenchmarkLogPath, "info", options);
+    std::string name   = "scheduler";
+    std::size_t before = g_allocations.load(std::memory_order_relaxed);
+    int         i      = 0;
+    for (auto _ : state) {
+        UTILS_LOG_INFO("task {} on {} took {} ms", i, name, 1.5);
+        ++i;
+    }
+    std::size_t allocations = g_allocations.load(std::memory_order_relaxed) - before;
+    utils::logging::spdlog_log::stop_deferred_logging();
+    state.counters["dropped"] =
+        static_cast<double>(utils::logging::spdlog_log::deferred_dropped());
+    tearDown(state, allocations);
+    std::filesystem::remove(kBenchmarkLogPath + utils::logging::spdlog_log::kDeferredLogSuffix);
+}
+BENCHMARK(BM_LogDeferredEnabled);
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+BENCHMARK_MAIN();
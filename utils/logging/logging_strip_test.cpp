@@ -0,0 +1,46 @@
+// 本文件以 UTILS_LOG_ACTIVE_LEVEL=UTILS_LOG_LEVEL_WARN 编译（见 CMakeLists.txt）
+#include <gtest/gtest.h>
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "log_def.hpp"
+
+static_assert(UTILS_LOG_ACTIVE_LEVEL == UTILS_LOG_LEVEL_WARN);
+
+namespace spdlog_log = utils::logging::spdlog_log;
+
+// 低于编译期级别的日志即使运行期级别为 trace 也不输出、不求值参数
+TEST(LoggingStripTest, StrippedCallsDoNotEvaluate) {
+    std::ostringstream out;
+    ASSERT_EQ(spdlog_log::init_logging("/tmp/test_logging_strip.log", "trace"), 0);
+    auto logger     = spdlog_log::get_default_logger();
+    logger->sinks() = {std::make_shared<spdlog::sinks::ostream_sink_mt>(out)};
+    logger->set_pattern("[%l] %v");
+    spdlog_log::rebind_module_loggers(logger);
+    spdlog_log::set_module_level("test_strip", spdlog::level::trace);
+
+    int  evaluated = 0;
+    auto count     = [&] { return ++evaluated; };
+    // 只在被移除的日志中使用的变量
+    std::string only_logged = "stripped";
+
+    UTILS_LOG_TRACE("{} {}", count(), only_logged);
+    UTILS_LOG_DEBUG("{}", count());
+    UTILS_LOG_INFO("{} {}", count(), count());
+    UTILS_LOG(TRACE) << count();
+    UTILS_LOG(INFO) << count();
+    UTILS_MODULE_LOG_DEBUG("test_strip", "{}", count());
+    UTILS_MODULE_LOG("test_strip", INFO) << count();
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_TRUE(out.str().empty());
+
+    UTILS_LOG_WARN("{}", count());
+    UTILS_LOG(ERROR) << count();
+    UTILS_MODULE_LOG_FATAL("test_strip", "{}", count());
+    EXPECT_EQ(evaluated, 3);
+    EXPECT_EQ(out.str(), "[warning] 1\n[error] 2\n[critical] 3\n");
+    spdlog_log::reset_module_level("test_strip");
+}
@@ -0,0 +1,465 @@
+#include "logging.hpp"
+
+#include <gtest/gtest.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "async_sink.hpp"
+#include "log_def.hpp"
+
+namespace spdlog_log = utils::logging::spdlog_log;
+
+namespace {
+
+// 不带时间和线程号，同步与延迟格式化的输出可以逐字节比较
+constexpr char kTestPattern[] = "[%l] [%s:%#] %v";
+
+std::shared_ptr<spdlog::logger> make_logger(std::ostream& out) {
+    auto logger = std::make_shared<spdlog::logger>(
+        "test", std::make_shared<spdlog::sinks::ostream_sink_mt>(out));
+    logger->set_pattern(kTestPattern);
+    logger->set_level(spdlog::level::trace);
+    return logger;
+}
+
+// 无法按字节编码的自定义类型，延迟格式化时在调用线程预先格式化
+struct Point {
+    int x;
+    int y;
+};
+
+int g_pointee = 0;
+
+}  // namespace
+
+template <>
+struct fmt::formatter<Point> : fmt::formatter<std::string_view> {
+    auto format(const Point& point, fmt::format_context& ctx) const {
+        return fmt::format_to(ctx.out(), "({}, {})", point.x, point.y);
+    }
+};
+
+namespace {
+
+// 每条日志覆盖一类参数编码，同步和延迟格式化模式执行同一组调用点
+void log_samples(const std::shared_ptr<spdlog::logger>& logger, int round) {
+    UTILS_SPDLOG_LOG_TO(logger, spdlog::level::info, "int {} {} {}", round, -1L,
+                        std::uint64_t{18446744073709551615ull});
+    UTILS_SPDLOG_LOG_TO(logger, spdlog::level::warn, "float {} double {:.3f} bool {} char {}",
+                        1.5f + round, 3.14159 * round, round % 2 == 0, 'x');
+    UTILS_SPDLOG_LOG_TO(logger, spdlog::level::err, "string {} {} {}", "literal",
+                        std::string(round, 's'), std::string_view("view"));
+    UTILS_SPDLOG_LOG_TO(logger, spdlog::level::debug, "pointer {}",
+                        static_cast<const void*>(&g_pointee));
+    UTILS_SPDLOG_LOG_TO(logger, spdlog::level::critical, "custom {} round {}",
+                        Point{round, -round}, round);
+    UTILS_SPDLOG_LOG_TO(logger, spdlog::level::trace, "no arguments");
+}
+
+}  // namespace
+
+// 二进制输出：离线解码的文本与同步模式逐字节一致，包括调用线程预先格式化的自定义类型
+TEST(LoggingTest, DeferredBinaryDecode) {
+    constexpr int     kRounds     = 3;
+    const std::string binary_path = "/tmp/test_deferred.log.bin";
+
+    std::ostringstream sync_text;
+    auto               logger = make_logger(sync_text);
+    for (int round = 0; round < kRounds; ++round) log_samples(logger, round);
+
+    spdlog_log::start_deferred_logging({.output = spdlog_log::DeferredOutput::kBinary}, logger,
+                                       binary_path);
+    ASSERT_TRUE(spdlog_log::deferred_logging_enabled());
+    // 新线程使用按本次选项创建的环
+    std::thread([&] {
+        for (int round = 0; round < kRounds; ++round) log_samples(logger, round);
+    }).join();
+    spdlog_log::stop_deferred_logging();
+    EXPECT_FALSE(spdlog_log::deferred_logging_enabled());
+
+    std::ostringstream decoded;
+    EXPECT_EQ(spdlog_log::decode_deferred_log(binary_path, decoded, kTestPattern), 6u * kRounds);
+    EXPECT_EQ(decoded.str(), sync_text.str());
+}
+
+// 环尾放不下整条记录时写填充后从环首继续，消费者跳过填充，记录按顺序完整取出
+TEST(LoggingTest, DeferredRingWrap) {
+    // 40 字节的记录：4096 不是 40 的倍数，每绕一圈在环尾留下一段填充
+    constexpr std::size_t kRecordSize = 40;
+    spdlog_log::DeferredRing ring(4096, true);
+
+    std::uint32_t written = 0;
+    std::uint32_t read    = 0;
+    auto          consume = [&] {
+        ring.consume([&](const spdlog_log::DeferredRecordHeader& header, const std::byte* payload,
+                         std::size_t size) {
+            EXPECT_EQ(header.site, read);
+            EXPECT_EQ(header.ticks, read * 3u);
+            ASSERT_EQ(size, kRecordSize - sizeof(header));
+            std::uint32_t value;
+            std::memcpy(&value, payload, sizeof(value));
+            EXPECT_EQ(value, read);
+            ++read;
+        });
+    };
+    for (int i = 0; i < 1000; ++i) {
+        std::byte* record = ring.reserve(kRecordSize);
+        ASSERT_NE(record, nullptr);
+        spdlog_log::DeferredRecordHeader header{written, kRecordSize, written * 3u};
+        std::memcpy(record, &header, sizeof(header));
+        std::memcpy(record + sizeof(header), &written, sizeof(written));
+        ring.commit(kRecordSize);
+        ++written;
+        if (written % 50 == 0)
+            consume();
+    }
+    consume();
+    EXPECT_EQ(read, written);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.dropped(), 0u);
+
+    // 环满：drop_when_full 时立即丢弃，不等待
+    while (ring.reserve(kRecordSize)) ring.commit(kRecordSize);
+    EXPECT_EQ(ring.dropped(), 1u);
+}
+
+// 后台线程已经停止时环满的调用放弃等待，否则没有人再取空环
+TEST(LoggingTest, DeferredRingStopped) {
+    spdlog_log::stop_deferred_logging();
+    spdlog_log::DeferredRing ring(4096, false);
+    std::size_t              accepted = 0;
+    while (ring.reserve(64)) {
+        ring.commit(64);
+        ++accepted;
+    }
+    EXPECT_EQ(accepted, 4096u / 64);
+    EXPECT_EQ(ring.dropped(), 1u);
+}
+
+// drop_when_full：后台线程取空之前环满，多出的日志丢弃并计数，写出的条数加丢弃的条数等于总数
+TEST(LoggingTest, DeferredDropWhenFull) {
+    constexpr std::size_t kRecords    = 1000;
+    const std::string     binary_path = "/tmp/test_deferred_drop.log.bin";
+
+    std::ostringstream sync_text;
+    auto               logger = make_logger(sync_text);
+    // 后台线程只在停止时取空一次
+    spdlog_log::start_deferred_logging({.output         = spdlog_log::DeferredOutput::kBinary,
+                                        .ring_bytes     = 4096,
+                                        .drop_when_full = true,
+                                        .poll_interval  = std::chrono::seconds(10)},
+                                       logger, binary_path);
+    auto dropped = spdlog_log::deferred_dropped();
+    std::thread([&] {
+        for (std::size_t i = 0; i < kRecords; ++i)
+            UTILS_SPDLOG_LOG_TO(logger, spdlog::level::info, "record {} {}", i, "payload");
+    }).join();
+    spdlog_log::stop_deferred_logging();
+    dropped = spdlog_log::deferred_dropped() - dropped;
+
+    std::ostringstream decoded;
+    std::size_t count = spdlog_log::decode_deferred_log(binary_path, decoded, kTestPattern);
+    EXPECT_GT(count, 0u);
+    EXPECT_GT(dropped, 0u);
+    EXPECT_EQ(count + dropped, kRecords);
+    EXPECT_TRUE(sync_text.str().empty());
+}
+
+namespace {
+
+// 记录写入的每条日志和刷新次数。delay 模拟慢速输出；hold 时第一条日志停在 sink 中，
+// 直到 release()，后台线程在此期间不会再取队列
+class CountingSink : public spdlog::sinks::base_sink<std::mutex> {
+   public:
+    explicit CountingSink(std::chrono::microseconds delay = {}, bool hold = false)
+        : delay_(delay), hold_(hold) {}
+
+    std::vector<std::string> messages() {
+        std::lock_guard lock(mutex_);
+        return messages_;
+    }
+    std::size_t count() { return messages().size(); }
+    std::size_t flushes() const { return flushes_.load(); }
+
+    bool entered() const { return entered_.load(); }
+    void release() { released_.store(true); }
+
+   protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override {
+        if (hold_ && !entered_.exchange(true)) {
+            while (!released_.load()) std::this_thread::yield();
+        }
+        if (delay_.count() > 0)
+            std::this_thread::sleep_for(delay_);
+        messages_.emplace_back(msg.payload.data(), msg.payload.size());
+    }
+    void flush_() override { flushes_++; }
+
+   private:
+    std::chrono::microseconds delay_;
+    bool                      hold_;
+    std::vector<std::string>  messages_;
+    std::atomic<std::size_t>  flushes_{0};
+    std::atomic<bool>         entered_{false};
+    std::atomic<bool>         released_{false};
+};
+
+}  // namespace
+
+// flush_sync 是屏障：返回时调用前的日志都已写入底层 sink 并刷新，与 flush_interval 无关
+TEST(LoggingTest, AsyncFlushSync) {
+    for (std::size_t workers : {1, 4}) {
+        auto sink  = std::make_shared<CountingSink>(std::chrono::microseconds(100));
+        auto async = std::make_shared<spdlog_log::AsyncSink>(
+            std::vector<spdlog::sink_ptr>{sink},
+            spdlog_log::AsyncOptions{.queue_size     = 64,
+                                     .worker_count   = workers,
+                                     .flush_interval = std::chrono::hours(1)});
+        spdlog::logger logger("async", async);
+        for (int round = 1; round <= 3; ++round) {
+            for (int i = 0; i < 100; ++i) logger.info("message {}", i);
+            async->flush_sync();
+            EXPECT_EQ(sink->count(), 100u * round) << "workers " << workers;
+            EXPECT_GE(sink->flushes(), static_cast<std::size_t>(round));
+        }
+        EXPECT_EQ(async->dropped(), 0u);
+    }
+}
+
+// kOverwriteOldest：后台线程写不过来时丢弃队列中最旧的日志，保留最新的 queue_size 条
+TEST(LoggingTest, AsyncOverwriteOldest) {
+    constexpr std::size_t kQueueSize = 16;
+    constexpr std::size_t kExtra     = 50;
+
+    spdlog_log::AsyncOptions options{.queue_size = kQueueSize};
+    options.overflow_policy = spdlog_log::AsyncOverflowPolicy::kOverwriteOldest;
+
+    auto sink  = std::make_shared<CountingSink>(std::chrono::microseconds{}, true);
+    auto async =
+        std::make_shared<spdlog_log::AsyncSink>(std::vector<spdlog::sink_ptr>{sink}, options);
+    spdlog::logger logger("async", async);
+
+    // 第一条停在 sink 中，之后的日志全部留在队列里
+    logger.info("first");
+    while (!sink->entered()) std::this_thread::yield();
+    for (std::size_t i = 0; i < kQueueSize + kExtra; ++i) logger.info("message {}", i);
+    EXPECT_EQ(async->dropped(), kExtra);
+
+    sink->release();
+    async->flush_sync();
+    auto messages = sink->messages();
+    ASSERT_EQ(messages.size(), 1 + kQueueSize);
+    EXPECT_EQ(messages[0], "first");
+    for (std::size_t i = 0; i < kQueueSize; ++i)
+        EXPECT_EQ(messages[1 + i], "message " + std::to_string(kExtra + i));
+}
+
+// kBlock：多个调用线程、多个后台线程，队列满时调用线程等待，每条日志恰好写出一次
+TEST(LoggingTest, AsyncBlockMultipleWorkers) {
+    constexpr int kThreads  = 4;
+    constexpr int kMessages = 2000;
+
+    auto sink  = std::make_shared<CountingSink>(std::chrono::microseconds(5));
+    auto async = std::make_shared<spdlog_log::AsyncSink>(
+        std::vector<spdlog::sink_ptr>{sink},
+        spdlog_log::AsyncOptions{.queue_size = 8, .worker_count = 3});
+    spdlog::logger logger("async", async);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < kMessages; ++i) logger.info("{} {}", t, i);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    async->flush_sync();
+
+    auto                  messages = sink->messages();
+    std::set<std::string> unique(messages.begin(), messages.end());
+    EXPECT_EQ(messages.size(), static_cast<std::size_t>(kThreads * kMessages));
+    EXPECT_EQ(unique.size(), messages.size());
+    EXPECT_EQ(async->dropped(), 0u);
+}
+
+// 析构时唤醒 kBlock 下等待空间的调用方，其日志在调用线程上直接写出，不进入已停止的队列
+TEST(LoggingTest, AsyncStopWakesBlockedProducer) {
+    auto  sink  = std::make_shared<CountingSink>(std::chrono::microseconds{}, true);
+    auto* async = new spdlog_log::AsyncSink({sink}, {.queue_size = 1});
+    // 不持有所有权，析构可以与等待中的调用方并发
+    spdlog::logger logger("async", std::shared_ptr<spdlog_log::AsyncSink>(async, [](auto*) {}));
+
+    logger.info("first");
+    while (!sink->entered()) std::this_thread::yield();
+    logger.info("second");  // 队列已满
+    std::thread producer([&] { logger.info("third"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sink->release();
+    });
+    delete async;
+    producer.join();
+    releaser.join();
+
+    auto messages = sink->messages();
+    ASSERT_EQ(messages.size(), 3u);
+    EXPECT_EQ(messages[0], "first");
+    EXPECT_EQ(std::set<std::string>(messages.begin() + 1, messages.end()),
+              (std::set<std::string>{"second", "third"}));
+}
+
+// 级别配置文件：静态模块、运行期注册的模块和文件中先出现的模块都按文件设置；
+// 文件修改后重新加载，删去的模块恢复为跟随默认级别，代码中单独设置的级别不受影响
+TEST(LoggingTest, ModuleLevelFile) {
+    const std::string path = "/tmp/test_module_levels.conf";
+    auto write_file = [&](const std::string& content) { std::ofstream(path) << content; };
+
+    ASSERT_EQ(spdlog_log::init_logging("/tmp/test_module_levels.log", "info"), 0);
+    auto& filesystem = UTILS_LOG_MODULE_HANDLE("filesystem");
+    auto& task       = UTILS_LOG_MODULE_HANDLE("task");
+    auto& runtime    = UTILS_LOG_MODULE_HANDLE("test_runtime");
+    auto& manual     = spdlog_log::get_module_logger("test_manual");
+    EXPECT_EQ(&filesystem, &spdlog_log::get_module_logger("filesystem"));
+    EXPECT_EQ(&runtime, &spdlog_log::get_module_logger("test_runtime"));
+    EXPECT_EQ(filesystem.level(), spdlog::level::info);
+    EXPECT_EQ(runtime.level(), spdlog::level::info);
+    spdlog_log::set_module_level("test_manual", spdlog::level::err);
+
+    write_file(
+        "# 模块级别\n"
+        "default = warning\n"
+        "filesystem = debug   # 行尾注释\n"
+        "test_runtime=trace\n"
+        "test_later = fatal\n"
+        "not a level line\n"
+        "task = verbose\n");
+    EXPECT_EQ(spdlog_log::load_module_levels(path), 0);
+    EXPECT_EQ(filesystem.level(), spdlog::level::debug);
+    EXPECT_EQ(task.level(), spdlog::level::warn);  // 无法识别的级别被忽略，跟随默认级别
+    EXPECT_EQ(runtime.level(), spdlog::level::trace);
+    EXPECT_EQ(manual.level(), spdlog::level::err);
+    // 文件中先于使用出现的模块在注册时即得到文件中的级别
+    auto& later = spdlog_log::get_module_logger("test_later");
+    EXPECT_EQ(later.level(), spdlog::level::critical);
+    EXPECT_TRUE(later.should_log(spdlog::level::critical));
+    EXPECT_FALSE(later.should_log(spdlog::level::err));
+
+    write_file(
+        "default = error\n"
+        "task = debug\n");
+    EXPECT_EQ(spdlog_log::load_module_levels(path), 0);
+    EXPECT_EQ(filesystem.level(), spdlog::level::err);
+    EXPECT_EQ(task.level(), spdlog::level::debug);
+    EXPECT_EQ(runtime.level(), spdlog::level::err);
+    EXPECT_EQ(later.level(), spdlog::level::err);
+    EXPECT_EQ(manual.level(), spdlog::level::err);
+
+    // 文件不存在时保持原有级别
+    EXPECT_EQ(spdlog_log::load_module_levels(path + ".missing"), -1);
+    EXPECT_EQ(task.level(), spdlog::level::debug);
+
+    spdlog_log::reset_module_level("test_manual");
+    spdlog_log::set_default_level(spdlog::level::info);
+    EXPECT_EQ(manual.level(), spdlog::level::info);
+    EXPECT_EQ(task.level(), spdlog::level::debug);
+}
+
+namespace {
+
+// 初始化日志系统后把默认 logger 和模块 logger 的输出改到 out，只保留级别和消息
+void capture_default_logger(std::ostream& out, spdlog::level::level_enum level) {
+    ASSERT_EQ(spdlog_log::init_logging("/tmp/test_logging.log", "info"), 0);
+    auto logger = spdlog_log::get_default_logger();
+    logger->sinks() = {std::make_shared<spdlog::sinks::ostream_sink_mt>(out)};
+    logger->set_pattern("[%l] %v");
+    spdlog_log::rebind_module_loggers(logger);
+    spdlog_log::set_default_level(level);
+}
+
+// 操作数的 operator<< 内部又写了一条日志
+struct Nested {
+    friend std::ostream& operator<<(std::ostream& os, const Nested&) {
+        UTILS_LOG(INFO) << "inner " << 1;
+        return os << "outer";
+    }
+};
+
+}  // namespace
+
+// 流式日志与格式化字符串风格的日志对相同参数的输出一致：直接写入缓冲区的类型按 ostream 的默认格式，
+// bool 等类型和流操作符之后的操作数走 ostream
+TEST(LoggingTest, LogStreamMatchesFormat) {
+    std::ostringstream streamed;
+    capture_default_logger(streamed, spdlog::level::trace);
+    const char*      text = "c-string";
+    std::string      str  = "string";
+    std::string_view view = "view";
+    UTILS_LOG(INFO) << "int " << 42 << ' ' << -7L << ' ' << std::uint64_t{18446744073709551615ull}
+                    << ' ' << static_cast<short>(-3) << ' ' << 'x';
+    UTILS_LOG(WARN) << "double " << 1.5 << ' ' << 0.1 + 0.2 << ' ' << 1e-7 << ' ' << 123456789.0
+                    << ' ' << 2.5f;
+    UTILS_LOG(ERROR) << "string " << text << ' ' << str << ' ' << view;
+    UTILS_LOG(DEBUG) << "bool " << true << ' ' << false;
+    UTILS_LOG(TRACE) << "manip " << std::hex << 255 << ' ' << 3.25 << std::dec << ' ' << 10;
+    UTILS_LOG(FATAL) << "width [" << std::setw(5) << 42 << "] [" << std::fixed
+                     << std::setprecision(2) << 3.14159 << "]";
+    std::string stream_text = streamed.str();
+
+    std::ostringstream formatted;
+    capture_default_logger(formatted, spdlog::level::trace);
+    UTILS_LOG_INFO("int {} {} {} {} {}", 42, -7L, std::uint64_t{18446744073709551615ull},
+                   static_cast<short>(-3), 'x');
+    UTILS_LOG_WARN("double {:g} {:g} {:g} {:g} {:g}", 1.5, 0.1 + 0.2, 1e-7, 123456789.0, 2.5f);
+    UTILS_LOG_ERROR("string {} {} {}", text, str, view);
+    UTILS_LOG_DEBUG("bool {:d} {:d}", true, false);
+    UTILS_LOG_TRACE("manip {:x} {:g} {}", 255, 3.25, 10);
+    UTILS_LOG_FATAL("width [{:5}] [{:.2f}]", 42, 3.14159);
+    EXPECT_EQ(stream_text, formatted.str());
+    EXPECT_NE(stream_text.find("[info] int 42 -7 18446744073709551615 -3 x\n"), std::string::npos);
+
+    // 嵌套的日志先写出；之后的日志仍复用线程局部缓冲区
+    std::ostringstream nested;
+    capture_default_logger(nested, spdlog::level::trace);
+    UTILS_LOG(INFO) << Nested{} << ' ' << 2;
+    UTILS_LOG(INFO) << "after";
+    EXPECT_EQ(nested.str(), "[info] inner 1\n[info] outer 2\n[info] after\n");
+}
+
+// 级别未开启时整条语句短路，<< 右侧的操作数不求值
+TEST(LoggingTest, LogStreamDisabledLevel) {
+    std::ostringstream out;
+    capture_default_logger(out, spdlog::level::warn);
+    int  evaluated = 0;
+    auto count     = [&] { return ++evaluated; };
+
+    UTILS_LOG(TRACE) << count();
+    UTILS_LOG(DEBUG) << count() << ' ' << count();
+    UTILS_LOG(INFO) << count();
+    UTILS_LOG_INFO("{}", count());
+    spdlog_log::set_module_level("test_stream", spdlog::level::err);
+    UTILS_MODULE_LOG("test_stream", WARN) << count();
+    UTILS_MODULE_LOG_WARN("test_stream", "{}", count());
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_TRUE(out.str().empty());
+
+    UTILS_LOG(WARN) << count();
+    UTILS_MODULE_LOG("test_stream", ERROR) << count();
+    EXPECT_EQ(evaluated, 2);
+    EXPECT_EQ(out.str(), "[warning] 1\n[error] 2\n");
+    spdlog_log::reset_module_level("test_stream");
+}
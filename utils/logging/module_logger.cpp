@@ -0,0 +1,277 @@
+#include "module_logger.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+#include "logging.hpp"
+
+namespace utils {
+namespace logging {
+namespace spdlog_log {
+
+constinit std::array<ModuleLogger, kLogModuleCount> g_static_module_loggers =
+    []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<ModuleLogger, kLogModuleCount>{ModuleLogger(kLogModules[I])...};
+    }(std::make_index_sequence<kLogModuleCount>{});
+
+class ModuleRegistry {
+   public:
+    // 模块 logger 可能在退出阶段仍被使用，实例不析构
+    static ModuleRegistry& instance() {
+        static auto* registry = new ModuleRegistry();
+        return *registry;
+    }
+
+    ModuleLogger& get(std::string_view name) {
+        std::lock_guard lock(mutex_);
+        return *find_or_add(name).handle;
+    }
+
+    void set_level(std::string_view name, spdlog::level::level_enum level) {
+        std::lock_guard lock(mutex_);
+        auto& entry      = find_or_add(name);
+        entry.overridden = true;
+        entry.from_file  = false;
+        entry.handle->level_.store(level, std::memory_order_relaxed);
+    }
+
+    void reset_level(std::string_view name) {
+        std::lock_guard lock(mutex_);
+        auto it = entries_.find(name);
+        if (it != entries_.end())
+            reset(it->second);
+    }
+
+    void rebind(const std::shared_ptr<spdlog::logger>& default_logger) {
+        std::lock_guard lock(mutex_);
+        default_logger_ = default_logger;
+        for (auto& [name, entry] : entries_) bind(name, entry);
+    }
+
+    void follow_default_level() {
+        std::lock_guard lock(mutex_);
+        for (auto& [name, entry] : entries_) {
+            if (!entry.overridden)
+                entry.handle->level_.store(default_level(), std::memory_order_relaxed);
+        }
+    }
+
+    // 应用配置文件中的模块级别，上次由文件设置、这次不在文件中的模块恢复为跟随默认级别
+    void apply_file_levels(const std::map<std::string, spdlog::level::level_enum>& levels) {
+        std::lock_guard lock(mutex_);
+        for (auto& [name, entry] : entries_) {
+            if (entry.from_file && levels.find(name) == levels.end())
+                reset(entry);
+        }
+        for (const auto& [name, level] : levels) {
+            auto& entry      = find_or_add(name);
+            entry.overridden = true;
+            entry.from_file  = true;
+            entry.handle->level_.store(level, std::memory_order_relaxed);
+        }
+    }
+
+   private:
+    struct Entry {
+        ModuleLogger*                   handle = nullptr;
+        std::unique_ptr<ModuleLogger>   owned;  // 运行期注册的模块
+        std::shared_ptr<spdlog::logger> logger;
+        bool                            overridden = false;  // 不跟随默认级别
+        bool                            from_file  = false;  // 级别来自配置文件
+    };
+
+    ModuleRegistry() {
+        for (std::size_t i = 0; i < kLogModuleCount; ++i)
+            entries_[std::string(kLogModules[i])].handle = &g_static_module_loggers[i];
+    }
+
+    // 调用方持有 mutex_
+    Entry& find_or_add(std::string_view name) {
+        auto it = entries_.find(name);
+        if (it != entries_.end())
+            return it->second;
+        it = entries_.emplace(std::string(name), Entry{}).first;
+        // 句柄中的名字指向 map 节点中的 key，节点地址不变
+        it->second.owned  = std::make_unique<ModuleLogger>(it->first);
+        it->second.handle = it->second.owned.get();
+        bind(it->first, it->second);
+        return it->second;
+    }
+
+    void bind(const std::string& name, Entry& entry) {
+        if (!entry.overridden)
+            entry.handle->level_.store(default_level(), std::memory_order_relaxed);
+        if (!default_logger_)
+            return;
+        // 级别只由句柄控制，logger 自身放行所有级别
+        const auto& sinks = default_logger_->sinks();
+        entry.logger      = std::make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
+        entry.logger->set_level(spdlog::level::trace);
+        entry.handle->logger_.store(entry.logger.get(), std::memory_order_release);
+    }
+
+    void reset(Entry& entry) {
+        entry.overridden = false;
+        entry.from_file  = false;
+        entry.handle->level_.store(default_level(), std::memory_order_relaxed);
+    }
+
+    spdlog::level::level_enum default_level() const {
+        return default_logger_ ? default_logger_->level() : spdlog::level::info;
+    }
+
+    std::mutex                                     mutex_;
+    std::map<std::string, Entry, std::less<>>      entries_;
+    std::shared_ptr<spdlog::logger>                default_logger_;
+};
+
+namespace {
+
+void warn(const std::string& message) {
+    if (auto logger = get_default_logger())
+        logger->warn(message);
+}
+
+// 轮询配置文件的修改时间，编辑器先写临时文件再改名的保存方式也能发现
+class LevelFileWatcher {
+   public:
+    void start(const std::string& path, std::chrono::milliseconds interval) {
+        std::lock_guard lock(mutex_);
+        stop_locked();
+        thread_ =
+            std::jthread([path, interval](std::stop_token stop) { run(stop, path, interval); });
+    }
+
+    void stop() {
+        std::lock_guard lock(mutex_);
+        stop_locked();
+    }
+
+   private:
+    void stop_locked() {
+        if (thread_.joinable()) {
+            thread_.request_stop();
+            thread_.join();
+        }
+    }
+
+    static void run(std::stop_token stop, const std::string& path,
+                    std::chrono::milliseconds interval) {
+        std::mutex                                       wait_mutex;
+        std::condition_variable_any                      wait;
+        std::optional<std::filesystem::file_time_type> last_write;
+        while (!stop.stop_requested()) {
+            std::error_code ec;
+            auto            write_time = std::filesystem::last_write_time(path, ec);
+            if (!ec && write_time != last_write) {
+                last_write = write_time;
+                load_module_levels(path);
+            }
+            std::unique_lock lock(wait_mutex);
+            wait.wait_for(lock, stop, interval, [] { return false; });
+        }
+    }
+
+    std::mutex   mutex_;
+    std::jthread thread_;
+};
+
+LevelFileWatcher& level_file_watcher() {
+    static LevelFileWatcher watcher;
+    return watcher;
+}
+
+std::string_view trim(std::string_view text) {
+    constexpr std::string_view kSpaces = " \t\r";
+    auto                       begin   = text.find_first_not_of(kSpaces);
+    if (begin == std::string_view::npos)
+        return {};
+    return text.substr(begin, text.find_last_not_of(kSpaces) - begin + 1);
+}
+
+}  // namespace
+
+ModuleLogger& get_module_logger(std::string_view name) {
+    return ModuleRegistry::instance().get(name);
+}
+
+int set_module_level(std::string_view name, const std::string& level) {
+    spdlog::level::level_enum value;
+    if (!parse_log_level(level, value))
+        return -1;
+    set_module_level(name, value);
+    return 0;
+}
+
+void set_module_level(std::string_view name, spdlog::level::level_enum level) {
+    ModuleRegistry::instance().set_level(name, level);
+}
+
+void reset_module_level(std::string_view name) {
+    ModuleRegistry::instance().reset_level(name);
+}
+
+void set_default_level(spdlog::level::level_enum level) {
+    spdlog::set_level(level);
+    if (auto logger = get_default_logger())
+        logger->set_level(level);
+    ModuleRegistry::instance().follow_default_level();
+}
+
+void rebind_module_loggers(const std::shared_ptr<spdlog::logger>& default_logger) {
+    ModuleRegistry::instance().rebind(default_logger);
+}
+
+int load_module_levels(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        warn("cannot open log level file " + path);
+        return -1;
+    }
+
+    std::optional<spdlog::level::level_enum>         default_level;
+    std::map<std::string, spdlog::level::level_enum> levels;
+    std::string                                      line;
+    for (int line_number = 1; std::getline(file, line); ++line_number) {
+        std::string_view text = line;
+        text                  = trim(text.substr(0, text.find('#')));
+        if (text.empty())
+            continue;
+        auto                      equal = text.find('=');
+        spdlog::level::level_enum level;
+        if (equal == std::string_view::npos || trim(text.substr(0, equal)).empty() ||
+            !parse_log_level(trim(text.substr(equal + 1)), level)) {
+            warn(path + ":" + std::to_string(line_number) + ": invalid log level line: " + line);
+            continue;
+        }
+        auto name = std::string(trim(text.substr(0, equal)));
+        if (name == "default")
+            default_level = level;
+        else
+            levels[name] = level;
+    }
+
+    if (default_level)
+        set_default_level(*default_level);
+    ModuleRegistry::instance().apply_file_levels(levels);
+    return 0;
+}
+
+void watch_module_levels(const std::string& path, std::chrono::milliseconds interval) {
+    level_file_watcher().start(path, std::max(interval, std::chrono::milliseconds(1)));
+}
+
+void stop_watching_module_levels() {
+    level_file_watcher().stop();
+}
+
+}  // namespace spdlog_log
+}  // namespace logging
+}  // namespace utils
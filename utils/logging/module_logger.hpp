@@ -0,0 +1,120 @@
+#pragma once
+
+#include <frozen/string.h>
+#include <frozen/unordered_map.h>
+#include <spdlog/common.h>
+#include <spdlog/logger.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace utils {
+namespace logging {
+namespace spdlog_log {
+
+// 模块日志记录器的句柄。级别是一个原子变量，热路径上只有两次无锁读取；
+// 输出到与默认 logger 相同的 sink，logger 名字为模块名（pattern 中的 %n）。
+// 句柄在进程内一直有效，可以缓存引用
+class ModuleLogger {
+   public:
+    constexpr explicit ModuleLogger(std::string_view name) : name_(name) {}
+
+    ModuleLogger(const ModuleLogger&)            = delete;
+    ModuleLogger& operator=(const ModuleLogger&) = delete;
+
+    std::string_view name() const { return name_; }
+
+    spdlog::level::level_enum level() const {
+        return static_cast<spdlog::level::level_enum>(level_.load(std::memory_order_relaxed));
+    }
+
+    bool should_log(spdlog::level::level_enum level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    // init_logging 之前为空
+    spdlog::logger* logger() const { return logger_.load(std::memory_order_acquire); }
+
+   private:
+    friend class ModuleRegistry;
+
+    std::string_view             name_;
+    std::atomic<int>             level_{SPDLOG_LEVEL_OFF};
+    std::atomic<spdlog::logger*> logger_{nullptr};
+};
+
+// 编译期已知的模块，UTILS_MODULE_LOG_* 中使用这些名字时在编译期解析为静态句柄。
+// 其他名字在第一次使用时注册到运行期的注册表
+inline constexpr std::array<std::string_view, 2> kLogModules = {
+    "filesystem",  // utils/filesystem_wrapper
+    "task",        // behaviortree_test/task 的任务调度
+};
+inline constexpr std::size_t kLogModuleCount = kLogModules.size();
+
+inline constexpr auto kLogModuleIndex = [] {
+    std::array<std::pair<frozen::string, std::size_t>, kLogModuleCount> items{};
+    for (std::size_t i = 0; i < kLogModuleCount; ++i) items[i] = {kLogModules[i], i};
+    return frozen::make_unordered_map(items);
+}();
+
+// 模块在 kLogModules 中的下标，不是编译期已知的模块时返回 kLogModuleCount
+constexpr std::size_t log_module_index(std::string_view name) {
+    auto it = kLogModuleIndex.find(frozen::string(name));
+    return it == kLogModuleIndex.end() ? kLogModuleCount : it->second;
+}
+
+// kLogModules 对应的静态句柄，常量初始化
+extern std::array<ModuleLogger, kLogModuleCount> g_static_module_loggers;
+
+// 按名字获取模块句柄，不存在时注册一个跟随默认级别的模块。加锁查找，热路径上应缓存返回值
+ModuleLogger& get_module_logger(std::string_view name);
+
+// 设置模块级别，之后不再跟随默认级别。level 取值同 init_logging，另有 "off"；
+// 无法识别时返回 -1。模块尚未使用时先注册，之后第一次使用即生效
+int set_module_level(std::string_view name, const std::string& level);
+void set_module_level(std::string_view name, spdlog::level::level_enum level);
+
+// 恢复为跟随默认级别
+void reset_module_level(std::string_view name);
+
+// 修改默认 logger 的级别，同时作用于未单独设置级别的模块
+void set_default_level(spdlog::level::level_enum level);
+
+// init_logging 创建新的默认 logger 后调用：各模块改用它的 sink，未单独设置级别的模块跟随它的级别。
+// 旧的模块 logger 随即释放，与 init_logging 一样不能与日志调用并发执行
+void rebind_module_loggers(const std::shared_ptr<spdlog::logger>& default_logger);
+
+// 监视级别配置文件，文件修改后重新应用。每行为 "模块名 = 级别"，# 之后为注释；
+// 模块名 default 表示默认级别。文件中删去的模块恢复为跟随默认级别。
+// 启动时先应用一次，文件暂不存在时等待其出现。再次调用会替换之前的监视
+void watch_module_levels(const std::string&        path,
+                         std::chrono::milliseconds interval = std::chrono::seconds(1));
+void stop_watching_module_levels();
+
+// 立即按文件内容应用一次，返回 0；文件无法打开时返回 -1
+int load_module_levels(const std::string& path);
+
+}  // namespace spdlog_log
+}  // namespace logging
+}  // namespace utils
+
+// 模块句柄：module 须为字符串字面量。kLogModules 中的模块在编译期得到静态句柄的下标，
+// 其他模块第一次执行时查找注册表，之后使用函数内静态变量缓存的引用
+#define UTILS_LOG_MODULE_HANDLE(module)                                                   \
+    ([]() -> ::utils::logging::spdlog_log::ModuleLogger& {                                \
+        constexpr std::size_t utils_index_ =                                              \
+            ::utils::logging::spdlog_log::log_module_index(module);                       \
+        if constexpr (utils_index_ < ::utils::logging::spdlog_log::kLogModuleCount) {     \
+            return ::utils::logging::spdlog_log::g_static_module_loggers[utils_index_];   \
+        } else {                                                                          \
+            static auto& utils_handle_ = ::utils::logging::spdlog_log::get_module_logger( \
+                module);                                                                  \
+            return utils_handle_;                                                         \
+        }                                                                                 \
+    }())